@@ -0,0 +1,329 @@
+#include <iostream>
+#include <regex>
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <functional>   // std::hash
+#include <memory>
+#include <mutex>
+#include <future>       // std::promise, std::shared_future
+#include <thread>
+#include <vector>
+#include <chrono>
+
+#include <limits>
+#include <ios>
+
+/*********
+A program to show how compiled regular expressions can be cached and re-used.
+
+Constructing a std::regex parses the pattern and builds the matcher (an automaton) for it.
+This is by far the most expensive part of a regex operation, more so than matching a short string.
+A pattern built inside a loop, e.g.
+
+    do {
+        std::regex r("[[:digit:]]");
+        std::regex_match(str, r);
+    } while(...);
+
+pays the construction cost on every single iteration, although the pattern never changes.
+
+RegexCache:
+===========
+
+RegexCache keeps the compiled std::regex objects keyed by the (pattern text, syntax_option_type) pair,
+so the same pattern compiled with the same grammar/flags is built exactly once per process.
+
+get(pattern, flags)     returns a std::shared_ptr<const std::regex> for the pattern, compiling it on the first request.
+                        The shared_ptr keeps the regex alive even if the cache evicts it later.
+hits()                  number of requests served from the cache.
+misses()                number of requests that had to compile the pattern.
+evictions()             number of patterns dropped because the cache was full.
+
+The cache holds at most capacity() patterns, the Least Recently Used(LRU) pattern is evicted first. The eviction
+waits until the new pattern has compiled(the ones being compiled may be over the capacity for that time), so an
+invalid user pattern does not push a good one out.
+A std::list keeps the patterns ordered by their last use, and an std::unordered_map finds the list node for a key.
+
+Thread safety:
+The lookup is guarded by a std::mutex, but the pattern is compiled outside the lock.
+The first thread asking for a pattern inserts a std::shared_future into the cache and compiles the pattern,
+every other thread asking for the same pattern meanwhile waits on the future instead of compiling it again.
+An invalid pattern throws std::regex_error to every waiting thread, and is not kept in the cache.
+
+RegexCache::instance() returns the process-wide cache.
+*********/
+
+class RegexCache
+{
+public:
+    typedef std::regex_constants::syntax_option_type flag_type;
+    typedef std::shared_ptr<const std::regex> regex_ptr;
+
+    explicit RegexCache(std::size_t capacity = 256):_capacity(capacity ? capacity : 1), _hits(0), _misses(0), _evictions(0), _tickets(0) {}
+
+    RegexCache(const RegexCache&) = delete;
+    RegexCache& operator=(const RegexCache&) = delete;
+
+    static RegexCache& instance()
+    {
+        static RegexCache cache;    // Initialization of a local static is thread-safe in C++ 11
+        return cache;
+    }
+
+    regex_ptr get(const std::string& pattern, flag_type flags = std::regex_constants::ECMAScript)
+    {
+        Key key(pattern, flags);
+
+        std::promise<regex_ptr> compiled;
+        std::shared_future<regex_ptr> result;
+        bool owner = false;     // Set for the thread that inserted the entry and compiles the pattern
+        unsigned long ticket = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+
+            auto found = _index.find(key);
+            if(found != _index.end())
+            {
+                ++_hits;
+                _lru.splice(_lru.begin(), _lru, found->second);     // Move the entry to the front, as most recently used.
+                result = found->second->result;
+            }
+            else
+            {
+                ++_misses;
+                owner = true;
+                result = compiled.get_future().share();
+                ticket = ++_tickets;
+                _lru.push_front(Entry(key, result, ticket));     // Evicts nothing yet: the pattern may be invalid
+                _index[key] = _lru.begin();
+            }
+        }
+
+        if(owner)
+            compile(key, compiled, ticket);
+
+        return result.get();    // Waits for the compiling thread, rethrows std::regex_error for an invalid pattern.
+    }
+
+    std::size_t capacity() const    { return _capacity; }
+    std::size_t size()              { std::lock_guard<std::mutex> lock(_mtx); return _lru.size(); }
+    unsigned long hits()            { std::lock_guard<std::mutex> lock(_mtx); return _hits; }
+    unsigned long misses()          { std::lock_guard<std::mutex> lock(_mtx); return _misses; }
+    unsigned long evictions()       { std::lock_guard<std::mutex> lock(_mtx); return _evictions; }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _index.clear();
+        _lru.clear();
+        _hits = _misses = _evictions = 0;
+    }
+
+private:
+    typedef std::pair<std::string, flag_type> Key;
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& k) const
+        {
+            return std::hash<std::string>()(k.first) ^ (static_cast<std::size_t>(k.second) * 0x9e3779b9u);
+        }
+    };
+
+    struct Entry
+    {
+        Entry(const Key& k, const std::shared_future<regex_ptr>& r, unsigned long t):key(k), result(r), ticket(t) {}
+
+        Key key;
+        std::shared_future<regex_ptr> result;
+        unsigned long ticket;       // Tells this entry from a later one of the same key
+    };
+    typedef std::list<Entry> LruList;
+
+    void compile(const Key& key, std::promise<regex_ptr>& compiled, unsigned long ticket)
+    {
+        try
+        {
+            compiled.set_value(regex_ptr(new std::regex(key.first, key.second)));
+
+            // Only a pattern that compiled makes room for itself, an invalid one never evicts a good regex.
+            std::lock_guard<std::mutex> lock(_mtx);
+            while(_lru.size() > _capacity)
+            {
+                _index.erase(_lru.back().key);
+                _lru.pop_back();
+                ++_evictions;
+            }
+        }
+        catch(...)
+        {
+            compiled.set_exception(std::current_exception());
+
+            // Do not keep the failed pattern, a later request tries to compile it again. The entry may be gone
+            // already(evicted, or clear()), and another thread may have inserted a new one for the key since: only
+            // the entry of this compilation is erased.
+            std::lock_guard<std::mutex> lock(_mtx);
+            auto found = _index.find(key);
+            if(found != _index.end() && found->second->ticket == ticket)
+            {
+                _lru.erase(found->second);
+                _index.erase(found);
+            }
+        }
+    }
+
+    std::mutex _mtx;
+    std::size_t _capacity;
+    LruList _lru;                                               // Front is the most recently used
+    std::unordered_map<Key, LruList::iterator, KeyHash> _index;
+
+    unsigned long _hits;
+    unsigned long _misses;
+    unsigned long _evictions;
+    unsigned long _tickets;                                     // Never reset, unlike the statistics
+};
+
+// The functions below are the ones in 13_regularExp.cpp, with the patterns fetched from the cache.
+
+void matchPattern()
+{
+    std::string str;
+
+    do
+    {
+        std::cout << "Enter a string:";
+
+        std::cin >> str;
+
+        // The pattern is compiled on the first iteration only, later iterations find it in the cache.
+        RegexCache::regex_ptr r = RegexCache::instance().get("[[:digit:]]");
+
+        if (std::regex_match(str, *r))
+            std::cout << "Pattern found ... " << std::endl;
+        else
+            std::cout << "Pattern not found ..." << std::endl;
+
+    }while (str != "end");
+}
+
+void searchPattern()
+{
+    std::string str;
+    // Clear the cin buffer
+    std::cin.clear();
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(),'\n');
+
+    std::cout << std::endl << "Enter the complete string:";
+    std::getline(std::cin, str);
+
+    std::string ss;
+    std::cout << std::endl << "Enter substring to search inside string:";
+    std::cin >> ss;
+
+    try
+    {
+        if (std::regex_search(str, *RegexCache::instance().get(ss)))
+            std::cout << "Pattern found ... " << std::endl;
+        else
+            std::cout << "Pattern not found ..." << std::endl;
+    }
+    catch(std::regex_error & re)
+    {
+        std::cout << "Invalid pattern: " << re.what() << std::endl;
+    }
+}
+
+void verifyGrammar()
+{
+    std::string str;
+    do
+    {
+        std::cout << "\n Enter string:"; std::cin >> str;
+
+        // The grammar is a part of the key, "^pqr.+" with grep and with ECMAScript are two different cache entries.
+        if (std::regex_match(str, *RegexCache::instance().get("^pqr.+", std::regex_constants::grep)))
+            std::cout << "Pattern found ... " << std::endl;
+        else
+            std::cout << "Pattern not found ..." << std::endl;
+    }while(str != "end");
+}
+
+// Measure the average time per regex_match() call, when the pattern is compiled on every call vs. fetched from the cache.
+void benchmark(const std::string& pattern, const std::string& input, int count)
+{
+    RegexCache cache;
+    volatile bool found = false;    // Keeps the optimizer from dropping the matching
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for(int i = 0; i < count; ++i)
+    {
+        std::regex r(pattern);
+        found ^= std::regex_match(input, r);
+    }
+    std::chrono::nanoseconds uncached = std::chrono::steady_clock::now() - t0;
+
+    t0 = std::chrono::steady_clock::now();
+    for(int i = 0; i < count; ++i)
+    {
+        found ^= std::regex_match(input, *cache.get(pattern));
+    }
+    std::chrono::nanoseconds cached = std::chrono::steady_clock::now() - t0;
+
+    std::cout << "pattern: " << pattern << std::endl;
+    std::cout << "  compiled per call: " << uncached.count() / count << " ns/call" << std::endl;
+    std::cout << "  from the cache   : " << cached.count() / count << " ns/call" << std::endl;
+    std::cout << "  hits: " << cache.hits() << ", misses: " << cache.misses() << std::endl;
+}
+
+int main()
+{
+//    matchPattern();
+
+//    searchPattern();
+
+//    verifyGrammar();
+
+    std::cout << "----------------- LRU eviction ----------------" << std::endl;
+    RegexCache small(2);
+    small.get("pqr");
+    small.get("pqr", std::regex_constants::icase);  // Different flags, a different entry
+    small.get("pqr");                               // Hit, "pqr" becomes the most recently used
+    small.get("st+");                               // Evicts "pqr"/icase, the least recently used
+    small.get("pqr");                               // Still cached
+    std::cout << "size: " << small.size() << ", hits: " << small.hits() << ", misses: " << small.misses()
+              << ", evictions: " << small.evictions() << std::endl;
+
+    std::cout << "----------------- Invalid pattern ----------------" << std::endl;
+    try
+    {
+        small.get("pq[rs");
+    }
+    catch(std::regex_error & re)
+    {
+        std::cout << "regex_error: " << re.what() << ", size: " << small.size() << "(nothing evicted)" << std::endl;
+    }
+
+    std::cout << "----------------- Concurrent lookups ----------------" << std::endl;
+    RegexCache& cache = RegexCache::instance();
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; ++t)
+    {
+        threads.push_back(std::thread([&cache]() {
+            for(int i = 0; i < 1000; ++i)
+                std::regex_search("https://www.google.com", *cache.get("([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)"));
+        }));
+    }
+    for(auto & t : threads)
+        t.join();
+
+    // The pattern is compiled exactly once, whichever thread gets there first.
+    std::cout << "hits: " << cache.hits() << ", misses: " << cache.misses() << std::endl;
+
+    std::cout << "----------------- Per call latency ----------------" << std::endl;
+    benchmark("[[:digit:]]", "7", 20000);
+    benchmark("([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)", "https://www.google.com", 5000);
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <regex>
+#include <string>
+#include <chrono>
+
+#include "regexDFA.h"
+
+/*********
+A program to show matching regular expressions with a DFA (Deterministic Finite Automaton) instead of backtracking.
+
+std::regex in libstdc++ is a backtracking matcher, it tries every alternative and every start position in turn.
+For a pattern like the web URL one used in 13_regularExp.cpp and 14_regularExp_Iter.cpp,
+
+    ([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)
+
+each start offset of a long input is tried, and ([[:w:]]+) consumes the longest run of word characters
+before backing off one character at a time, so scanning long inputs gets very slow.
+
+regexDFA.h provides FastRegex, which compiles a pattern without back-references into an automaton, that
+reads each input character once. Patterns that do need back-references like (pqr)st(lm)uv\2\1 transparently
+use a backtracking engine instead(and std::regex for anything FastRegex does not parse).
+
+The functions and types follow the ones in <regex>, so code using std::regex switches with a one-line change:
+
+    std::regex r(...);                  FastRegex r(...);
+    std::smatch sm;                     fast_smatch sm;
+    std::regex_search(str, sm, r);      fast_regex_search(str, sm, r);
+    std::regex_match(str, sm, r);       fast_regex_match(str, sm, r);
+    std::sregex_iterator it(b, e, r);   fast_sregex_iterator it(b, e, r);
+
+The results(fast_smatch) hold std::sub_match objects, so sm[i].str(), sm.prefix(), sm.suffix(), sm.position(i)
+etc. work as they do for a std::smatch.
+*********/
+
+// verifySubmatch() of 13_regularExp.cpp using FastRegex
+void verifySubmatch()
+{
+    std::string prefix = "{sample prefix}";
+    std::string suffix = "{A sample suffix}";
+
+    std::string str = prefix + "https://www.google.com" + suffix;
+    std::cout << "str: " << str << std::endl;
+
+    fast_smatch sm;
+    FastRegex r("([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)");    // Matches a web URL
+
+    fast_regex_search(str, sm, r);
+
+    std::cout << "Uses the DFA: " << std::boolalpha << r.usesDFA() << ", sm.size(): " << sm.size() << std::endl;
+
+    for(std::size_t i = 0; i < sm.size(); ++i)
+        std::cout << "sm[" << i << "]: " << sm[i].str() << std::endl;
+
+    std::cout << "sm.prefix : " << sm.prefix().str() << std::endl;
+    std::cout << "sm.suffix: " << sm.suffix().str() << std::endl;
+}
+
+// The regex_iterator loop of 14_regularExp_Iter.cpp using FastRegex
+void iterateMatches()
+{
+    std::string strs = "https://www.google.com; http://www.yahoo.co.in;; http://www.gnu.org";
+    std::cout << "String: " << strs << std::endl;
+
+    FastRegex r("([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)");
+
+    fast_regex_iterator<std::string::iterator> rgit(strs.begin(), strs.end(), r);
+    fast_regex_iterator<std::string::iterator> rgend;
+
+    for(; rgit != rgend; ++rgit)
+    {
+        std::cout << rgit->str() << std::endl;
+
+        for(std::size_t i = 0; i < rgit->size(); ++i)
+            std::cout << " str[" << i << "]: " << rgit->str(i) << std::endl;
+    }
+}
+
+void backReferences()
+{
+    // The pattern needs to remember what a group matched, which a DFA cannot do: it is run by backtracking.
+    FastRegex r("(pqr)st(lm)uv\\2\\1");
+
+    std::cout << "Uses the DFA: " << std::boolalpha << r.usesDFA() << std::endl;
+    std::cout << "pqrstlmuvlmpqr: " << fast_regex_match("pqrstlmuvlmpqr", r) << std::endl;
+    std::cout << "pqrstlmuvpqrlm: " << fast_regex_match("pqrstlmuvpqrlm", r) << std::endl;
+}
+
+// Time scanning a long input for the URL pattern, with std::regex and with FastRegex
+void benchmark()
+{
+    std::string line = "GET /index.html 200 user_agent_with_a_rather_long_name_but_no_url 0.25 ";
+    std::string text;
+    for(int i = 0; i < 2000; ++i)
+        text += line;
+    text += "see https://www.gnu.org for details";
+
+    const char* pattern = "([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)";
+
+    std::regex sr(pattern);
+    std::smatch sm;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    std::regex_search(text, sm, sr);
+    std::chrono::microseconds stdTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0);
+
+    FastRegex fr(pattern);
+    fast_smatch fm;
+    t0 = std::chrono::steady_clock::now();
+    fast_regex_search(text, fm, fr);
+    std::chrono::microseconds fastTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0);
+
+    std::cout << "input: " << text.size() << " bytes" << std::endl;
+    std::cout << "std::regex_search : " << sm.str() << " in " << stdTime.count() << " us" << std::endl;
+    std::cout << "fast_regex_search : " << fm.str() << " in " << fastTime.count() << " us" << std::endl;
+}
+
+int main()
+{
+    std::cout << "----------------- verifySubmatch ----------------" << std::endl;
+    verifySubmatch();
+
+    std::cout << "----------------- fast_regex_iterator ----------------" << std::endl;
+    iterateMatches();
+
+    std::cout << "----------------- back-references ----------------" << std::endl;
+    backReferences();
+
+    std::cout << "----------------- long input ----------------" << std::endl;
+    benchmark();
+
+    return 0;
+}
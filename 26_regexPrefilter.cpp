@@ -0,0 +1,109 @@
+#include <iostream>
+#include <regex>
+#include <string>
+#include <chrono>
+
+#include "regexDFA.h"
+
+/*********
+A program to show a literal prefilter in front of a regular expression scan.
+
+The regex_iterator loop of 14_regularExp_Iter.cpp,
+
+    std::regex r("([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)", std::regex_constants::icase);
+    std::regex_iterator<std::string::iterator> rgit(strs.begin(), strs.end(), r);
+
+runs the regex at every offset of the input, although a URL can only be found where "://" occurs.
+In a large access log, where URLs are rare, almost all that work is wasted.
+
+FastRegex (regexDFA.h) extracts the literal that every match has to contain ("://" here) when it compiles
+the pattern, and keeps the characters the pattern can match on either side of it:
+
+    ([[:w:]]+)          ://         ([[:w:]]+).([[:w:]]+).([[:w:]]+)
+    before: [[:w:]]     literal     after: anything but a newline
+
+A search then:
+    1. finds the next "://" with LiteralScanner, comparing 16(SSE2) or 32(AVX2) characters per instruction,
+    2. extends a window to the left over [[:w:]] and to the right up to the end of the line,
+    3. runs the automaton inside the window only.
+
+FastRegex::prefilter() returns the literal used, nullptr when the pattern has none.
+The pattern is compiled with icase, as in 14_regularExp_Iter.cpp: FastRegex folds it when parsing(38_regexIcase.cpp),
+and a literal of letters is searched in both cases. "://" has none, so the prefilter is the same.
+*********/
+
+std::string makeLog(std::size_t lines)
+{
+    std::string log;
+    for(std::size_t i = 0; i < lines; ++i)
+    {
+        log += "10.0.0.1 - - [17/Oct/2026:12:00:00] \"GET /static/app.js HTTP/1.1\" 200 5120 \"-\" \"Mozilla/5.0\"\n";
+        if(i % 1000 == 999)
+            log += "10.0.0.2 - - [17/Oct/2026:12:00:01] \"GET /go HTTP/1.1\" 302 0 \"https://www.gnu.org\" \"curl\"\n";
+    }
+    return log;
+}
+
+template<class Iterator>
+void scan(const char* name, Iterator it, Iterator end, std::size_t bytes)
+{
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    std::size_t count = 0, chars = 0;
+    for(; it != end; ++it)
+    {
+        ++count;
+        chars += it->length(3);     // The domain, e.g. gnu
+    }
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << name << ": " << count << " URLs(" << chars << " domain chars) in " << secs * 1000 << " ms, "
+              << bytes / secs / (1024 * 1024) << " MB/s" << std::endl;
+}
+
+int main()
+{
+    const char* pattern = "([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)";
+
+    FastRegex r(pattern, std::regex_constants::icase);
+    std::cout << "Required literal: \"" << r.prefilter()->scanner.literal() << "\"" << std::endl;
+
+    std::string strs = "https://www.google.com; http://www.yahoo.co.in;; http://www.gnu.org";
+    for(fast_sregex_iterator it(strs.begin(), strs.end(), r), end; it != end; ++it)
+        std::cout << it->str() << std::endl;
+
+    std::cout << "----------------- Scanning a log ----------------" << std::endl;
+
+    std::string small = makeLog(5000);
+    std::regex sr(pattern, std::regex_constants::icase);
+    scan("std::sregex_iterator        ", std::sregex_iterator(small.begin(), small.end(), sr), std::sregex_iterator(), small.size());
+
+    FastRegex noFilter(pattern, std::regex_constants::icase);
+    noFilter.enablePrefilter(false);
+    scan("fast_sregex_iterator        ", fast_sregex_iterator(small.begin(), small.end(), noFilter), fast_sregex_iterator(), small.size());
+    scan("fast_sregex_iterator + \"://\"", fast_sregex_iterator(small.begin(), small.end(), r), fast_sregex_iterator(), small.size());
+
+    std::string large = makeLog(500000);
+    std::cout << "Log of " << large.size() / (1024 * 1024) << " MB:" << std::endl;
+    scan("fast_sregex_iterator + \"://\"", fast_sregex_iterator(large.begin(), large.end(), r), fast_sregex_iterator(), large.size());
+
+    // The literal search alone, compared with std::string::find
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    std::size_t hits = 0;
+    for(std::size_t pos = large.find("://"); pos != std::string::npos; pos = large.find("://", pos + 1))
+        ++hits;
+    double findSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    LiteralScanner scanner("://");
+    const char* e = large.data() + large.size();
+    t0 = std::chrono::steady_clock::now();
+    std::size_t simdHits = 0;
+    for(const char* p = scanner.find(large.data(), e); p; p = scanner.find(p + 1, e))
+        ++simdHits;
+    double simdSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::cout << "std::string::find    : " << hits << " hits, " << large.size() / findSecs / (1024 * 1024) << " MB/s" << std::endl;
+    std::cout << "LiteralScanner::find : " << simdHits << " hits, " << large.size() / simdSecs / (1024 * 1024) << " MB/s" << std::endl;
+
+    return 0;
+}
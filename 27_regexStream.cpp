@@ -0,0 +1,236 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <regex>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <cstdio>       // std::remove
+#include <chrono>
+
+#include "regexDFA.h"
+
+/*********
+A program to show scanning a stream(e.g. a file larger than the memory) for the matches of a regular expression.
+
+std::sregex_iterator needs the whole target sequence in memory, e.g. the std::string strs in 14_regularExp_Iter.cpp.
+
+RegexStreamScanner reads the input in chunks into a buffer of a fixed size, so the memory used does not depend
+on the size of the input, and reports each match with its offset in the stream and the span of each sub-match.
+
+Chunk boundaries:
+A match can begin in one chunk and end in the next one, and whether a match begins at a position can depend
+on the characters that follow it. The scanner is given the maximum length of a match, maxMatch:
+
+    - A match beginning at s is only reported once the buffer holds at least maxMatch characters after s
+      (or the input has ended), so it is the same match that would be found in the whole input.
+    - Otherwise the last maxMatch characters are carried over to the front of the buffer, and the next chunk
+      is read after them.
+
+With matches no longer than maxMatch the scanner reports the same matches as std::sregex_iterator over the whole
+input (including the handling of empty matches), using a buffer of chunk + maxMatch characters.
+
+StreamMatch:
+    position(n)     offset of the sub-match n in the stream, StreamMatch::npos if it did not match
+    length(n)       length of the sub-match n
+    str(n)          the sub-match, the text is only available inside the callback (it points into the buffer).
+*********/
+
+class StreamMatch
+{
+public:
+    static const unsigned long long npos = static_cast<unsigned long long>(-1);
+
+    std::size_t size() const                { return _caps->size() / 2; }
+    bool matched(std::size_t n) const       { return (*_caps)[2 * n] >= 0; }
+    unsigned long long position(std::size_t n = 0) const { return matched(n) ? _offset + (*_caps)[2 * n] : npos; }
+    std::size_t length(std::size_t n = 0) const   { return matched(n) ? (*_caps)[2 * n + 1] - (*_caps)[2 * n] : 0; }
+    std::string str(std::size_t n = 0) const     { return matched(n) ? std::string(_buf + (*_caps)[2 * n], length(n)) : std::string(); }
+
+private:
+    friend class RegexStreamScanner;
+    StreamMatch(const char* buf, unsigned long long offset, const std::vector<int>& caps):_buf(buf), _offset(offset), _caps(&caps) {}
+
+    const char* _buf;
+    unsigned long long _offset;     // Stream offset of _buf[0]
+    const std::vector<int>* _caps;
+};
+
+class RegexStreamScanner
+{
+public:
+    RegexStreamScanner(const FastRegex& re, std::size_t chunk = 1 << 20, std::size_t maxMatch = 4096)
+        :_re(re), _maxMatch(maxMatch), _buf(std::max<std::size_t>(chunk, 1) + maxMatch + 1) {}
+
+    // Calls onMatch(const StreamMatch&) for every match in the stream, returns the number of matches.
+    template<class Callback>
+    unsigned long long scan(std::istream& in, Callback onMatch)
+    {
+        using namespace std::regex_constants;
+
+        const char* b = _buf.data();
+        std::size_t len = 0;                // Characters in the buffer
+        std::size_t from = 0;               // Where the next search begins
+        unsigned long long offset = 0;      // Stream offset of the buffer
+        bool afterEmpty = false;            // The previous match was empty and ended at from
+        bool eof = false;
+        unsigned long long count = 0;
+
+        for(;;)
+        {
+            if(!eof && len < _buf.size())
+            {
+                in.read(&_buf[len], _buf.size() - len);
+                len += static_cast<std::size_t>(in.gcount());
+                eof = len < _buf.size();
+            }
+
+            // Searches as far as the characters in the buffer tell the result for sure.
+            std::size_t keep = len;
+            for(;;)
+            {
+                match_flag_type flags = eof ? match_default : match_not_eol;
+                if(offset > 0)
+                    flags |= match_prev_avail;      // b[0] is the character before the first one searched
+
+                bool found = false;
+                if(afterEmpty)
+                {
+                    if(!safe(from, len, eof))
+                    {
+                        keep = from;
+                        break;
+                    }
+                    found = _re.searchRange(b, b + from, b + len, &_caps, flags | match_continuous | match_not_null);
+                    afterEmpty = false;
+                    if(!found)
+                    {
+                        if(from == len)     // The input has ended(from is safe)
+                            break;
+                        ++from;
+                    }
+                }
+                if(!found)
+                    found = _re.searchRange(b, b + from, b + len, &_caps, flags);
+
+                if(!found || !safe(_caps[0], len, eof))
+                {
+                    // Any match still to be found begins in the last maxMatch characters.
+                    keep = (eof || len - from <= _maxMatch) ? from : len - _maxMatch;
+                    break;
+                }
+
+                ++count;
+                onMatch(StreamMatch(b, offset, _caps));
+
+                from = _caps[1];
+                afterEmpty = _caps[0] == _caps[1];
+            }
+
+            if(eof)
+                return count;
+
+            // Carry the characters from keep on(and the one before, for match_prev_avail) to the front.
+            from = keep;
+            std::size_t shift = keep > 0 ? keep - 1 : 0;
+            std::memmove(&_buf[0], &_buf[shift], len - shift);
+            len -= shift;
+            from -= shift;
+            offset += shift;
+        }
+    }
+
+private:
+    // The result of a search at pos is final if maxMatch characters follow it.
+    bool safe(std::size_t pos, std::size_t len, bool eof) const { return eof || pos + _maxMatch < len; }
+
+    FastRegex _re;
+    std::size_t _maxMatch;
+    std::vector<char> _buf;
+    std::vector<int> _caps;
+};
+
+// Compares the matches of the scanner(with a small buffer) to the ones of std::sregex_iterator over the whole input.
+bool sameAsIterator(const std::string& pattern, const std::string& text, std::size_t chunk, std::size_t maxMatch)
+{
+    std::regex r(pattern);
+    std::vector<std::string> expected;
+    for(std::sregex_iterator it(text.begin(), text.end(), r), end; it != end; ++it)
+    {
+        std::ostringstream os;
+        for(std::size_t i = 0; i < it->size(); ++i)
+            os << (*it)[i].matched << ":" << ((*it)[i].matched ? it->position(i) : 0) << ":" << it->length(i) << " ";
+        expected.push_back(os.str());
+    }
+
+    std::vector<std::string> found;
+    std::istringstream in(text);
+    RegexStreamScanner scanner(FastRegex(pattern), chunk, maxMatch);
+    scanner.scan(in, [&found](const StreamMatch& m) {
+        std::ostringstream os;
+        for(std::size_t i = 0; i < m.size(); ++i)
+            os << m.matched(i) << ":" << (m.matched(i) ? m.position(i) : 0) << ":" << m.length(i) << " ";
+        found.push_back(os.str());
+    });
+
+    std::cout << pattern << ": " << found.size() << " matches, same as sregex_iterator: "
+              << std::boolalpha << (found == expected) << std::endl;
+    return found == expected;
+}
+
+int main()
+{
+    std::string strs = "https://www.google.com; http://www.yahoo.co.in;; http://www.gnu.org";
+
+    std::cout << "----------------- A stream in chunks of 16 characters ----------------" << std::endl;
+    std::istringstream in(strs);
+    RegexStreamScanner scanner(FastRegex("([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)"), 16, 32);
+    scanner.scan(in, [](const StreamMatch& m) {
+        std::cout << "offset " << m.position() << ": " << m.str() << std::endl;
+        for(std::size_t i = 1; i < m.size(); ++i)
+            std::cout << "  [" << i << "] offset " << m.position(i) << ", length " << m.length(i) << ": " << m.str(i) << std::endl;
+    });
+
+    std::cout << "----------------- Matches crossing the chunks ----------------" << std::endl;
+    std::string text;
+    for(int i = 0; i < 200; ++i)
+        text += strs + "\n12 pqrstlmuvlmpqr 345; ";
+
+    sameAsIterator("([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)", text, 64, 64);
+    sameAsIterator("[[:digit:]]*", text, 7, 16);                  // Empty matches everywhere
+    sameAsIterator("(pqr)st(lm)uv\\2\\1", text, 10, 20);            // Backtracking through FastRegex
+    sameAsIterator("^https|org$|;", text, 13, 8);
+
+    std::cout << "----------------- Scanning a file ----------------" << std::endl;
+    const char* path = "27_regexStream.tmp";
+    {
+        std::ofstream out(path, std::ios::binary);
+        std::string line = "10.0.0.1 - - [17/Oct/2026:12:00:00] \"GET /static/app.js HTTP/1.1\" 200 5120 \"-\" \"Mozilla/5.0\"\n";
+        for(int i = 0; i < 1000000; ++i)
+            out << line << (i % 1000 == 0 ? "referer https://www.gnu.org\n" : "");
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(0, std::ios::end);
+    double mb = file.tellg() / (1024.0 * 1024.0);
+    file.seekg(0);
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    RegexStreamScanner fileScanner(FastRegex("([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)"));
+    unsigned long long urls = fileScanner.scan(file, [](const StreamMatch&) {});
+    double scanSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    // Reading alone, for comparison
+    std::ifstream again(path, std::ios::binary);
+    std::vector<char> chunk(1 << 20);
+    t0 = std::chrono::steady_clock::now();
+    while(again.read(chunk.data(), chunk.size()) || again.gcount() > 0) ;
+    double readSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::cout << mb << " MB, " << urls << " URLs, scan: " << mb / scanSecs << " MB/s, read only: " << mb / readSecs << " MB/s" << std::endl;
+
+    std::remove(path);
+
+    return 0;
+}
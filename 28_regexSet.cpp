@@ -0,0 +1,343 @@
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+#include <queue>
+#include <chrono>
+
+#include "regexDFA.h"
+
+/*********
+A program to show matching a string against a whole set of regular expressions at once.
+
+matchPattern() in 13_regularExp.cpp lists a number of alternative patterns ("pqr", "pqr.", "pq[rs]*", ...),
+and only one of them can be tried at a time. Classifying a string against N patterns takes N calls to
+std::regex_match, each one reading the whole string again.
+
+RegexSet compiles all the patterns into two automata, and tells which patterns match in a single pass:
+
+    AhoCorasick     The patterns that are plain literals("pqr", "error") are put in an Aho-Corasick automaton:
+                    a trie of all the literals, where a character without a child in the trie follows a 'fail'
+                    link to the longest suffix that is in the trie. Reading the string once finds every
+                    occurrence of every literal.
+
+    Combined DFA    The other patterns are compiled into one program(RegexProgram::compileSet of regexDFA.h),
+                    whose Match instructions tell which pattern they belong to. A state of its DFA knows
+                    every pattern that can match at that point.
+
+    Patterns that cannot use the DFA(back-references, collate ...) are matched one by one. The flags apply
+    to every pattern: with icase the patterns are parsed folded(38_regexIcase.cpp), with FastRegex::utf8 as UTF-8
+    (37_regexUtf8.cpp), in the trie and the DFA alike.
+
+RegexSet::matchAll(str)     indices of the patterns matching the whole of str, like std::regex_match
+RegexSet::searchAll(str)    indices of the patterns matching a part of str, like std::regex_search
+*********/
+
+class AhoCorasick
+{
+public:
+    AhoCorasick():_next(256, -1), _fail(1, 0), _out(1) {}
+
+    // Adds a literal, reported as id.
+    void add(const std::string& literal, std::size_t id)
+    {
+        int s = 0;
+        for(std::size_t i = 0; i < literal.size(); ++i)
+        {
+            int& t = _next[s * 256 + static_cast<unsigned char>(literal[i])];
+            if(t < 0)
+            {
+                t = static_cast<int>(_fail.size());
+                _fail.push_back(0);
+                _out.push_back(std::vector<Output>());
+                _next.resize(_next.size() + 256, -1);
+            }
+            s = _next[s * 256 + static_cast<unsigned char>(literal[i])];
+        }
+        Output o = { id, literal.size() };
+        _out[s].push_back(o);
+    }
+
+    // Computes the fail links breadth first, and turns the trie into a complete transition table:
+    // a missing child becomes the child of the fail state, so scanning takes one lookup per character.
+    void build()
+    {
+        std::queue<int> todo;
+        for(int c = 0; c < 256; ++c)
+        {
+            int& t = _next[c];
+            if(t < 0)
+                t = 0;
+            else
+            {
+                _fail[t] = 0;
+                todo.push(t);
+            }
+        }
+        while(!todo.empty())
+        {
+            int s = todo.front();
+            todo.pop();
+
+            // The outputs of the fail state(a suffix) are outputs of this state too.
+            _out[s].insert(_out[s].end(), _out[_fail[s]].begin(), _out[_fail[s]].end());
+
+            for(int c = 0; c < 256; ++c)
+            {
+                int& t = _next[s * 256 + c];
+                if(t < 0)
+                    t = _next[_fail[s] * 256 + c];
+                else
+                {
+                    _fail[t] = _next[_fail[s] * 256 + c];
+                    todo.push(t);
+                }
+            }
+        }
+    }
+
+    bool empty() const { return _fail.size() == 1 && _out[0].empty(); }
+
+    // whole: report only the literals equal to [b, e), else every literal found in [b, e).
+    void scan(const char* b, const char* e, bool whole, std::vector<char>& matched) const
+    {
+        int s = 0;
+        if(!whole)
+            mark(s, 0, matched);
+        for(const char* p = b; p != e; ++p)
+        {
+            s = _next[s * 256 + static_cast<unsigned char>(*p)];
+            if(!whole)
+                mark(s, 0, matched);
+        }
+        if(whole)
+            mark(s, static_cast<std::size_t>(e - b), matched);
+    }
+
+private:
+    struct Output
+    {
+        std::size_t id;
+        std::size_t length;
+    };
+
+    // length 0: any literal, else only literals of this length
+    void mark(int s, std::size_t length, std::vector<char>& matched) const
+    {
+        for(std::size_t i = 0; i < _out[s].size(); ++i)
+            if(length == 0 || _out[s][i].length == length)
+                matched[_out[s][i].id] = 1;
+    }
+
+    std::vector<int> _next;                     // 256 transitions per state
+    std::vector<int> _fail;
+    std::vector<std::vector<Output> > _out;
+};
+
+class RegexSet
+{
+public:
+    explicit RegexSet(const std::vector<std::string>& patterns, std::regex_constants::syntax_option_type f = std::regex_constants::ECMAScript)
+        :_size(patterns.size()), _literalCount(0)
+    {
+        std::vector<RegexNodePtr> trees;
+        std::vector<const RegexNode*> roots;
+
+        for(std::size_t i = 0; i < patterns.size(); ++i)
+        {
+            FastRegex re(patterns[i], f);       // Throws std::regex_error for an invalid pattern
+            if(!re.usesDFA())
+            {
+                _others.push_back(std::make_pair(i, re));
+                continue;
+            }
+
+            RegexParser parser(patterns[i], FastRegex::parserMode(f));     // The tree re was built from
+            RegexNodePtr root = parser.parse();
+
+            std::string literal;
+            if(isLiteral(*root, literal) && !literal.empty())
+            {
+                _literals.add(literal, i);
+                ++_literalCount;
+            }
+            else
+            {
+                roots.push_back(root.get());
+                _dfaIds.push_back(i);
+                trees.push_back(std::move(root));
+            }
+        }
+        _literals.build();
+
+        _program = RegexProgram::compileSet(roots);
+        _whole.reset(new LazyDFA(*_program, false));
+        _part.reset(new LazyDFA(*_program, true));
+    }
+
+    std::size_t size() const            { return _size; }
+    std::size_t literals() const        { return _literalCount; }
+    std::size_t combined() const        { return _dfaIds.size(); }
+    std::size_t others() const          { return _others.size(); }
+
+    std::vector<std::size_t> matchAll(const std::string& s) const  { return find(s, true); }
+    std::vector<std::size_t> searchAll(const std::string& s) const { return find(s, false); }
+
+private:
+    // A literal: single characters, possibly grouped
+    static bool isLiteral(const RegexNode& n, std::string& literal)
+    {
+        switch(n.kind)
+        {
+        case RegexNode::Bytes:
+            if(n.set.count() != 1)
+                return false;
+            for(int c = 0; c < 256; ++c)
+                if(n.set[c])
+                    literal += static_cast<char>(c);
+            return true;
+        case RegexNode::Concat:
+        case RegexNode::Group:
+            for(std::size_t i = 0; i < n.kids.size(); ++i)
+                if(!isLiteral(*n.kids[i], literal))
+                    return false;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    std::vector<std::size_t> find(const std::string& s, bool whole) const
+    {
+        const char* b = s.data();
+        const char* e = b + s.size();
+
+        std::vector<char> matched(_size, 0);
+        if(!_literals.empty())
+            _literals.scan(b, e, whole, matched);
+
+        if(!_dfaIds.empty())
+        {
+            std::vector<char> dfaMatched(_dfaIds.size(), 0);
+            (whole ? _whole : _part)->matchingPatterns(b, e, dfaMatched);
+            for(std::size_t i = 0; i < _dfaIds.size(); ++i)
+                if(dfaMatched[i])
+                    matched[_dfaIds[i]] = 1;
+        }
+
+        for(std::size_t i = 0; i < _others.size(); ++i)
+        {
+            const FastRegex& re = _others[i].second;
+            if(whole ? re.matchRange(b, e, nullptr) : re.searchRange(b, b, e, nullptr))
+                matched[_others[i].first] = 1;
+        }
+
+        std::vector<std::size_t> result;
+        for(std::size_t i = 0; i < _size; ++i)
+            if(matched[i])
+                result.push_back(i);
+        return result;
+    }
+
+    std::size_t _size;
+    std::size_t _literalCount;
+    AhoCorasick _literals;
+
+    std::shared_ptr<RegexProgram> _program;
+    std::vector<std::size_t> _dfaIds;       // The pattern index of each pattern in the combined program
+    std::unique_ptr<LazyDFA> _whole;        // Built lazily while matching, hence not thread-safe(as FastRegex)
+    std::unique_ptr<LazyDFA> _part;
+
+    std::vector<std::pair<std::size_t, FastRegex> > _others;
+};
+
+std::ostream& operator<<(std::ostream& os, const std::vector<std::size_t>& v)
+{
+    os << "{";
+    for(std::size_t i = 0; i < v.size(); ++i)
+        os << (i ? ", " : " ") << v[i];
+    return os << " }";
+}
+
+int main()
+{
+    // The patterns of matchPattern() in 13_regularExp.cpp
+    std::vector<std::string> patterns = {
+        "pqr", "pqr.", "pqr?", "pqr*", "pqr+", "pq[rs]*", "pq[^rs]*", "pq[rs]{2}", "pq[rs]{2,}", "pq[rs]{2,4}",
+        "pqr|st[\"uv]", "(pqr)st+\\1", "(pqr)st(lm)uv\\2\\1", "[[:lower:]]*", "[[:punct:]]", "[[:w:]]", "[[:digit:]]"
+    };
+
+    std::vector<std::string> inputs = { "pqr", "pqrs", "pqrssr", "stu", "pqrsttpqr", "pqrstlmuvlmpqr", "7", "!", "pq",
+                                        "PQR", "PqRsS", "STU", "pqrSTtPQR" };
+    bool same = true;
+
+    std::regex_constants::syntax_option_type modes[] = { std::regex_constants::ECMAScript, std::regex_constants::icase };
+    for(std::size_t m = 0; m < 2; ++m)
+    {
+        RegexSet set(patterns, modes[m]);
+        std::cout << (m ? "icase, " : "") << set.size() << " patterns: " << set.literals() << " literal, " << set.combined()
+                  << " in the combined DFA, " << set.others() << " one by one" << std::endl;
+
+        for(std::size_t i = 0; i < inputs.size(); ++i)
+        {
+            std::vector<std::size_t> expected;
+            for(std::size_t p = 0; p < patterns.size(); ++p)
+                if(std::regex_match(inputs[i], std::regex(patterns[p], modes[m])))
+                    expected.push_back(p);
+
+            std::vector<std::size_t> found = set.matchAll(inputs[i]);
+            same = same && found == expected;
+            std::cout << inputs[i] << " matches " << found << std::endl;
+        }
+    }
+
+    // std::regex has no UTF-8 mode: with FastRegex::utf8 the set is compared with each FastRegex.
+    std::vector<std::string> utf8Patterns = { "caf.", "[\xc3\xa9]x", "caf\xc3\xa9", "[[:alpha:]]+", "\\w\\w.", "x|\xc3\xa9+" };
+    std::vector<std::string> utf8Inputs = { "caf\xc3\xa9", "\xc3\xa9x", "cafe", "\xc3\xa9\xc3\xa9", "\xc3\xa9", "x" };
+    RegexSet utf8Set(utf8Patterns, FastRegex::utf8);
+    for(std::size_t i = 0; i < utf8Inputs.size(); ++i)
+    {
+        std::vector<std::size_t> expected;
+        for(std::size_t p = 0; p < utf8Patterns.size(); ++p)
+            if(fast_regex_match(utf8Inputs[i], FastRegex(utf8Patterns[p], FastRegex::utf8)))
+                expected.push_back(p);
+
+        std::vector<std::size_t> found = utf8Set.matchAll(utf8Inputs[i]);
+        same = same && found == expected;
+        std::cout << "utf8, " << utf8Inputs[i] << " matches " << found << std::endl;
+    }
+    std::cout << "Same as regex_match with each pattern: " << std::boolalpha << same << std::endl;
+
+    std::cout << "----------------- Classifying lines against 300 patterns ----------------" << std::endl;
+    std::vector<std::string> many;
+    for(int i = 0; i < 100; ++i)
+    {
+        std::string n = std::to_string(i);
+        many.push_back("error" + n);                                // Literal
+        many.push_back("user" + n + "_[[:digit:]]+");               // Combined DFA
+        many.push_back("([[:w:]]+)://host" + n + ".([[:w:]]+)");    // Combined DFA
+    }
+    std::vector<std::string> lines;
+    for(int i = 0; i < 1000; ++i)
+        lines.push_back("GET /index.html user" + std::to_string(i % 150) + "_42 from https://host" + std::to_string(i % 120) + ".org error" + std::to_string(i % 97));
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    RegexSet manySet(many);
+    std::size_t setHits = 0;
+    for(std::size_t i = 0; i < lines.size(); ++i)
+        setHits += manySet.searchAll(lines[i]).size();
+    double setSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    t0 = std::chrono::steady_clock::now();
+    std::vector<std::regex> regexes(many.begin(), many.end());
+    std::size_t oneByOneHits = 0;
+    for(std::size_t i = 0; i < lines.size(); ++i)
+        for(std::size_t p = 0; p < regexes.size(); ++p)
+            oneByOneHits += std::regex_search(lines[i], regexes[p]);
+    double oneByOneSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::cout << "RegexSet::searchAll            : " << setHits << " matches in " << setSecs * 1000 << " ms" << std::endl;
+    std::cout << "std::regex_search per pattern  : " << oneByOneHits << " matches in " << oneByOneSecs * 1000 << " ms" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <iostream>
+#include <regex>
+#include <string>
+
+#define SAMPLE_COUNT_HEAP      // heapAllocations
+#include "regexDFA.h"
+#include "sampleUtil.h"
+
+/*********
+A program to show reading sub-matches without copying them.
+
+verifySubmatch() in 13_regularExp.cpp and the loop over rgit->str(i) in 14_regularExp_Iter.cpp print every
+sub-match through str(), which returns a new std::string: one heap allocation per sub-match(for the ones
+longer than the small string buffer), plus the ones for prefix().str() and suffix().str().
+
+The results of FastRegex(regexDFA.h) also give views of the sub-matches:
+
+    m.view(n)           a fast_string_view(pointer + length) of the sub-match n, into the target itself
+    m.prefix_view()     the same for the prefix
+    m.suffix_view()     and for the suffix
+
+A fast_string_view is only valid while the target is. It can be printed, compared, and copied into a
+std::string with str() when the text has to outlive the target.
+
+A results object keeps its buffers from one search to the next, so a loop that reuses one(a fast_cmatch passed
+to fast_regex_search() each time) allocates nothing once the first match is found. A fast_regex_iterator holds
+its own results: it allocates them once when it is constructed, and nothing on ++.
+
+The global operator new of sampleUtil.h(SAMPLE_COUNT_HEAP) counts the allocations made by each loop.
+(Patterns that FastRegex hands over to std::regex, e.g. with back-references, still allocate inside std::regex.)
+
+Not copying is not the same as being faster: here both view loops take about twice the time of
+std::sregex_iterator with str(). Finding where a match ends is the lazy DFA's job, and it is quick(a small part
+of the std loop), but the sub-matches are then read by the Pike VM, which runs every thread in step over the text
+from the start of the search and copies the capture positions of each thread as it goes. On short targets with
+a match at almost every start, as below, std::regex's backtracking is cheaper than that. The views pay off where
+the allocations are what costs: long sub-matches, many threads sharing one heap, or a loop that must not allocate.
+*********/
+
+// For measure(): the allocations made by the global operator new
+unsigned long heapAllocationCount() { return heapAllocations.load(); }
+
+// verifySubmatch() of 13_regularExp.cpp with views
+void verifySubmatch()
+{
+    std::string str = "{sample prefix}https://www.google.com{A sample suffix}";
+    std::cout << "str: " << str << std::endl;
+
+    fast_smatch sm;
+    FastRegex r("([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)");    // Matches a web URL
+
+    fast_regex_search(str, sm, r);
+
+    for(std::size_t i = 0; i < sm.size(); ++i)
+        std::cout << "sm[" << i << "]: " << sm.view(i) << std::endl;
+
+    std::cout << "sm.prefix: " << sm.prefix_view() << std::endl;
+    std::cout << "sm.suffix: " << sm.suffix_view() << std::endl;
+    std::cout << "sm[3] == \"google\": " << std::boolalpha << (sm.view(3) == "google") << std::endl;
+}
+
+// The loop of 14_regularExp_Iter.cpp, run many times. Returns the number of characters seen(so the work is not dropped).
+std::size_t stdLoop(const std::string& strs, const std::regex& r, int times)
+{
+    std::size_t chars = 0;
+    for(int n = 0; n < times; ++n)
+        for(std::sregex_iterator rgit(strs.begin(), strs.end(), r), rgend; rgit != rgend; ++rgit)
+            for(std::size_t i = 0; i < rgit->size(); ++i)
+                chars += rgit->str(i).size();
+    return chars;
+}
+
+std::size_t viewLoop(const std::string& strs, const FastRegex& r, int times)
+{
+    std::size_t chars = 0;
+    for(int n = 0; n < times; ++n)
+        for(fast_sregex_iterator rgit(strs.begin(), strs.end(), r), rgend; rgit != rgend; ++rgit)
+            for(std::size_t i = 0; i < rgit->size(); ++i)
+                chars += rgit->view(i).size();
+    return chars;
+}
+
+// One fast_cmatch reused by every search of the loop(the pattern never matches an empty sequence, so p always moves on)
+std::size_t reusedResults(const std::string& strs, const FastRegex& r, int times, fast_cmatch& m)
+{
+    std::size_t chars = 0;
+    const char* e = strs.data() + strs.size();
+    for(int n = 0; n < times; ++n)
+    {
+        std::regex_constants::match_flag_type flags = std::regex_constants::match_default;
+        for(const char* p = strs.data(); fast_regex_search(p, e, m, r, flags); p = m[0].second)
+        {
+            for(std::size_t i = 0; i < m.size(); ++i)
+                chars += m.view(i).size();
+            flags = std::regex_constants::match_prev_avail;
+        }
+    }
+    return chars;
+}
+
+int main()
+{
+    std::cout << "----------------- verifySubmatch ----------------" << std::endl;
+    verifySubmatch();
+
+    std::cout << "----------------- Allocations in steady state ----------------" << std::endl;
+    // Long enough host names that a std::string copy cannot use the small string buffer
+    std::string strs = "https://www.a-rather-long-host-name-for-google.com; http://www.another-long-host-name-yahoo.co.in;; "
+                       "http://www.the-gnu-project-web-server.org";
+    std::string pattern = "([[:w:]]+)://([[:w:]-]+).([[:w:]-]+).([[:w:]-]+)";
+    const int times = 20000;
+
+    std::regex sr(pattern);
+    FastRegex fr(pattern);
+    fast_cmatch m;
+
+    // Each loop is warmed up first: the DFA states and the result buffers are built there
+    stdLoop(strs, sr, 10);
+    double base = measure("std::sregex_iterator + str(i)     ", [&]() { return stdLoop(strs, sr, times); },
+                          times, 0, heapAllocationCount, "pass");
+    viewLoop(strs, fr, 10);
+    measure("fast_sregex_iterator + view(i)    ", [&]() { return viewLoop(strs, fr, times); },
+            times, base, heapAllocationCount, "pass");
+    reusedResults(strs, fr, 10, m);
+    measure("fast_regex_search, reused results ", [&]() { return reusedResults(strs, fr, times, m); },
+            times, base, heapAllocationCount, "pass");
+
+    unsigned long before = heapAllocations.load();
+    reusedResults(strs, fr, times, m);
+    bool none = heapAllocations.load() == before;
+    std::cout << "No allocation in steady state: " << std::boolalpha << none << std::endl;
+
+    return none ? 0 : 1;
+}
@@ -0,0 +1,330 @@
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+
+#include "regexDFA.h"
+
+/*********
+A program to show running std::regex_replace on a large input with several threads.
+
+The two regex_replace calls of 14_regularExp_Iter.cpp,
+
+    regex_replace(strs, r, "\n$3 is accessed via $1")
+    regex_replace(strs, r, "\n$3 is accessed via $1", std::regex_constants::format_no_copy)
+
+run on a single thread, whatever the size of the input.
+
+ParallelReplace cuts the input into chunks just after a record delimiter(a newline, or the ';' between the URLs
+of strs), replaces each chunk with std::regex_replace on a ThreadPool, and joins the results in order.
+
+The output is the one of a single std::regex_replace over the whole input only if cutting changes no match, so a
+delimiter is used only when the pattern (parsed by RegexParser of regexDFA.h) shows that:
+
+    - no match can contain the delimiter: no character class of the pattern holds it. With the URL pattern,
+      '.' matches ';' ("http://www.gnu;org" is one match), so only a newline is a safe delimiter there.
+    - the pattern cannot match an empty sequence, that would be found at the end of a chunk and again at the
+      beginning of the next one.
+
+Each chunk but the first is replaced with match_prev_avail (the character before it is looked at for ^ and \b),
+each one but the last with match_not_eol. When no delimiter is safe, or the pattern cannot be parsed(e.g. it has
+\b), with format_first_only, or when the format holds $` or $' (the text before or after a match, which a chunk
+does not have), the input is replaced by a single std::regex_replace.
+
+Usage: 30_regexParallelReplace [MB of input(default 64), e.g. 1024 for 1 GB]
+*********/
+
+// A fixed set of threads running the tasks of a queue, in the order they are submitted.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned threads):_stop(false)
+    {
+        for(unsigned i = 0; i < std::max(threads, 1u); ++i)
+            _threads.push_back(std::thread(&ThreadPool::work, this));
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _ready.notify_all();
+        for(auto & t : _threads)
+            t.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const { return _threads.size(); }
+
+    // The future gets the result of task(), or the exception it threw.
+    template<class Task>
+    std::future<typename std::result_of<Task()>::type> submit(Task task)
+    {
+        typedef typename std::result_of<Task()>::type Result;
+        std::shared_ptr<std::packaged_task<Result()> > job = std::make_shared<std::packaged_task<Result()> >(task);
+        std::future<Result> result = job->get_future();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.push([job]() { (*job)(); });
+        }
+        _ready.notify_one();
+        return result;
+    }
+
+private:
+    void work()
+    {
+        for(;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _ready.wait(lock, [this]() { return _stop || !_tasks.empty(); });
+                if(_tasks.empty())
+                    return;     // Stopped, and nothing left to run
+                task = std::move(_tasks.front());
+                _tasks.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> _threads;
+    std::queue<std::function<void()> > _tasks;
+    std::mutex _mutex;
+    std::condition_variable _ready;
+    bool _stop;
+};
+
+class ParallelReplace
+{
+public:
+    // delimiters: the characters to cut the input after, the first one that is safe for the pattern is used.
+    ParallelReplace(const std::string& pattern, std::regex_constants::syntax_option_type f, ThreadPool& pool,
+                    const std::string& delimiters = "\n;")
+        :_re(pattern, f), _pool(pool), _delimiter(0), _cut(false)
+    {
+        if(!(f & std::regex_constants::ECMAScript) && (f & (std::regex_constants::basic | std::regex_constants::extended |
+           std::regex_constants::awk | std::regex_constants::grep | std::regex_constants::egrep)))
+            return;     // RegexParser reads the ECMAScript grammar only
+
+        try
+        {
+            RegexParser parser(pattern, FastRegex::parserMode(f));     // Folded with icase, as FastRegex parses it
+            RegexNodePtr root = parser.parse();
+            if(FastRegex::nullable(*root))
+                return;
+            for(std::size_t i = 0; i < delimiters.size() && !_cut; ++i)
+            {
+                if(!contains(*root, delimiters[i]))
+                {
+                    _delimiter = delimiters[i];
+                    _cut = true;
+                }
+            }
+        }
+        catch(const RegexParser::Unsupported&)
+        {
+        }
+    }
+
+    const std::regex& regex() const     { return _re; }
+
+    // The delimiter the input is cut at, or 0 if it is never cut.
+    char delimiter() const              { return _cut ? _delimiter : 0; }
+
+    std::string replace(const std::string& s, const std::string& fmt,
+                        std::regex_constants::match_flag_type flags = std::regex_constants::match_default) const
+    {
+        using namespace std::regex_constants;
+
+        std::vector<std::size_t> cuts = chunks(s);
+        if(cuts.size() <= 2 || (flags & format_first_only) || (!(flags & format_sed) && usesPrefixOrSuffix(fmt)))
+            return std::regex_replace(s, _re, fmt, flags);
+
+        std::vector<std::future<std::string> > parts;
+        for(std::size_t i = 0; i + 1 < cuts.size(); ++i)
+        {
+            const char* first = s.data() + cuts[i];
+            const char* last = s.data() + cuts[i + 1];
+            match_flag_type mf = flags;
+            if(i > 0)
+                mf |= match_prev_avail;
+            if(i + 2 < cuts.size())
+                mf |= match_not_eol;
+
+            const std::regex& re = _re;
+            parts.push_back(_pool.submit([first, last, &re, &fmt, mf]() {
+                std::string out;
+                out.reserve(last - first);
+                std::regex_replace(std::back_inserter(out), first, last, re, fmt, mf);
+                return out;
+            }));
+        }
+
+        // The tasks hold fmt, _re and pointers into s: all of them have finished before an exception leaves.
+        for(std::size_t i = 0; i < parts.size(); ++i)
+            parts[i].wait();
+
+        std::vector<std::string> results;
+        std::size_t total = 0;
+        for(std::size_t i = 0; i < parts.size(); ++i)
+        {
+            results.push_back(parts[i].get());      // Rethrows the exception of the first chunk that failed
+            total += results.back().size();
+        }
+
+        std::string out;
+        out.reserve(total);
+        for(std::size_t i = 0; i < results.size(); ++i)
+            out += results[i];
+        return out;
+    }
+
+private:
+    // Does fmt hold $` or $'? The prefix and suffix of a match would stop at the cut of its chunk.
+    static bool usesPrefixOrSuffix(const std::string& fmt)
+    {
+        for(std::size_t i = 0; i + 1 < fmt.size(); ++i)
+        {
+            if(fmt[i] != '$')
+                continue;
+            if(fmt[i + 1] == '`' || fmt[i + 1] == '\'')
+                return true;
+            if(fmt[i + 1] == '$')
+                ++i;        // $$ is a '$'
+        }
+        return false;
+    }
+
+    // The offsets where the chunks begin, followed by the size of s: a few chunks per thread, for the balance.
+    std::vector<std::size_t> chunks(const std::string& s) const
+    {
+        std::vector<std::size_t> cuts(1, 0);
+        if(_cut)
+        {
+            std::size_t count = _pool.size() * 4;
+            std::size_t step = std::max<std::size_t>(s.size() / count, 1 << 16);
+            for(std::size_t pos = step; pos < s.size(); pos = cuts.back() + step)
+            {
+                const void* d = std::memchr(s.data() + pos, _delimiter, s.size() - pos);
+                if(!d)
+                    break;
+                cuts.push_back(static_cast<const char*>(d) - s.data() + 1);
+            }
+        }
+        if(cuts.back() != s.size())
+            cuts.push_back(s.size());
+        return cuts;
+    }
+
+    // Can a match contain c? (An icase pattern is parsed folded: its classes hold both cases.)
+    static bool contains(const RegexNode& n, char c)
+    {
+        if(n.kind == RegexNode::Bytes)
+            return n.set[static_cast<unsigned char>(c)];
+        for(std::size_t i = 0; i < n.kids.size(); ++i)
+            if(contains(*n.kids[i], c))
+                return true;
+        return false;
+    }
+
+    std::regex _re;
+    ThreadPool& _pool;
+    char _delimiter;
+    bool _cut;
+};
+
+// A log of lines holding URLs like strs of 14_regularExp_Iter.cpp
+std::string makeInput(std::size_t bytes)
+{
+    std::string strs = "https://www.google.com; http://www.yahoo.co.in;; http://www.gnu.org\n";
+    std::string block;
+    for(int i = 0; i < 1000; ++i)
+        block += (i % 3 == 0) ? strs : "GET /index.html 200 " + std::to_string(i) + "; no url on this line\n";
+
+    std::string input;
+    input.reserve(bytes + block.size());
+    while(input.size() < bytes)
+        input += block;
+    return input;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string strs = "https://www.google.com; http://www.yahoo.co.in;; http://www.gnu.org";
+    const char* pattern = "([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)";
+    const char* fmt = "\n$3 is accessed via $1";
+
+    ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u));
+
+    std::cout << "----------------- Choosing the delimiter ----------------" << std::endl;
+    ParallelReplace url(pattern, std::regex_constants::icase, pool);
+    ParallelReplace fields("[^;]+", std::regex_constants::ECMAScript, pool);
+    ParallelReplace digits("[[:digit:]]*", std::regex_constants::ECMAScript, pool);
+    std::cout << pattern << ": cut at " << (url.delimiter() == '\n' ? "newlines" : "nothing") << std::endl;
+    std::cout << "[^;]+: cut at '" << fields.delimiter() << "'" << std::endl;
+    std::cout << "[[:digit:]]*: cut " << (digits.delimiter() ? "" : "nowhere, it can match an empty sequence") << std::endl;
+
+    std::cout << "----------------- Same output as regex_replace ----------------" << std::endl;
+    std::string small = makeInput(1 << 20);
+    bool same = url.replace(small, fmt) == std::regex_replace(small, url.regex(), fmt) &&
+                url.replace(small, fmt, std::regex_constants::format_no_copy) ==
+                    std::regex_replace(small, url.regex(), fmt, std::regex_constants::format_no_copy) &&
+                fields.replace(small, "<$&>") == std::regex_replace(small, fields.regex(), "<$&>") &&
+                digits.replace(small, "#") == std::regex_replace(small, digits.regex(), "#");
+
+    // $` and $' reach past the chunk of a match: few matches, so that their output stays small
+    std::string sparse;
+    for(int i = 0; sparse.size() < (256 << 10); ++i)
+        sparse += std::to_string(i * 7919) + (i % 500 == 0 ? " word\n" : " 200 0\n");
+    ParallelReplace words("[a-z]+", std::regex_constants::ECMAScript, pool);
+    const char* formats[] = { "<$`>", "[$']", "$$'", "<$&>" };
+    for(const char* f : formats)
+        same = same && words.replace(sparse, f) == std::regex_replace(sparse, words.regex(), f);
+    std::cout << url.replace(strs, fmt, std::regex_constants::format_no_copy) << std::endl;
+    std::cout << "Same output as a single regex_replace: " << std::boolalpha << same << std::endl;
+
+    std::cout << "----------------- Scaling with the threads ----------------" << std::endl;
+    std::size_t mb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    std::string input = makeInput(mb << 20);
+    std::cout << input.size() / (1024 * 1024) << " MB, " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    std::string expected = std::regex_replace(input, url.regex(), fmt);
+    double seqSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "regex_replace      : " << seqSecs * 1000 << " ms" << std::endl;
+
+    std::vector<unsigned> counts;
+    for(unsigned threads = 1; threads < pool.size(); threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(static_cast<unsigned>(pool.size()));
+
+    for(unsigned threads : counts)
+    {
+        ThreadPool some(threads);
+        ParallelReplace replacer(pattern, std::regex_constants::icase, some);
+
+        t0 = std::chrono::steady_clock::now();
+        std::string out = replacer.replace(input, fmt);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        std::cout << threads << " thread(s)        : " << secs * 1000 << " ms, speedup " << seqSecs / secs
+                  << ", same: " << (out == expected) << std::endl;
+    }
+
+    return same ? 0 : 1;
+}
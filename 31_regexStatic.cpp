@@ -0,0 +1,746 @@
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <chrono>
+
+/*********
+A program to show compiling a regular expression at compile time.
+
+The patterns of 13_regularExp.cpp ("[[:digit:]]", "^pqr.+", the URL pattern ...) are string literals, known when
+the program is compiled, yet every std::regex r("...") parses the pattern and builds its automaton at run time,
+on the heap.
+
+StaticRegex<Pattern> reads a pattern that is a constexpr character array:
+
+    constexpr char url[] = "([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)";
+    StaticRegex<url>::search(str, &m);
+
+    - The pattern is checked by constexpr functions, and static_assert reports anything outside the supported
+      subset as a compile error, e.g. "StaticRegex: back-references are not supported".
+    - Each element of the pattern becomes a template(Seq<P, I, K>: the element at offset I followed by the
+      continuation K), so the compiler generates a matcher specialized for the pattern. A character class becomes
+      a 256 entry table built by constexpr evaluation.
+    - Nothing is compiled at run time and nothing is allocated: the sub-matches are kept in a fixed size array.
+
+Matching backtracks in the order ECMAScript (and std::regex) does: alternatives from the left, greedy quantifiers
+longest first, lazy ones shortest first, so a match and its sub-matches are the ones std::regex finds.
+
+The supported subset (the default ECMAScript grammar, no flags):
+    characters, '.', escapes \d \D \w \W \s \S \n \t \r \f \v and escaped punctuation
+    [...] and [^...] with ranges, escapes and [:class:] names of the "C" locale
+    groups (...) and (?:...), alternatives |, anchors ^ $
+    quantifiers * + ? {n} {n,} {n,m} and their lazy forms (*? ...) on a single character element,
+    * + ? on a group (a repeated group cannot hold another capturing group)
+
+Not supported, reported by static_assert: back-references, \b \B, lookaheads (?= (?!, {n,m} on a group,
+other escapes, unbalanced parentheses and brackets, quantifiers with nothing to repeat.
+
+NOTE: Kindly compile with -DSHOW_STATIC_REGEX_ERROR to see the error reported for "(pqr)st\\1".
+*********/
+
+namespace static_regex
+{
+    const std::size_t npos = static_cast<std::size_t>(-1);
+
+    enum Error { None, Unbalanced, NothingToRepeat, BadBrace, BadClass, BadEscape, Backref, WordBoundary, Lookaround,
+                 GroupCount, NestedCapture };
+
+    constexpr unsigned char uc(char c)      { return static_cast<unsigned char>(c); }
+    constexpr bool isDigit(char c)          { return c >= '0' && c <= '9'; }
+    constexpr bool isQuantifier(char c)     { return c == '*' || c == '+' || c == '?' || c == '{'; }
+    constexpr std::size_t length(const char* p, std::size_t i = 0) { return p[i] ? length(p, i + 1) : i; }
+
+    // ----- The extent of the elements -----
+
+    // [:name:], j just after "[:": the offset after ":]"
+    constexpr std::size_t namedEnd(const char* p, std::size_t j)
+    {
+        return p[j] == '\0' ? npos : (p[j] == ':' && p[j + 1] == ']') ? j + 2 : namedEnd(p, j + 1);
+    }
+
+    // i on '[': where the members begin
+    constexpr std::size_t classBody(const char* p, std::size_t i) { return p[i + 1] == '^' ? i + 2 : i + 1; }
+
+    // The offset after the ']' closing the class, j on a member.
+    constexpr std::size_t classEnd(const char* p, std::size_t j)
+    {
+        return p[j] == '\0' ? npos
+             : p[j] == ']' ? j + 1
+             : p[j] == '\\' ? (p[j + 1] ? classEnd(p, j + 2) : npos)
+             : (p[j] == '[' && p[j + 1] == ':') ? (namedEnd(p, j + 2) == npos ? npos : classEnd(p, namedEnd(p, j + 2)))
+             : classEnd(p, j + 1);
+    }
+
+    // i on '(': where the alternatives of the group begin
+    constexpr std::size_t groupBody(const char* p, std::size_t i) { return (p[i + 1] == '?' && p[i + 2] == ':') ? i + 3 : i + 1; }
+    constexpr bool capturing(const char* p, std::size_t i)          { return p[i + 1] != '?'; }
+
+    constexpr std::size_t closeParen(const char* p, std::size_t j);
+
+    // The offset after the element at i(a character, an escape, a class or a group), npos if it is not closed.
+    constexpr std::size_t atomEnd(const char* p, std::size_t i)
+    {
+        return p[i] == '\\' ? (p[i + 1] ? i + 2 : npos)
+             : p[i] == '[' ? classEnd(p, classBody(p, i))
+             : p[i] == '(' ? closeParen(p, groupBody(p, i))
+             : i + 1;
+    }
+
+    // The offset after the ')' closing a group, j inside the group.
+    constexpr std::size_t closeParen(const char* p, std::size_t j)
+    {
+        return j == npos || p[j] == '\0' ? npos : p[j] == ')' ? j + 1 : closeParen(p, atomEnd(p, j));
+    }
+
+    // ----- Quantifiers, a on the character after the element -----
+
+    constexpr std::size_t skipDigits(const char* p, std::size_t j) { return isDigit(p[j]) ? skipDigits(p, j + 1) : j; }
+    constexpr int number(const char* p, std::size_t j, int v)       { return isDigit(p[j]) ? number(p, j + 1, v * 10 + (p[j] - '0')) : v; }
+
+    constexpr std::size_t braceEnd(const char* p, std::size_t j)
+    {
+        return p[j] == '}' ? j + 1 : (isDigit(p[j]) || p[j] == ',') ? braceEnd(p, j + 1) : npos;
+    }
+
+    constexpr std::size_t lazyEnd(const char* p, std::size_t j) { return j != npos && p[j] == '?' ? j + 1 : j; }
+
+    constexpr std::size_t quantEnd(const char* p, std::size_t a)
+    {
+        return (p[a] == '*' || p[a] == '+' || p[a] == '?') ? lazyEnd(p, a + 1) : p[a] == '{' ? lazyEnd(p, braceEnd(p, a + 1)) : a;
+    }
+
+    constexpr int quantMin(const char* p, std::size_t a)
+    {
+        return (p[a] == '*' || p[a] == '?') ? 0 : p[a] == '{' ? number(p, a + 1, 0) : 1;
+    }
+
+    // -1: unbounded
+    constexpr int quantMax(const char* p, std::size_t a)
+    {
+        return (p[a] == '*' || p[a] == '+') ? -1
+             : p[a] == '?' ? 1
+             : p[a] != '{' ? 1
+             : p[skipDigits(p, a + 1)] != ',' ? number(p, a + 1, 0)
+             : p[skipDigits(p, a + 1) + 1] == '}' ? -1
+             : number(p, skipDigits(p, a + 1) + 1, 0);
+    }
+
+    constexpr bool quantLazy(const char* p, std::size_t a)
+    {
+        return quantEnd(p, a) > a + 1 && p[quantEnd(p, a) - 1] == '?';
+    }
+
+    // {n}, {n,} or {n,m} with n <= m
+    constexpr bool braceValid(const char* p, std::size_t a)
+    {
+        return skipDigits(p, a + 1) > a + 1 &&
+               (p[skipDigits(p, a + 1)] == '}' ||
+                (p[skipDigits(p, a + 1)] == ',' && p[skipDigits(p, skipDigits(p, a + 1) + 1)] == '}' &&
+                 (quantMax(p, a) < 0 || quantMin(p, a) <= quantMax(p, a))));
+    }
+
+    // The end of the alternative beginning at i: on '|', ')' or the end of the pattern.
+    constexpr std::size_t altEnd(const char* p, std::size_t i)
+    {
+        return (p[i] == '\0' || p[i] == '|' || p[i] == ')') ? i : altEnd(p, quantEnd(p, atomEnd(p, i)));
+    }
+
+    // The capturing groups opened in [i, end)
+    constexpr int captures(const char* p, std::size_t i, std::size_t end)
+    {
+        return (i >= end || p[i] == '\0') ? 0
+             : p[i] == '\\' ? captures(p, i + 2, end)
+             : p[i] == '[' ? captures(p, classEnd(p, classBody(p, i)), end)
+             : p[i] == '(' ? (capturing(p, i) ? 1 : 0) + captures(p, i + 1, end)
+             : captures(p, i + 1, end);
+    }
+
+    // ----- The characters an element matches -----
+
+    constexpr bool isLower(unsigned char c) { return c >= 'a' && c <= 'z'; }
+    constexpr bool isUpper(unsigned char c) { return c >= 'A' && c <= 'Z'; }
+    constexpr bool isDigitC(unsigned char c){ return c >= '0' && c <= '9'; }
+    constexpr bool isAlnum(unsigned char c) { return isLower(c) || isUpper(c) || isDigitC(c); }
+    constexpr bool isSpace(unsigned char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+    constexpr bool isPrint(unsigned char c) { return c >= 0x20 && c < 0x7f; }
+    constexpr bool isWord(unsigned char c)  { return isAlnum(c) || c == '_'; }
+
+    // The name of [:name:] beginning at j is n
+    constexpr bool nameIs(const char* p, std::size_t j, const char* n)
+    {
+        return *n == '\0' ? p[j] == ':' : p[j] == *n && nameIs(p, j + 1, n + 1);
+    }
+
+    constexpr bool knownName(const char* p, std::size_t j)
+    {
+        return nameIs(p, j, "alnum") || nameIs(p, j, "alpha") || nameIs(p, j, "blank") || nameIs(p, j, "cntrl") ||
+               nameIs(p, j, "digit") || nameIs(p, j, "d") || nameIs(p, j, "graph") || nameIs(p, j, "lower") ||
+               nameIs(p, j, "print") || nameIs(p, j, "punct") || nameIs(p, j, "space") || nameIs(p, j, "s") ||
+               nameIs(p, j, "upper") || nameIs(p, j, "w") || nameIs(p, j, "xdigit");
+    }
+
+    // Classes of the "C" locale, bytes above 127 belong to none of them.
+    constexpr bool named(const char* p, std::size_t j, unsigned char c)
+    {
+        return nameIs(p, j, "alnum") ? isAlnum(c)
+             : nameIs(p, j, "alpha") ? isLower(c) || isUpper(c)
+             : nameIs(p, j, "blank") ? c == ' ' || c == '\t'
+             : nameIs(p, j, "cntrl") ? c < 0x20 || c == 0x7f
+             : (nameIs(p, j, "digit") || nameIs(p, j, "d")) ? isDigitC(c)
+             : nameIs(p, j, "graph") ? isPrint(c) && c != ' '
+             : nameIs(p, j, "lower") ? isLower(c)
+             : nameIs(p, j, "print") ? isPrint(c)
+             : nameIs(p, j, "punct") ? isPrint(c) && c != ' ' && !isAlnum(c)
+             : (nameIs(p, j, "space") || nameIs(p, j, "s")) ? isSpace(c)
+             : nameIs(p, j, "upper") ? isUpper(c)
+             : nameIs(p, j, "w") ? isWord(c)
+             : nameIs(p, j, "xdigit") ? isDigitC(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')
+             : false;
+    }
+
+    constexpr bool escapeHas(char e, unsigned char c)
+    {
+        return e == 'd' ? isDigitC(c) : e == 'D' ? !isDigitC(c)
+             : e == 'w' ? isWord(c) : e == 'W' ? !isWord(c)
+             : e == 's' ? isSpace(c) : e == 'S' ? !isSpace(c)
+             : e == 'n' ? c == '\n' : e == 't' ? c == '\t' : e == 'r' ? c == '\r'
+             : e == 'f' ? c == '\f' : e == 'v' ? c == '\v'
+             : uc(e) == c;
+    }
+
+    // c is one of the members of the class from j on
+    constexpr bool classHas(const char* p, std::size_t j, unsigned char c)
+    {
+        return p[j] == ']' ? false
+             : (p[j] == '[' && p[j + 1] == ':') ? named(p, j + 2, c) || classHas(p, namedEnd(p, j + 2), c)
+             : p[j] == '\\' ? escapeHas(p[j + 1], c) || classHas(p, j + 2, c)
+             : (p[j + 1] == '-' && p[j + 2] != ']') ? (c >= uc(p[j]) && c <= uc(p[j + 2])) || classHas(p, j + 3, c)
+             : uc(p[j]) == c || classHas(p, j + 1, c);
+    }
+
+    constexpr bool classValid(const char* p, std::size_t j)
+    {
+        return p[j] == ']' ? true
+             : (p[j] == '[' && p[j + 1] == ':') ? knownName(p, j + 2) && classValid(p, namedEnd(p, j + 2))
+             : p[j] == '\\' ? classValid(p, j + 2)
+             : (p[j + 1] == '-' && p[j + 2] != ']') ? uc(p[j]) <= uc(p[j + 2]) && classValid(p, j + 3)
+             : classValid(p, j + 1);
+    }
+
+    // The single character element at i matches c: '.' (not a line terminator), an escape, a class or a character.
+    constexpr bool atomHas(const char* p, std::size_t i, unsigned char c)
+    {
+        return p[i] == '.' ? c != '\n' && c != '\r'
+             : p[i] == '\\' ? escapeHas(p[i + 1], c)
+             : p[i] == '[' ? (p[i + 1] == '^') != classHas(p, classBody(p, i), c)
+             : uc(p[i]) == c;
+    }
+
+    // ----- Checking the pattern -----
+
+    constexpr Error check(const char* p, std::size_t i, int depth);
+
+    // The element [i, a) is followed by an optional quantifier at a.
+    constexpr Error checkQuant(const char* p, std::size_t a, int depth)
+    {
+        return !isQuantifier(p[a]) ? check(p, a, depth)
+             : (p[a] == '{' && !braceValid(p, a)) ? BadBrace
+             : isQuantifier(p[quantEnd(p, a)]) ? NothingToRepeat
+             : check(p, quantEnd(p, a), depth);
+    }
+
+    constexpr Error checkEscape(const char* p, std::size_t i, int depth)
+    {
+        return p[i + 1] == '\0' ? BadEscape
+             : (p[i + 1] >= '1' && p[i + 1] <= '9') ? Backref
+             : (p[i + 1] == 'b' || p[i + 1] == 'B') ? WordBoundary
+             : ((p[i + 1] >= 'a' && p[i + 1] <= 'z') || (p[i + 1] >= 'A' && p[i + 1] <= 'Z') || p[i + 1] == '0') &&
+               !(p[i + 1] == 'd' || p[i + 1] == 'D' || p[i + 1] == 'w' || p[i + 1] == 'W' || p[i + 1] == 's' ||
+                 p[i + 1] == 'S' || p[i + 1] == 'n' || p[i + 1] == 't' || p[i + 1] == 'r' || p[i + 1] == 'f' ||
+                 p[i + 1] == 'v') ? BadEscape
+             : checkQuant(p, i + 2, depth);
+    }
+
+    constexpr Error checkGroup(const char* p, std::size_t i, int depth)
+    {
+        return (p[i + 1] == '?' && p[i + 2] != ':') ? Lookaround
+             : closeParen(p, groupBody(p, i)) == npos ? Unbalanced
+             : p[closeParen(p, groupBody(p, i))] == '{' ? GroupCount
+             : (isQuantifier(p[closeParen(p, groupBody(p, i))]) &&
+                captures(p, groupBody(p, i), closeParen(p, groupBody(p, i))) > 0) ? NestedCapture
+             : check(p, groupBody(p, i), depth + 1);
+    }
+
+    constexpr Error check(const char* p, std::size_t i, int depth)
+    {
+        return p[i] == '\0' ? (depth == 0 ? None : Unbalanced)
+             : p[i] == '|' ? check(p, i + 1, depth)
+             : p[i] == ')' ? (depth == 0 ? Unbalanced : checkQuant(p, i + 1, depth - 1))
+             : isQuantifier(p[i]) ? NothingToRepeat
+             : (p[i] == '^' || p[i] == '$') ? (isQuantifier(p[i + 1]) ? NothingToRepeat : check(p, i + 1, depth))
+             : p[i] == '(' ? checkGroup(p, i, depth)
+             : p[i] == '\\' ? checkEscape(p, i, depth)
+             : p[i] == '[' ? ((classEnd(p, classBody(p, i)) == npos || !classValid(p, classBody(p, i))) ? BadClass
+                             : checkQuant(p, classEnd(p, classBody(p, i)), depth))
+             : checkQuant(p, i + 1, depth);
+    }
+
+    // ----- The matcher -----
+
+    template<std::size_t... N> struct Indices {};
+    template<std::size_t K, std::size_t... N> struct MakeIndices : MakeIndices<K - 1, K - 1, N...> {};
+    template<std::size_t... N> struct MakeIndices<0, N...> { typedef Indices<N...> type; };
+
+    // The characters matched by the single character element at I, as a table computed at compile time.
+    template<const char* P, std::size_t I, class Seq = typename MakeIndices<256>::type> struct CharSet;
+
+    template<const char* P, std::size_t I, std::size_t... N>
+    struct CharSet<P, I, Indices<N...> >
+    {
+        static constexpr bool table[256] = { atomHas(P, I, static_cast<unsigned char>(N))... };
+        static bool has(char c) { return table[uc(c)]; }
+    };
+
+    template<const char* P, std::size_t I, std::size_t... N>
+    constexpr bool CharSet<P, I, Indices<N...> >::table[256];
+
+    // The state of a match: the sub-matches, and the start of the current iteration of each repeated group.
+    template<std::size_t Groups, std::size_t Length>
+    struct Context
+    {
+        const char* b;
+        const char* e;
+        bool full;                          // The match has to end at e(regex_match)
+        const char* caps[2 * Groups];
+        const char* open[Groups];           // Where each group began, until it is closed
+        const char* loop[Length + 1];       // Indexed by the offset of the repeated group in the pattern
+    };
+
+    // The end of the pattern
+    struct Accept
+    {
+        template<class Ctx> static bool match(Ctx& c, const char* p)
+        {
+            if(c.full && p != c.e)
+                return false;
+            c.caps[1] = p;
+            return true;
+        }
+    };
+
+    enum Kind { End, Begin, Finish, One, Group };
+
+    constexpr Kind kindOf(const char* p, std::size_t i)
+    {
+        return (p[i] == '\0' || p[i] == '|' || p[i] == ')') ? End
+             : p[i] == '^' ? Begin : p[i] == '$' ? Finish : p[i] == '(' ? Group : One;
+    }
+
+    // The elements from I to the end of the alternative, followed by K.
+    template<const char* P, std::size_t I, class K, Kind = kindOf(P, I)> struct Seq;
+
+    // The alternatives from I on(up to the ')' of the group), each followed by K.
+    template<const char* P, std::size_t I, class K, bool More = P[altEnd(P, I)] == '|'>
+    struct Alt
+    {
+        template<class Ctx> static bool match(Ctx& c, const char* p)
+        {
+            return Seq<P, I, K>::match(c, p) || Alt<P, altEnd(P, I) + 1, K>::match(c, p);
+        }
+    };
+
+    template<const char* P, std::size_t I, class K>
+    struct Alt<P, I, K, false>
+    {
+        template<class Ctx> static bool match(Ctx& c, const char* p) { return Seq<P, I, K>::match(c, p); }
+    };
+
+    template<const char* P, std::size_t I, class K>
+    struct Seq<P, I, K, End>
+    {
+        template<class Ctx> static bool match(Ctx& c, const char* p) { return K::match(c, p); }
+    };
+
+    template<const char* P, std::size_t I, class K>
+    struct Seq<P, I, K, Begin>
+    {
+        template<class Ctx> static bool match(Ctx& c, const char* p) { return p == c.b && Seq<P, I + 1, K>::match(c, p); }
+    };
+
+    template<const char* P, std::size_t I, class K>
+    struct Seq<P, I, K, Finish>
+    {
+        template<class Ctx> static bool match(Ctx& c, const char* p) { return p == c.e && Seq<P, I + 1, K>::match(c, p); }
+    };
+
+    template<const char* P, std::size_t I, class K>
+    struct Seq<P, I, K, One>
+    {
+        static constexpr std::size_t A = atomEnd(P, I);
+        static constexpr std::size_t Q = quantEnd(P, A);
+        static constexpr int Min = quantMin(P, A);
+        static constexpr int Max = quantMax(P, A);
+        typedef CharSet<P, I> Set;
+        typedef Seq<P, Q, K> Next;
+
+        template<class Ctx> static bool match(Ctx& c, const char* p)
+        {
+            if(Q == A)
+                return p != c.e && Set::has(*p) && Next::match(c, p + 1);
+
+            int n = 0;
+            const char* q = p;
+            if(quantLazy(P, A))
+            {
+                for(; n < Min; ++n, ++q)
+                    if(q == c.e || !Set::has(*q))
+                        return false;
+                for(;; ++n, ++q)
+                {
+                    if(Next::match(c, q))
+                        return true;
+                    if(n == Max || q == c.e || !Set::has(*q))
+                        return false;
+                }
+            }
+
+            while(n != Max && q != c.e && Set::has(*q))
+                ++n, ++q;
+            for(; n >= Min; --n, --q)
+                if(Next::match(c, q))
+                    return true;
+            return false;
+        }
+    };
+
+    // ')' of the group at I: records the sub-match, then goes on with K.
+    template<const char* P, std::size_t I, class K>
+    struct Close
+    {
+        static constexpr int G = capturing(P, I) ? captures(P, 0, I) + 1 : 0;
+
+        template<class Ctx> static bool match(Ctx& c, const char* p)
+        {
+            if(G == 0)
+                return K::match(c, p);
+
+            const char* first = c.caps[2 * G];
+            const char* second = c.caps[2 * G + 1];
+            c.caps[2 * G] = c.open[G];
+            c.caps[2 * G + 1] = p;
+            if(K::match(c, p))
+                return true;
+            c.caps[2 * G] = first;
+            c.caps[2 * G + 1] = second;
+            return false;
+        }
+    };
+
+    // One pass through the group at I, followed by K.
+    template<const char* P, std::size_t I, class K>
+    struct Once
+    {
+        static constexpr int G = Close<P, I, K>::G;
+
+        template<class Ctx> static bool match(Ctx& c, const char* p)
+        {
+            const char* old = c.open[G];
+            c.open[G] = p;
+            if(Alt<P, groupBody(P, I), Close<P, I, K> >::match(c, p))
+                return true;
+            c.open[G] = old;
+            return false;
+        }
+    };
+
+    // Zero or more passes through the group at I, then K. An iteration matching nothing ends the loop(ECMAScript).
+    template<const char* P, std::size_t I, class K, bool Lazy>
+    struct Star
+    {
+        struct Again
+        {
+            template<class Ctx> static bool match(Ctx& c, const char* p)
+            {
+                return p != c.loop[I] && Star::match(c, p);
+            }
+        };
+
+        template<class Ctx> static bool match(Ctx& c, const char* p)
+        {
+            if(Lazy && K::match(c, p))
+                return true;
+
+            const char* old = c.loop[I];
+            c.loop[I] = p;
+            bool found = Once<P, I, Again>::match(c, p);
+            c.loop[I] = old;
+
+            return found || (!Lazy && K::match(c, p));
+        }
+    };
+
+    template<const char* P, std::size_t I, class K>
+    struct Seq<P, I, K, Group>
+    {
+        static constexpr std::size_t A = closeParen(P, groupBody(P, I));
+        static constexpr std::size_t Q = quantEnd(P, A);
+        typedef Seq<P, Q, K> Next;
+        typedef Star<P, I, Next, quantLazy(P, A)> Loop;
+
+        template<class Ctx> static bool match(Ctx& c, const char* p)
+        {
+            switch(Q == A ? '\0' : P[A])
+            {
+            case '*':   return Loop::match(c, p);
+            case '+':   return Once<P, I, Loop>::match(c, p);
+            case '?':
+                if(quantLazy(P, A))
+                    return Next::match(c, p) || Once<P, I, Next>::match(c, p);
+                return Once<P, I, Next>::match(c, p) || Next::match(c, p);
+            default:    return Once<P, I, Next>::match(c, p);
+            }
+        }
+    };
+}
+
+// The sub-matches found by StaticRegex, in a fixed size array: N is the number of groups plus one.
+template<std::size_t N>
+class StaticMatch
+{
+public:
+    StaticMatch():_base(nullptr)
+    {
+        for(std::size_t i = 0; i < 2 * N; ++i)
+            _sub[i] = nullptr;
+    }
+
+    std::size_t size() const                    { return N; }
+    bool matched(std::size_t n) const           { return _sub[2 * n] != nullptr; }
+    std::ptrdiff_t position(std::size_t n = 0) const { return matched(n) ? _sub[2 * n] - _base : -1; }
+    std::ptrdiff_t length(std::size_t n = 0) const   { return matched(n) ? _sub[2 * n + 1] - _sub[2 * n] : 0; }
+    const char* data(std::size_t n = 0) const   { return _sub[2 * n]; }
+    std::string str(std::size_t n = 0) const    { return matched(n) ? std::string(_sub[2 * n], length(n)) : std::string(); }
+
+private:
+    template<const char* P> friend class StaticRegex;
+
+    const char* _base;
+    const char* _sub[2 * N];
+};
+
+template<const char* P>
+class StaticRegex
+{
+    static constexpr static_regex::Error error = static_regex::check(P, 0, 0);
+
+    static_assert(error != static_regex::Unbalanced, "StaticRegex: unbalanced parentheses");
+    static_assert(error != static_regex::NothingToRepeat, "StaticRegex: a quantifier has nothing to repeat");
+    static_assert(error != static_regex::BadBrace, "StaticRegex: invalid {n,m} quantifier");
+    static_assert(error != static_regex::BadClass, "StaticRegex: invalid or unterminated [...] class");
+    static_assert(error != static_regex::BadEscape, "StaticRegex: unsupported escape");
+    static_assert(error != static_regex::Backref, "StaticRegex: back-references are not supported");
+    static_assert(error != static_regex::WordBoundary, "StaticRegex: \\b and \\B are not supported");
+    static_assert(error != static_regex::Lookaround, "StaticRegex: (?= and (?! are not supported");
+    static_assert(error != static_regex::GroupCount, "StaticRegex: {n,m} on a group is not supported");
+    static_assert(error != static_regex::NestedCapture, "StaticRegex: a repeated group cannot hold a capturing group");
+
+public:
+    static constexpr std::size_t groups = static_regex::captures(P, 0, static_regex::length(P));
+    typedef StaticMatch<groups + 1> match_type;
+
+    static const char* pattern()    { return P; }
+
+    // Matches the whole of [b, e), like std::regex_match
+    static bool match(const char* b, const char* e, match_type* m = nullptr)
+    {
+        Context c;
+        init(c, b, e, true);
+        return run(c, b, m);
+    }
+
+    // Finds the leftmost match in [b, e), like std::regex_search
+    static bool search(const char* b, const char* e, match_type* m = nullptr)
+    {
+        Context c;
+        init(c, b, e, false);
+        for(const char* s = b; ; ++s)
+        {
+            if(run(c, s, m))
+                return true;
+            if(s == e)
+                return false;
+        }
+    }
+
+    static bool match(const std::string& s, match_type* m = nullptr)  { return match(s.data(), s.data() + s.size(), m); }
+    static bool search(const std::string& s, match_type* m = nullptr) { return search(s.data(), s.data() + s.size(), m); }
+
+private:
+    typedef static_regex::Context<groups + 1, static_regex::length(P)> Context;
+
+    static void init(Context& c, const char* b, const char* e, bool full)
+    {
+        c.b = b;
+        c.e = e;
+        c.full = full;
+        for(std::size_t i = 0; i < 2 * (groups + 1); ++i)
+            c.caps[i] = nullptr;
+        for(std::size_t i = 0; i <= groups; ++i)
+            c.open[i] = nullptr;
+        for(std::size_t i = 0; i <= static_regex::length(P); ++i)
+            c.loop[i] = nullptr;
+    }
+
+    // Every capture is restored on the way back from a failed attempt, so c is clean for the next one.
+    static bool run(Context& c, const char* s, match_type* m)
+    {
+        c.caps[0] = s;
+        if(!static_regex::Alt<P, 0, static_regex::Accept>::match(c, s))
+            return false;
+        if(m)
+        {
+            m->_base = c.b;
+            for(std::size_t i = 0; i < 2 * (groups + 1); ++i)
+                m->_sub[i] = c.caps[i];
+        }
+        return true;
+    }
+};
+
+// The patterns have to be constexpr arrays to be template arguments.
+constexpr char digit[] = "[[:digit:]]";
+constexpr char startsPqr[] = "^pqr.+";
+constexpr char url[] = "([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)";
+constexpr char p1[] = "pqr";
+constexpr char p2[] = "pqr.";
+constexpr char p3[] = "pqr?";
+constexpr char p4[] = "pqr*";
+constexpr char p5[] = "pqr+";
+constexpr char p6[] = "pq[rs]*";
+constexpr char p7[] = "pq[^rs]*";
+constexpr char p8[] = "pq[rs]{2}";
+constexpr char p9[] = "pq[rs]{2,}";
+constexpr char p10[] = "pq[rs]{2,4}";
+constexpr char p11[] = "pqr|st[\"uv]";
+constexpr char p12[] = "[[:lower:]]*";
+constexpr char p13[] = "[[:punct:]]";
+constexpr char p14[] = "(a|ab)(c|bcd)(d*)";
+constexpr char p15[] = "(?:x+?y)+z|(q*)$";
+constexpr char p16[] = "(ab)*c|a(b?)";
+constexpr char p17[] = "^\\d{1,3}(\\.\\d{1,3})?\\s|\\w+?-";
+
+#if defined(SHOW_STATIC_REGEX_ERROR)
+constexpr char backref[] = "(pqr)st\\1";
+/***
+g++ -std=c++11 -DSHOW_STATIC_REGEX_ERROR 31_regexStatic.cpp
+
+    31_regexStatic.cpp: In instantiation of 'class StaticRegex<(& backref)>':
+    31_regexStatic.cpp:543:25: error: static assertion failed: StaticRegex: back-references are not supported
+      543 |     static_assert(error != static_regex::Backref, "StaticRegex: back-references are not supported");
+***/
+#endif
+
+// The sub-matches of both, in the same format
+template<class Static>
+std::string describe(bool found, const typename Static::match_type& m)
+{
+    std::string s = found ? "" : "no match";
+    for(std::size_t i = 0; found && i < m.size(); ++i)
+        s += std::to_string(m.position(i)) + ":" + std::to_string(m.length(i)) + " ";
+    return s;
+}
+
+std::string describe(bool found, const std::cmatch& m)
+{
+    std::string s = found ? "" : "no match";
+    for(std::size_t i = 0; found && i < m.size(); ++i)
+        s += std::to_string(m[i].matched ? m.position(i) : -1) + ":" + std::to_string(m[i].matched ? m.length(i) : 0) + " ";
+    return s;
+}
+
+// Compares StaticRegex with std::regex for regex_match and regex_search on each input.
+template<class Static>
+bool sameAsStd(const std::vector<std::string>& inputs)
+{
+    std::regex r(Static::pattern());
+    bool same = true;
+    for(std::size_t i = 0; i < inputs.size(); ++i)
+    {
+        const char* b = inputs[i].data();
+        const char* e = b + inputs[i].size();
+        typename Static::match_type sm;
+        std::cmatch cm;
+
+        bool a = Static::match(b, e, &sm);
+        bool s = std::regex_match(b, e, cm, r);
+        same = same && describe<Static>(a, sm) == describe(s, cm);
+
+        a = Static::search(b, e, &sm);
+        s = std::regex_search(b, e, cm, r);
+        same = same && describe<Static>(a, sm) == describe(s, cm);
+    }
+    std::cout << Static::pattern() << ": " << (same ? "same" : "DIFFERENT") << std::endl;
+    return same;
+}
+
+int main()
+{
+    std::cout << "----------------- verifySubmatch ----------------" << std::endl;
+    std::string str = "{sample prefix}https://www.google.com{A sample suffix}";
+    StaticRegex<url>::match_type sm;
+    StaticRegex<url>::search(str, &sm);
+    for(std::size_t i = 0; i < sm.size(); ++i)
+        std::cout << "sm[" << i << "]: " << sm.str(i) << std::endl;
+
+    std::cout << "----------------- Same results as std::regex ----------------" << std::endl;
+    std::vector<std::string> inputs = { "", "pqr", "pqrs", "pqrssr", "pqrsrsrs", "stu", "st\"", "pq", "pqx", "7", "a7b", "!",
+                                        "abcd", "abcdd", "acd", "xyxxyz", "xyq", "qq", "ababc", "abx", "12 ", "999.1 ",
+                                        "ab-", "pqrstlmuvlmpqr", "https://www.gnu.org", "x http://a.b.c y" };
+    bool same = sameAsStd<StaticRegex<digit> >(inputs) & sameAsStd<StaticRegex<startsPqr> >(inputs) &
+                sameAsStd<StaticRegex<url> >(inputs) & sameAsStd<StaticRegex<p1> >(inputs) &
+                sameAsStd<StaticRegex<p2> >(inputs) & sameAsStd<StaticRegex<p3> >(inputs) &
+                sameAsStd<StaticRegex<p4> >(inputs) & sameAsStd<StaticRegex<p5> >(inputs) &
+                sameAsStd<StaticRegex<p6> >(inputs) & sameAsStd<StaticRegex<p7> >(inputs) &
+                sameAsStd<StaticRegex<p8> >(inputs) & sameAsStd<StaticRegex<p9> >(inputs) &
+                sameAsStd<StaticRegex<p10> >(inputs) & sameAsStd<StaticRegex<p11> >(inputs) &
+                sameAsStd<StaticRegex<p12> >(inputs) & sameAsStd<StaticRegex<p13> >(inputs) &
+                sameAsStd<StaticRegex<p14> >(inputs) & sameAsStd<StaticRegex<p15> >(inputs) &
+                sameAsStd<StaticRegex<p16> >(inputs) & sameAsStd<StaticRegex<p17> >(inputs);
+    std::cout << "All the same as std::regex: " << std::boolalpha << same << std::endl;
+
+#if defined(SHOW_STATIC_REGEX_ERROR)
+    StaticRegex<backref>::match("pqrstpqr");
+#endif
+
+    std::cout << "----------------- Construct and match, as in 13_regularExp.cpp ----------------" << std::endl;
+    std::vector<std::string> lines;
+    for(int i = 0; i < 10000; ++i)
+        lines.push_back(i % 10 ? "pqrs" + std::to_string(i) : "see https://www.gnu.org");
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    std::size_t stdCount = 0;
+    for(std::size_t i = 0; i < lines.size(); ++i)
+        stdCount += std::regex_search(lines[i], std::regex(url));
+    double stdSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::regex prebuilt(url);
+    t0 = std::chrono::steady_clock::now();
+    std::size_t prebuiltCount = 0;
+    for(std::size_t i = 0; i < lines.size(); ++i)
+        prebuiltCount += std::regex_search(lines[i], prebuilt);
+    double prebuiltSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    t0 = std::chrono::steady_clock::now();
+    std::size_t staticCount = 0;
+    for(std::size_t i = 0; i < lines.size(); ++i)
+        staticCount += StaticRegex<url>::search(lines[i]);
+    double staticSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::cout << "std::regex built for each line : " << stdCount << " matches in " << stdSecs * 1000 << " ms" << std::endl;
+    std::cout << "std::regex built once         : " << prebuiltCount << " matches in " << prebuiltSecs * 1000 << " ms" << std::endl;
+    std::cout << "StaticRegex<url>              : " << staticCount << " matches in " << staticSecs * 1000 << " ms" << std::endl;
+
+    return same ? 0 : 1;
+}
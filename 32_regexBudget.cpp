@@ -0,0 +1,150 @@
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "regexDFA.h"
+
+/*********
+A program to show protecting a thread from patterns that take exponential time to match.
+
+A back-reference like the \1 of (pqr)st+\1 (13_regularExp.cpp) makes a pattern non regular, so it has to be
+matched by backtracking. A backtracker that tries every way to split the input can take exponential time, e.g.
+
+    ^(a|aa)*\1c$        on "aaaa...a"
+
+tries every way to write the a's as a sum of 1s and 2s before failing. std::regex gives no way to stop it, and a
+user supplied pattern(searchPattern() in 13_regularExp.cpp) can hold a worker thread for seconds or more.
+
+FastRegex (regexDFA.h) runs patterns with back-references on RegexBacktracker:
+
+    Memoization     A (Split, position, sub-matches read by a back-reference) state that was tried once has failed,
+                    it is not tried again: ^(a|aa)*\1c$ becomes polynomial.
+    Budget          re.setBudget(RegexBudget(steps, time)) limits the steps(instructions run) and the time of each
+                    match or search. Going over it throws std::regex_error with code error_complexity, the error
+                    std::regex uses for "the complexity of an attempted match exceeded a pre-set level".
+    Counters        re.lastSteps(): the steps of the last match or search,
+                    re.stats(): calls, steps, maxSteps(the most of one call) and overBudget of the FastRegex.
+
+With icase the pattern is folded as for the automata(38_regexIcase.cpp) and a back-reference compares its characters
+caseless, so ^(a|aa)*\1c$ with icase is memoized and limited the same way.
+
+The automata used for patterns without back-references run in linear time and are not limited, their steps
+(characters read, Pike VM threads) are counted all the same.
+*********/
+
+// searchPattern() of 13_regularExp.cpp, with a budget: a pattern that takes too long is reported as such.
+void searchPattern(const std::string& str, const std::string& pattern)
+{
+    std::cout << pattern << ": ";
+    try
+    {
+        FastRegex rg(pattern);
+        rg.setBudget(RegexBudget(1000000, std::chrono::milliseconds(50)));
+
+        if(fast_regex_search(str, rg))
+            std::cout << "Pattern found ... ";
+        else
+            std::cout << "Pattern not found ... ";
+        std::cout << "(" << rg.lastSteps() << " steps)" << std::endl;
+    }
+    catch(const std::regex_error& e)
+    {
+        if(e.code() == std::regex_constants::error_complexity)
+            std::cout << "Pattern too complex, search stopped" << std::endl;
+        else
+            std::cout << "Invalid pattern: " << e.what() << std::endl;
+    }
+}
+
+double millis(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main()
+{
+    std::cout << "----------------- (pqr)st+\\1 ----------------" << std::endl;
+    FastRegex backref("(pqr)st+\\1");
+    std::regex stdBackref("(pqr)st+\\1");
+    std::vector<std::string> inputs = { "pqrstpqr", "pqrstttpqr", "pqrsttpq", "xxpqrstpqrxx", "pqrpqr" };
+    bool same = true;
+    for(std::size_t i = 0; i < inputs.size(); ++i)
+    {
+        bool m = fast_regex_match(inputs[i], backref);
+        bool s = fast_regex_search(inputs[i], backref);
+        same = same && m == std::regex_match(inputs[i], stdBackref) && s == std::regex_search(inputs[i], stdBackref);
+        std::cout << inputs[i] << ": match " << std::boolalpha << m << ", search " << s << ", " << backref.lastSteps() << " steps" << std::endl;
+    }
+    std::cout << "Backtracking engine: " << (backref.backtrackProgram() != nullptr) << ", same as std::regex: " << same << std::endl;
+
+    std::cout << "----------------- ^(a|aa)*\\1c$ on a's ----------------" << std::endl;
+    const char* pathological = "^(a|aa)*\\1c$";
+    std::regex stdRe(pathological);
+    FastRegex fastRe(pathological);
+    for(std::size_t n = 16; n <= 28; n += 4)
+    {
+        std::string a(n, 'a');
+
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        bool s = std::regex_search(a, stdRe);
+        double stdMs = millis(t0);
+
+        t0 = std::chrono::steady_clock::now();
+        bool f = fast_regex_search(a, fastRe);
+        double fastMs = millis(t0);
+
+        std::cout << "n = " << n << ": std::regex " << s << " in " << stdMs << " ms, FastRegex " << f << " in " << fastMs
+                  << " ms(" << fastRe.lastSteps() << " steps)" << std::endl;
+    }
+    std::string longer(2000, 'a');
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    bool found = fast_regex_search(longer, fastRe);
+    std::cout << "n = 2000: FastRegex " << found << " in " << millis(t0) << " ms(" << fastRe.lastSteps() << " steps)" << std::endl;
+
+    std::cout << "----------------- The same with icase, and a budget ----------------" << std::endl;
+    FastRegex caseless(pathological, std::regex_constants::icase);
+    caseless.setBudget(RegexBudget(100000, std::chrono::milliseconds(50)));
+    std::string mixed = std::string(14, 'a') + std::string(14, 'A');
+    t0 = std::chrono::steady_clock::now();
+    found = fast_regex_search(mixed, caseless);
+    std::cout << "n = 28: FastRegex(icase) " << found << " in " << millis(t0) << " ms(" << caseless.lastSteps()
+              << " steps), backtracking engine: " << (caseless.backtrackProgram() != nullptr) << std::endl;
+    same = same && found == std::regex_search(mixed, std::regex(pathological, std::regex_constants::icase)) &&
+           fast_regex_match("aAc", caseless) && !fast_regex_match("abc", caseless);
+
+    std::cout << "----------------- A budget of 100000 steps ----------------" << std::endl;
+    FastRegex limited("^(a+)+\\1b");
+    limited.setBudget(RegexBudget(100000));
+    std::vector<std::string> targets = { "aaaab", "aaaaaaaaaaaaaaaaaaaaaab", std::string(300, 'a') };
+    for(std::size_t i = 0; i < targets.size(); ++i)
+    {
+        std::cout << targets[i].size() << " characters: ";
+        try
+        {
+            bool f = fast_regex_search(targets[i], limited);
+            std::cout << "found " << f << " in " << limited.lastSteps() << " steps" << std::endl;
+        }
+        catch(const std::regex_error& e)
+        {
+            std::cout << "stopped after " << limited.lastSteps() << " steps, error_complexity: "
+                      << (e.code() == std::regex_constants::error_complexity) << std::endl;
+        }
+    }
+    const RegexStats& stats = limited.stats();
+    std::cout << "stats: " << stats.calls << " calls, " << stats.steps << " steps, at most " << stats.maxSteps
+              << " in one call, " << stats.overBudget << " over budget" << std::endl;
+
+    std::cout << "----------------- searchPattern() with user patterns ----------------" << std::endl;
+    std::string str = "pqrstlmuvlmpqr " + std::string(5000, 'x') + " https://www.gnu.org";
+    searchPattern(str, "(pqr)st(lm)uv\\2\\1");
+    searchPattern(str, "([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)");
+    searchPattern(str, "(x+x+)+\\1[^x]g");
+    searchPattern(str, "(pqr");
+    searchPattern(str, "(a\\1)");        // Back-references to a group that is not closed yet
+    searchPattern(str, "\\1(a)");
+    searchPattern(str, "b(\\1c)*");
+
+    return same ? 0 : 1;
+}
@@ -0,0 +1,253 @@
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cctype>
+#include <cstdlib>
+
+#include "regexDFA.h"
+#include "sampleUtil.h"
+
+/*********
+A program to show replacing the URL regular expression of verifySubmatch()(13_regularExp.cpp) and
+14_regularExp_Iter.cpp by a hand written scanner, checked against std::regex on random inputs.
+
+    ([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)
+
+is simple enough for its backtracking (the order std::regex_search tries the choices in) to be worked out once:
+
+    scheme      [[:w:]]+ is followed by "://", which is not a word character: it is the whole word before a "://".
+                The leftmost match starts at the first "://" preceded by a word whose remainder matches.
+    host        The longest word after "://" (the end R of the word) is tried first. The '.' after it is then the
+                character at R(any but '\n' and '\r'), and the domain the word after it:
+                    - the whole word, when R3(its end) is followed by a character and a word character,
+                    - else all but its last 2 characters: '.' takes the one before last, and the tld the last one.
+    shorter     When that fails, the host gives back characters of its word, so '.' and the domain are inside it:
+                    - host = word minus 2, domain = the last character, when R is followed by '.' and a word character,
+                    - else host = word minus 4, domain, '.' and tld = the characters before R.
+    tld         [[:w:]]+ at the end of the pattern takes the whole word.
+
+UrlTokenizer::search() runs these rules with a table lookup per character, memchr() to find the ':' of each "://",
+and fills a UrlMatch of fast_string_views(regexDFA.h) into the target: no allocation, no backtracking.
+
+The fuzzer below compares every sub-match of every match found in random strings(made of pieces like "://",
+"www", '.', '\n', '\0', non ASCII bytes ...) with the ones of std::sregex_iterator, then the scanner is timed
+against std::regex and FastRegex on a log of URLs.
+
+Usage: 33_urlTokenizer [random inputs(default 100000)] [seed]
+*********/
+
+// The sub-matches of a URL: [0] the whole URL, [1] scheme, [2] host, [3] domain, [4] top level domain.
+struct UrlMatch
+{
+    const fast_string_view& operator[](std::size_t n) const { return sub[n]; }
+
+    fast_string_view sub[5];
+};
+
+class UrlTokenizer
+{
+public:
+    UrlTokenizer()
+    {
+        for(int c = 0; c < 256; ++c)
+        {
+            _word[c] = c < 128 && (std::isalnum(c) || c == '_');     // [[:w:]] in the "C" locale
+            _any[c] = c != '\n' && c != '\r';                       // '.' of ECMAScript
+        }
+    }
+
+    // Finds the first URL in [b, e), as std::regex_search with the URL pattern.
+    bool search(const char* b, const char* e, UrlMatch& m) const
+    {
+        for(const char* c = b; e - c >= 3; ++c)
+        {
+            c = static_cast<const char*>(std::memchr(c, ':', e - c - 2));
+            if(!c)
+                return false;
+            if(c[1] != '/' || c[2] != '/')
+                continue;
+
+            const char* s = c;
+            while(s != b && word(s[-1]))
+                --s;
+            if(s != c && tail(c + 3, e, m))
+            {
+                m.sub[0] = fast_string_view(s, m.sub[4].end() - s);
+                m.sub[1] = fast_string_view(s, c - s);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool search(const std::string& s, UrlMatch& m) const
+    {
+        return search(s.data(), s.data() + s.size(), m);
+    }
+
+private:
+    bool word(char c) const { return _word[static_cast<unsigned char>(c)]; }
+    bool any(char c) const  { return _any[static_cast<unsigned char>(c)]; }
+
+    const char* wordEnd(const char* p, const char* e) const
+    {
+        while(p != e && word(*p))
+            ++p;
+        return p;
+    }
+
+    // Can ".([[:w:]]+)" start at p?
+    bool dotWord(const char* p, const char* e) const
+    {
+        return e - p >= 2 && any(p[0]) && word(p[1]);
+    }
+
+    static void set(UrlMatch& m, const char* host, const char* dot2, const char* dot3, const char* tldEnd)
+    {
+        m.sub[2] = fast_string_view(host, dot2 - host);
+        m.sub[3] = fast_string_view(dot2 + 1, dot3 - dot2 - 1);
+        m.sub[4] = fast_string_view(dot3 + 1, tldEnd - dot3 - 1);
+    }
+
+    // Matches ([[:w:]]+).([[:w:]]+).([[:w:]]+) at r, the host, domain and tld, in the order std::regex tries them.
+    bool tail(const char* r, const char* e, UrlMatch& m) const
+    {
+        const char* R = wordEnd(r, e);
+        if(R == r)
+            return false;
+
+        // The whole word is the host, '.' is the character after it.
+        if(R != e && any(*R))
+        {
+            const char* R3 = wordEnd(R + 1, e);
+            if(R3 != R + 1 && dotWord(R3, e))
+            {
+                set(m, r, R, R3, wordEnd(R3 + 1, e));
+                return true;
+            }
+            if(R3 - (R + 1) >= 3)
+            {
+                set(m, r, R, R3 - 2, R3);
+                return true;
+            }
+        }
+
+        // The host gives back characters: the domain is the last one of the word, or the one before the last 2.
+        if(R - r >= 3 && dotWord(R, e))
+        {
+            set(m, r, R - 2, R, wordEnd(R + 1, e));
+            return true;
+        }
+        if(R - r >= 5)
+        {
+            set(m, r, R - 4, R - 2, R);
+            return true;
+        }
+        return false;
+    }
+
+    bool _word[256];
+    bool _any[256];
+};
+
+// The sub-match offsets of every URL found in s, by each implementation
+std::vector<long> stdMatches(const std::string& s, const std::regex& r)
+{
+    std::vector<long> out;
+    for(std::sregex_iterator it(s.begin(), s.end(), r), end; it != end; ++it)
+        for(std::size_t i = 0; i < 5; ++i)
+        {
+            out.push_back((*it)[i].first - s.begin());
+            out.push_back((*it)[i].second - s.begin());
+        }
+    return out;
+}
+
+std::vector<long> tokenizerMatches(const std::string& s, const UrlTokenizer& t)
+{
+    std::vector<long> out;
+    UrlMatch m;
+    for(const char* p = s.data(); t.search(p, s.data() + s.size(), m); p = m[0].end())
+        for(std::size_t i = 0; i < 5; ++i)
+        {
+            out.push_back(m[i].begin() - s.data());
+            out.push_back(m[i].end() - s.data());
+        }
+    return out;
+}
+
+// Random strings made of the pieces that matter to the pattern
+bool fuzz(const UrlTokenizer& t, const std::regex& r, long count, unsigned seed)
+{
+    const std::vector<std::string> pieces = {
+        "://", ":", "/", "//", ".", "w", "www", "a", "Z9", "_", "com", "http", "https", " ", ";",
+        "\n", "\r", std::string(1, '\0'), "\xe9", "-", "ab.cd", "x://y.z"
+    };
+    RandomPieces random(pieces, 16, seed);
+
+    long bad = 0;
+    for(long n = 0; n < count; ++n)
+    {
+        std::string s = random();
+        if(tokenizerMatches(s, t) != stdMatches(s, r) && ++bad <= 5)
+            std::cout << "Different sub-matches for \"" << printable(s) << "\"" << std::endl;
+    }
+    std::cout << count << " random inputs(seed " << seed << "), " << bad << " different from std::regex" << std::endl;
+    return bad == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* pattern = "([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)";
+    UrlTokenizer tokenizer;
+
+    std::cout << "----------------- verifySubmatch ----------------" << std::endl;
+    std::string str = "{sample prefix}https://www.google.com{A sample suffix}";
+    UrlMatch m;
+    if(tokenizer.search(str, m))
+        for(std::size_t i = 0; i < 5; ++i)
+            std::cout << "m[" << i << "]: " << m[i] << std::endl;
+
+    std::string strs = "https://www.google.com; http://www.yahoo.co.in;; http://www.gnu.org";
+    for(const char* p = strs.data(); tokenizer.search(p, strs.data() + strs.size(), m); p = m[0].end())
+        std::cout << m[3] << " is accessed via " << m[1] << std::endl;
+
+    std::cout << "----------------- Fuzzing against std::regex ----------------" << std::endl;
+    std::regex r(pattern);
+    long count = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 100000;
+    unsigned seed = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 2011;
+    bool same = fuzz(tokenizer, r, count, seed);
+
+    std::cout << "----------------- Benchmark ----------------" << std::endl;
+    std::string log;
+    for(int i = 0; log.size() < (8 << 20); ++i)
+        log += (i % 3 == 0) ? strs + "\n" : "GET /index.html 200 " + std::to_string(i) + "; no url on this line\n";
+
+    FastRegex fr(pattern);
+    double base = measure("std::sregex_iterator  ", [&]() {
+        std::size_t chars = 0;
+        for(std::sregex_iterator it(log.begin(), log.end(), r), end; it != end; ++it)
+            for(std::size_t i = 0; i < 5; ++i)
+                chars += (*it)[i].length();
+        return chars;
+    }, log.size(), 0, nullptr, "byte");
+    measure("fast_sregex_iterator  ", [&]() {
+        std::size_t chars = 0;
+        for(fast_sregex_iterator it(log.begin(), log.end(), fr), end; it != end; ++it)
+            for(std::size_t i = 0; i < 5; ++i)
+                chars += it->view(i).size();
+        return chars;
+    }, log.size(), base, nullptr, "byte");
+    measure("UrlTokenizer::search  ", [&]() {
+        std::size_t chars = 0;
+        UrlMatch u;
+        for(const char* p = log.data(); tokenizer.search(p, log.data() + log.size(), u); p = u[0].end())
+            for(std::size_t i = 0; i < 5; ++i)
+                chars += u[i].size();
+        return chars;
+    }, log.size(), base, nullptr, "byte");
+
+    return same ? 0 : 1;
+}
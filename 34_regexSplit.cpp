@@ -0,0 +1,309 @@
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "regexDFA.h"
+#include "sampleUtil.h"
+
+/*********
+A program to show splitting a string at the matches of a delimiter pattern, without running a regular expression.
+
+14_regularExp_Iter.cpp gets the text between the URLs with
+
+    std::sregex_token_iterator rgtit(strs.cbegin(), strs.cend(), r, -1);
+
+and the same iterator with a pattern like ";" or "[,;]" is the usual way to split fields with <regex>. Each token
+costs a whole regex_search, and a std::string copy when it is read with str().
+
+RegexSplitter looks at the parsed delimiter pattern(RegexParser of regexDFA.h) and picks the way to find it:
+
+    Character   a character, a class or an alternative of characters: ";"  "[,;]"  ",|;"  "\s"
+                ByteSetScanner compares 16(32) characters at once with SSE2(AVX2) for sets of up to 8 characters.
+    Run         a class repeated with + : " +"  "[,;]+"  "\s+". The run ends at the first character not in the
+                class, found the same way.
+    Literal     a literal of several characters: "::"  "\r\n". LiteralScanner(the prefilter of FastRegex).
+    Pattern     anything else: the matches of a FastRegex.
+
+With icase the delimiter is parsed folded: "x" is the class [xX], a Character. With FastRegex::utf8 a character
+of several bytes is a Literal: "[é]" is the two bytes of é, not a class of both.
+
+RegexSplitter::split() gives the same tokens as a sregex_token_iterator with -1: the text before each match, then
+the text after the last match if it is not empty(the whole string when nothing matches). The tokens are
+fast_string_views into the string, passed to a callback or stored in a vector whose capacity is kept.
+
+The tokens of each kind are compared with the ones of std::sregex_token_iterator on random strings, then the
+splitting of a ';' separated file is timed.
+*********/
+
+class RegexSplitter
+{
+public:
+    enum Kind { Character, Run, Literal, Pattern };
+
+    explicit RegexSplitter(const std::string& pattern, std::regex_constants::syntax_option_type f = std::regex_constants::ECMAScript)
+        :_re(pattern, f), _kind(Pattern)
+    {
+        if(!_re.usesDFA())
+            return;     // Back-references, another grammar ...
+
+        RegexParser parser(pattern, FastRegex::parserMode(f));     // The tree _re was built from
+        RegexNodePtr root = parser.parse();
+        const RegexNode* n = ungroup(*root);
+
+        ByteSet set;
+        std::string literal;
+        if(characters(*n, set))
+        {
+            _kind = Character;
+            _delimiter.reset(new ByteSetScanner(set));
+        }
+        else if(n->kind == RegexNode::Repeat && n->min == 1 && characters(*ungroup(*n->kids[0]), set))
+        {
+            // A lazy +? or a {1} takes a single character, a greedy + or {1,} the whole run.
+            _kind = (n->greedy && n->max < 0) ? Run : (n->max == 1 || !n->greedy) ? Character : Pattern;
+            _delimiter.reset(new ByteSetScanner(set));
+            _rest.reset(new ByteSetScanner(~set));
+        }
+        else if(isLiteral(*n, literal) && literal.size() > 1)
+        {
+            _kind = Literal;
+            _literal.reset(new LiteralScanner(literal));
+        }
+    }
+
+    Kind kind() const { return _kind; }
+
+    // Calls f(fast_string_view) with each token of [b, e), as sregex_token_iterator(b, e, r, -1) gives them.
+    template<class F>
+    void split(const char* b, const char* e, F f) const
+    {
+        if(_kind == Pattern)
+        {
+            splitPattern(b, e, f);
+            return;
+        }
+
+        const char* p = b;
+        bool found = false;
+        const char* end = nullptr;
+        for(const char* d; (d = find(p, e, end)) != nullptr; found = true)
+        {
+            f(fast_string_view(p, d - p));
+            p = end;
+        }
+        if(!found || p != e)
+            f(fast_string_view(p, e - p));
+    }
+
+    // The tokens of s, in tokens(cleared first: a vector reused from one call to the next allocates nothing)
+    void split(const std::string& s, std::vector<fast_string_view>& tokens) const
+    {
+        tokens.clear();
+        split(s.data(), s.data() + s.size(), [&tokens](const fast_string_view& t) { tokens.push_back(t); });
+    }
+
+private:
+    // The next delimiter at or after p, or nullptr. Its end is left in end.
+    const char* find(const char* p, const char* e, const char*& end) const
+    {
+        const char* d = nullptr;
+        switch(_kind)
+        {
+        case Character:
+            d = _delimiter->find(p, e);
+            if(d)
+                end = d + 1;
+            break;
+        case Run:
+            d = _delimiter->find(p, e);
+            if(d)
+            {
+                end = _rest->find(d + 1, e);
+                if(!end)
+                    end = e;
+            }
+            break;
+        default:
+            d = _literal->find(p, e);
+            if(d)
+                end = d + _literal->literal().size();
+            break;
+        }
+        return d;
+    }
+
+    template<class F>
+    void splitPattern(const char* b, const char* e, F f) const
+    {
+        const char* last = b;
+        bool found = false;
+        for(fast_cregex_iterator it(b, e, _re), end; it != end; ++it, found = true)
+        {
+            f(it->prefix_view());
+            last = (*it)[0].second;
+        }
+        if(!found || last != e)
+            f(fast_string_view(last, e - last));
+    }
+
+    static const RegexNode* ungroup(const RegexNode& n)
+    {
+        const RegexNode* p = &n;
+        while(p->kind == RegexNode::Group || (p->kind == RegexNode::Repeat && p->min == 1 && p->max == 1))
+            p = p->kids[0].get();
+        return p;
+    }
+
+    // A single character of a set, or alternatives that are each a single character
+    static bool characters(const RegexNode& n, ByteSet& set)
+    {
+        if(n.kind == RegexNode::Bytes)
+        {
+            set |= n.set;
+            return true;
+        }
+        if(n.kind != RegexNode::Alternate)
+            return false;
+        for(std::size_t i = 0; i < n.kids.size(); ++i)
+            if(!characters(*ungroup(*n.kids[i]), set))
+                return false;
+        return true;
+    }
+
+    static bool isLiteral(const RegexNode& n, std::string& literal)
+    {
+        if(n.kind == RegexNode::Bytes && n.set.count() == 1)
+        {
+            int c = 0;
+            while(!n.set[c])
+                ++c;
+            literal += static_cast<char>(c);
+            return true;
+        }
+        if(n.kind != RegexNode::Concat && n.kind != RegexNode::Group)
+            return false;
+        for(std::size_t i = 0; i < n.kids.size(); ++i)
+            if(!isLiteral(*n.kids[i], literal))
+                return false;
+        return true;
+    }
+
+    FastRegex _re;
+    Kind _kind;
+    std::unique_ptr<ByteSetScanner> _delimiter;
+    std::unique_ptr<ByteSetScanner> _rest;       // Run: the characters ending a run
+    std::unique_ptr<LiteralScanner> _literal;
+};
+
+const char* kindName(RegexSplitter::Kind k)
+{
+    static const char* names[] = { "Character", "Run", "Literal", "Pattern" };
+    return names[k];
+}
+
+std::vector<std::string> stdTokens(const std::string& s, const std::regex& r)
+{
+    std::vector<std::string> out;
+    for(std::sregex_token_iterator it(s.begin(), s.end(), r, -1), end; it != end; ++it)
+        out.push_back(it->str());
+    return out;
+}
+
+// The reference for FastRegex::utf8, which std::regex does not have: the matches of the FastRegex itself
+std::vector<std::string> fastTokens(const std::string& s, const FastRegex& r)
+{
+    std::vector<std::string> out;
+    const char* last = s.data();
+    bool found = false;
+    for(fast_cregex_iterator it(s.data(), s.data() + s.size(), r), end; it != end; ++it, found = true)
+    {
+        out.push_back(it->prefix_view().str());
+        last = (*it)[0].second;
+    }
+    if(!found || last != s.data() + s.size())
+        out.push_back(std::string(last, s.data() + s.size()));
+    return out;
+}
+
+std::vector<std::string> splitterTokens(const std::string& s, const RegexSplitter& splitter)
+{
+    std::vector<std::string> out;
+    splitter.split(s.data(), s.data() + s.size(), [&out](const fast_string_view& t) { out.push_back(t.str()); });
+    return out;
+}
+
+int main()
+{
+    std::cout << "----------------- Splitting strs of 14_regularExp_Iter.cpp ----------------" << std::endl;
+    std::string strs = "https://www.google.com; http://www.yahoo.co.in;; http://www.gnu.org";
+    RegexSplitter semicolon(";");
+    std::vector<fast_string_view> tokens;
+    semicolon.split(strs, tokens);
+    for(std::size_t i = 0; i < tokens.size(); ++i)
+        std::cout << "[" << tokens[i] << "]" << std::endl;
+
+    std::cout << "----------------- Same tokens as sregex_token_iterator(-1) ----------------" << std::endl;
+    const std::vector<std::string> patterns = {
+        ";", "[,;]", ",|;", "(;)", "\\s", "[^a-z;]", ";+", "[ ,]+", ";+?", ";{1}", "::", "\r\n", ";;",
+        ";{1,3}", ";*", "a|::", "[a-z]+;", "\\b", ";{2}", "X", "[\xc3\xa9]", "\xc3\xa9|;", "[\xc3\xa9;]", "[;,]+"
+    };
+    const std::size_t firstUtf8 = patterns.size() - 4;
+    const std::vector<std::string> pieces = { ";", ",", " ", "::", ":", "a", "bc", "\r\n", "\n", "xyz", "\t", "\xe9", "\xc3\xa9" };
+    RandomPieces random(pieces, 40, 14);
+
+    bool same = true;
+    for(std::size_t p = 0; p < patterns.size(); ++p)
+    {
+        std::regex_constants::syntax_option_type f = (patterns[p] == "X") ? std::regex_constants::icase :
+                                                     (p >= firstUtf8) ? FastRegex::utf8 : std::regex_constants::ECMAScript;
+        RegexSplitter splitter(patterns[p], f);
+        std::regex r(patterns[p], f & ~FastRegex::utf8);
+        FastRegex fr(patterns[p], f);
+        int bad = 0;
+        for(int n = 0; n < 2000; ++n)
+        {
+            std::string s = random();
+            std::string tail = std::string(static_cast<std::size_t>(n % 40), 'a');     // Long enough for the SIMD blocks
+            s = (n % 2) ? s + tail + s : s;
+            bad += splitterTokens(s, splitter) != ((f & FastRegex::utf8) ? fastTokens(s, fr) : stdTokens(s, r));
+        }
+        std::string shown;
+        for(char c : patterns[p])
+            shown += (c == '\r') ? "\\r" : (c == '\n') ? "\\n" : std::string(1, c);
+        std::cout << shown << (f & std::regex_constants::icase ? "(icase)" : "") << (f & FastRegex::utf8 ? "(utf8)" : "") << ": " << kindName(splitter.kind()) << (bad ? ", DIFFERENT" : ", same") << std::endl;
+        same = same && bad == 0;
+    }
+    std::cout << "Same tokens for all patterns: " << std::boolalpha << same << std::endl;
+
+    std::cout << "----------------- A 16 MB ';' separated file ----------------" << std::endl;
+    std::string file;
+    for(int i = 0; file.size() < (16 << 20); ++i)
+        file += std::to_string(i) + ";user" + std::to_string(i % 977) + ";GET;/index.html;200;" + std::to_string(i * 7 % 10000) + ";https://www.gnu.org\n";
+
+    std::regex r(";|\n");
+    FastRegex fr(";|\n");
+    RegexSplitter splitter(";|\n");
+    std::cout << "Delimiter ;|\\n: " << kindName(splitter.kind()) << std::endl;
+
+    double base = measureBytes("sregex_token_iterator(-1) + str()", [&]() {
+        std::size_t chars = 0;
+        for(std::sregex_token_iterator it(file.begin(), file.end(), r, -1), end; it != end; ++it)
+            chars += it->str().size();
+        return chars;
+    }, file.size(), 0);
+    measureBytes("fast_sregex_iterator prefixes     ", [&]() {
+        std::size_t chars = 0;
+        for(fast_sregex_iterator it(file.begin(), file.end(), fr), end; it != end; ++it)
+            chars += it->prefix_view().size();
+        return chars;
+    }, file.size(), base);
+    measureBytes("RegexSplitter::split              ", [&]() {
+        std::size_t chars = 0;
+        splitter.split(file.data(), file.data() + file.size(), [&chars](const fast_string_view& t) { chars += t.size(); });
+        return chars;
+    }, file.size(), base);
+
+    return same ? 0 : 1;
+}
@@ -0,0 +1,276 @@
+#include <iostream>
+#include <fstream>
+#include <regex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "regexDFA.h"
+
+/*********
+A program to show starting a process with thousands of patterns without compiling them.
+
+13_regularExp.cpp builds a std::regex for every pattern it uses, and a std::regex is compiled(parsed, and turned
+into an automaton) each time the program starts. With thousands of patterns that takes seconds, every time.
+
+FastRegex(regexDFA.h) can write its compiled form into a snapshot, a blob made of:
+
+    header      magic, version, syntax flags, fingerprint of the pattern and flags, payload size, checksum
+    payload     the programs(Thompson NFA instructions and character sets) and the prefilter literal
+
+FastRegex::fromSnapshot(data, size, pattern, flags) rebuilds the FastRegex from the blob, copying the instructions
+as they are: nothing is parsed or compiled. It returns nullptr when the blob cannot be used:
+
+    version     the snapshot was written by another version of regexDFA.h
+    checksum    the blob was damaged(a truncated file, a flipped bit ...)
+    fingerprint the snapshot was written for another pattern or other flags(the configuration changed)
+
+and the pattern is compiled then. The lazy DFA is not part of the snapshot, its states are built while matching
+as they are for a compiled FastRegex.
+
+SnapshotFile keeps the snapshots of many patterns in one file:
+
+    "FRXFILE\0", count(u64), then count (offset, size) pairs(u64), then the snapshots, each at a multiple of 8
+
+and maps it in memory with mmap(): the snapshots are read in place, the file is never copied.
+
+Usage: 35_regexSnapshot [number of patterns(default 3000)] [snapshot file(default 35_regexSnapshot.bin)]
+*********/
+
+class SnapshotFile
+{
+public:
+    static void write(const std::string& path, const std::vector<FastRegex>& regexes)
+    {
+        std::vector<std::string> blobs;
+        for(std::size_t i = 0; i < regexes.size(); ++i)
+            blobs.push_back(regexes[i].snapshot());
+
+        std::string out("FRXFILE", 8);
+        RegexSnapshot::Writer w(out);
+        w.u64(blobs.size());
+        std::uint64_t offset = 16 + 16 * blobs.size();
+        for(std::size_t i = 0; i < blobs.size(); ++i)
+        {
+            w.u64(offset);
+            w.u64(blobs[i].size());
+            offset += (blobs[i].size() + 7) / 8 * 8;
+        }
+        for(std::size_t i = 0; i < blobs.size(); ++i)
+        {
+            out += blobs[i];
+            out.append((8 - blobs[i].size() % 8) % 8, '\0');
+        }
+
+        std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+        if(!file.write(out.data(), out.size()))
+            throw std::runtime_error("Cannot write " + path);
+    }
+
+    explicit SnapshotFile(const std::string& path):_data(nullptr), _size(0), _count(0)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            throw std::runtime_error("Cannot open " + path);
+
+        struct stat st;
+        if(::fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(p != MAP_FAILED)
+            {
+                _data = static_cast<const char*>(p);
+                _size = st.st_size;
+            }
+        }
+        ::close(fd);        // The mapping stays valid
+        if(!_data)
+            throw std::runtime_error("Cannot map " + path);
+
+        RegexSnapshot::Reader r(_data, _data + _size);
+        const char* magic = r.raw(8);
+        _count = r.u64();
+        if(!magic || std::memcmp(magic, "FRXFILE", 8) != 0 || r.failed() || _count > r.left() / 16)
+            _count = 0;     // Not a snapshot file: every pattern is compiled
+    }
+
+    ~SnapshotFile()
+    {
+        ::munmap(const_cast<char*>(_data), _size);
+    }
+
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    std::size_t size() const { return _count; }
+
+    // The snapshot i, nullptr(size 0) when its entry points outside the file.
+    const char* snapshot(std::size_t i, std::size_t& size) const
+    {
+        size = 0;
+        if(i >= _count)
+            return nullptr;
+        RegexSnapshot::Reader r(_data + 16 + 16 * i, _data + _size);
+        std::uint64_t offset = r.u64();
+        std::uint64_t n = r.u64();
+        if(r.failed() || offset > _size || n > _size - offset)
+            return nullptr;
+        size = n;
+        return _data + offset;
+    }
+
+private:
+    const char* _data;
+    std::size_t _size;
+    std::uint64_t _count;
+};
+
+// The patterns of a service, loaded from a snapshot file when it holds a usable snapshot of each one.
+struct LoadedPatterns
+{
+    std::vector<FastRegex> regexes;
+    std::size_t restored;
+    std::size_t compiled;
+};
+
+LoadedPatterns loadPatterns(const std::vector<std::string>& patterns, const SnapshotFile& file)
+{
+    LoadedPatterns loaded;
+    loaded.restored = loaded.compiled = 0;
+    loaded.regexes.reserve(patterns.size());
+    for(std::size_t i = 0; i < patterns.size(); ++i)
+    {
+        std::size_t size = 0;
+        const char* data = i < file.size() ? file.snapshot(i, size) : nullptr;
+        std::unique_ptr<FastRegex> re = data ? FastRegex::fromSnapshot(data, size, patterns[i]) : std::unique_ptr<FastRegex>();
+        if(re)
+        {
+            loaded.regexes.push_back(*re);
+            ++loaded.restored;
+        }
+        else
+        {
+            loaded.regexes.push_back(FastRegex(patterns[i]));
+            ++loaded.compiled;
+        }
+    }
+    return loaded;
+}
+
+std::vector<std::string> makePatterns(std::size_t count)
+{
+    std::vector<std::string> patterns;
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        std::string n = std::to_string(i);
+        switch(i % 6)
+        {
+        case 0: patterns.push_back("user" + n + "_[[:digit:]]+"); break;
+        case 1: patterns.push_back("([[:w:]]+)://host" + n + ".([[:w:]]+).([[:w:]]+)"); break;
+        case 2: patterns.push_back("(GET|POST|PUT) /api/v[0-9]+/item" + n + "(/[a-z]+)*"); break;
+        case 3: patterns.push_back("error" + n + ": [^;]{1,40};"); break;
+        case 4: patterns.push_back("(pq" + n + "r)st+\\1"); break;                         // Back-reference: backtracking
+        default: patterns.push_back("\\bword" + n + "\\b"); break;                         // \b: std::regex
+        }
+    }
+    return patterns;
+}
+
+double millis(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 3000;
+    std::string path = argc > 2 ? argv[2] : "35_regexSnapshot.bin";
+    std::vector<std::string> patterns = makePatterns(count);
+
+    std::cout << "----------------- Compiling " << count << " patterns ----------------" << std::endl;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    std::vector<std::regex> stdRegexes(patterns.begin(), patterns.end());
+    double stdMs = millis(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    std::vector<FastRegex> compiled;
+    for(std::size_t i = 0; i < patterns.size(); ++i)
+        compiled.push_back(FastRegex(patterns[i]));
+    double compileMs = millis(t0);
+
+    SnapshotFile::write(path, compiled);
+
+    t0 = std::chrono::steady_clock::now();
+    LoadedPatterns loaded;
+    {
+        SnapshotFile file(path);
+        loaded = loadPatterns(patterns, file);
+    }
+    double loadMs = millis(t0);
+
+    std::cout << "std::regex                 : " << stdMs << " ms" << std::endl;
+    std::cout << "FastRegex from the patterns: " << compileMs << " ms" << std::endl;
+    std::cout << "FastRegex from a snapshot  : " << loadMs << " ms(" << loaded.restored << " restored, "
+              << loaded.compiled << " compiled), " << compileMs / loadMs << " times faster than compiling, "
+              << stdMs / loadMs << " than std::regex" << std::endl;
+
+    std::cout << "----------------- Same matches ----------------" << std::endl;
+    std::vector<std::string> lines = {
+        "GET /api/v2/item2/a/b from user0_42", "see https://host1.gnu.org now", "error3: disk full; retry",
+        "pq4rsttpq4r", "a word5 here", "nothing to see", "POST /api/v10/item8/x"
+    };
+    bool same = true;
+    for(std::size_t i = 0; i < patterns.size(); ++i)
+    {
+        for(std::size_t l = 0; l < lines.size(); ++l)
+        {
+            fast_smatch a, b;
+            bool fa = fast_regex_search(lines[l], a, compiled[i]);
+            bool fb = fast_regex_search(lines[l], b, loaded.regexes[i]);
+            bool fs = std::regex_search(lines[l], stdRegexes[i]);
+            same = same && fa == fb && fa == fs && a.size() == b.size();
+            for(std::size_t g = 0; same && fa && g < a.size(); ++g)
+                same = a.position(g) == b.position(g) && a.length(g) == b.length(g);
+        }
+    }
+    std::cout << "Snapshots match as the compiled patterns and std::regex: " << std::boolalpha << same << std::endl;
+
+    std::cout << "----------------- Snapshots that cannot be used ----------------" << std::endl;
+    std::string blob = compiled[1].snapshot();
+    std::cout << patterns[1] << ": " << blob.size() << " bytes" << std::endl;
+
+    std::string damaged = blob;
+    damaged[damaged.size() / 2] ^= 0x20;
+    std::string older = blob;
+    older[8] = static_cast<char>(RegexSnapshot::Version + 1);
+
+    bool ok = FastRegex::fromSnapshot(blob.data(), blob.size(), patterns[1]) != nullptr;
+    bool flipped = FastRegex::fromSnapshot(damaged.data(), damaged.size(), patterns[1]) != nullptr;
+    bool truncated = FastRegex::fromSnapshot(blob.data(), blob.size() - 1, patterns[1]) != nullptr;
+    bool version = FastRegex::fromSnapshot(older.data(), older.size(), patterns[1]) != nullptr;
+    bool other = FastRegex::fromSnapshot(blob.data(), blob.size(), patterns[7]) != nullptr;
+    bool icase = FastRegex::fromSnapshot(blob.data(), blob.size(), patterns[1], std::regex_constants::icase) != nullptr;
+    std::cout << "loaded: " << ok << ", flipped bit: " << flipped << ", truncated: " << truncated << ", other version: "
+              << version << ", other pattern: " << other << ", other flags: " << icase << std::endl;
+
+    // The configuration changed: a new pattern in the middle, the snapshots after it are for other patterns.
+    std::vector<std::string> changed = patterns;
+    changed.insert(changed.begin() + changed.size() / 2, "new_pattern[0-9]+");
+    {
+        SnapshotFile file(path);
+        LoadedPatterns again = loadPatterns(changed, file);
+        std::cout << "After inserting a pattern: " << again.restored << " restored, " << again.compiled << " compiled" << std::endl;
+    }
+
+    std::remove(path.c_str());
+    return same && ok && !flipped && !truncated && !version && !other && !icase ? 0 : 1;
+}
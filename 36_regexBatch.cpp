@@ -0,0 +1,379 @@
+#include <iostream>
+#include <fstream>
+#include <regex>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "regexDFA.h"
+
+/*********
+A program to show matching every line of a large input against a pattern, and measuring how fast it goes.
+
+matchPattern() and verifyGrammar() in 13_regularExp.cpp read one word at a time with std::cin >> str, and print a
+line per word ending with std::endl, which flushes std::cout: one write() system call per word. On a large input
+the loop spends its time in system calls and stream formatting, not in matching.
+
+The batch driver below:
+
+    LineReader      reads the input(a file, or stdin) with fread() in large blocks, and cuts a block into lines
+                    with memchr(): a line is a fast_string_view(regexDFA.h) into the block, nothing is copied.
+                    The part of a line at the end of a block is carried over to the next one.
+    Batch           the lines of a block, matched together(regex_match of the whole line, or regex_search with -s)
+                    by a FastRegex. With -t N, N blocks are read at a time and matched by N threads, each one with
+                    its own copy of the FastRegex(a FastRegex is not thread-safe).
+    Output          with -p the matching lines are written with fwrite() into the stdio buffer, no flush per line.
+    Statistics      lines, matches and bytes per second, and the latency of one line(1 line in 8 is timed, into
+                    a histogram of 8 buckets per power of 2) at the 50th, 90th, 99th and 99.9th percentile.
+
+Usage:  36_regexBatch [-s] [-p] [-g] [-t threads] [-b block KB] pattern [file]
+            -s  search(regex_search) instead of matching whole lines(regex_match)
+            -p  print the matching lines(the statistics go to stderr then)
+            -g  grep grammar(as verifyGrammar()), the default is ECMAScript
+            no file: stdin
+
+Without arguments, a demonstration runs on a generated log, and compares with the loop of matchPattern().
+*********/
+
+// Latencies in nanoseconds: 16 exact buckets below 16ns, then 8 buckets per power of 2.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram():_counts(16 + 8 * 60, 0), _total(0), _max(0) {}
+
+    void add(unsigned long long ns)
+    {
+        ++_counts[bucket(ns)];
+        ++_total;
+        _max = std::max(_max, ns);
+    }
+
+    void merge(const LatencyHistogram& other)
+    {
+        for(std::size_t i = 0; i < _counts.size(); ++i)
+            _counts[i] += other._counts[i];
+        _total += other._total;
+        _max = std::max(_max, other._max);
+    }
+
+    unsigned long long count() const { return _total; }
+    unsigned long long max() const   { return _max; }
+
+    // The lowest latency of the bucket holding the p-th percentile(p in [0, 100]).
+    unsigned long long percentile(double p) const
+    {
+        unsigned long long rank = static_cast<unsigned long long>(p / 100 * _total);
+        unsigned long long seen = 0;
+        for(std::size_t i = 0; i < _counts.size(); ++i)
+        {
+            seen += _counts[i];
+            if(seen > rank)
+                return lowest(i);
+        }
+        return _max;
+    }
+
+private:
+    static std::size_t bucket(unsigned long long ns)
+    {
+        if(ns < 16)
+            return static_cast<std::size_t>(ns);
+        int log = 63 - __builtin_clzll(ns);                         // 4 or more
+        return 16 + (log - 4) * 8 + static_cast<std::size_t>((ns >> (log - 3)) & 7);
+    }
+
+    static unsigned long long lowest(std::size_t b)
+    {
+        if(b < 16)
+            return b;
+        int log = static_cast<int>((b - 16) / 8) + 4;
+        return (8ULL + (b - 16) % 8) << (log - 3);
+    }
+
+    std::vector<unsigned long long> _counts;
+    unsigned long long _total;
+    unsigned long long _max;
+};
+
+// The lines of a block of the input, and which of them matched.
+struct Batch
+{
+    std::vector<char> data;
+    std::vector<fast_string_view> lines;
+    std::vector<char> matched;
+};
+
+class LineReader
+{
+public:
+    LineReader(std::FILE* file, std::size_t blockSize):_file(file), _blockSize(blockSize), _bytes(0) {}
+
+    std::size_t bytes() const { return _bytes; }
+
+    // Reads the next block into batch, cut into lines(without their '\n'). Returns false at the end of the input.
+    bool next(Batch& batch)
+    {
+        batch.data.assign(_carry.begin(), _carry.end());
+        batch.lines.clear();
+        _carry.clear();
+
+        // Read until the block holds a whole line(a line longer than a block makes the block grow).
+        std::size_t scanned = 0;
+        const char* lastNewline = nullptr;
+        bool eof = false;
+        while(!lastNewline && !eof)
+        {
+            std::size_t size = batch.data.size();
+            batch.data.resize(size + _blockSize);
+            std::size_t n = std::fread(batch.data.data() + size, 1, _blockSize, _file);
+            batch.data.resize(size + n);
+            _bytes += n;
+            eof = n < _blockSize;
+
+            for(const char* p = batch.data.data() + batch.data.size(); !lastNewline && p != batch.data.data() + scanned; )
+                if(*--p == '\n')
+                    lastNewline = p;
+            scanned = batch.data.size();
+        }
+
+        const char* p = batch.data.data();
+        const char* e = p + batch.data.size();
+        const char* end = lastNewline ? lastNewline + 1 : p;
+        while(p != end)
+        {
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            batch.lines.push_back(fast_string_view(p, nl - p));
+            p = nl + 1;
+        }
+        if(eof)
+        {
+            if(end != e)
+                batch.lines.push_back(fast_string_view(end, e - end));     // The last line, without a '\n'
+        }
+        else
+            _carry.assign(end, e);
+
+        return !batch.lines.empty() || !eof;
+    }
+
+private:
+    std::FILE* _file;
+    std::size_t _blockSize;
+    std::size_t _bytes;
+    std::string _carry;     // The beginning of a line cut by the end of a block
+};
+
+// Matches the lines [first, last) of a batch.
+void matchLines(Batch& batch, std::size_t first, std::size_t last, const FastRegex& re, bool search, LatencyHistogram& latency)
+{
+    for(std::size_t i = first; i < last; ++i)
+    {
+        const char* b = batch.lines[i].begin();
+        const char* e = batch.lines[i].end();
+        bool timed = i % 8 == 0;
+
+        std::chrono::steady_clock::time_point t0;
+        if(timed)
+            t0 = std::chrono::steady_clock::now();
+        bool m = search ? re.searchRange(b, b, e, nullptr) : re.matchRange(b, e, nullptr);
+        if(timed)
+            latency.add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+        batch.matched[i] = m;
+    }
+}
+
+struct Options
+{
+    Options():search(false), print(false), grep(false), threads(1), blockKB(1024) {}
+
+    bool search;
+    bool print;
+    bool grep;
+    unsigned threads;
+    std::size_t blockKB;
+    std::string pattern;
+    std::string file;
+};
+
+// Runs the driver over a file(stdin if o.file is empty). Returns the number of matching lines.
+std::size_t run(const Options& o, std::ostream& report)
+{
+    std::FILE* in = o.file.empty() ? stdin : std::fopen(o.file.c_str(), "rb");
+    if(!in)
+    {
+        report << "Cannot open " << o.file << std::endl;
+        return 0;
+    }
+
+    std::regex_constants::syntax_option_type flags = o.grep ? std::regex_constants::grep : std::regex_constants::ECMAScript;
+    std::vector<FastRegex> regexes(std::max(o.threads, 1u), FastRegex(o.pattern, flags));    // One per thread
+    std::vector<LatencyHistogram> latencies(regexes.size());
+    std::vector<Batch> batches(regexes.size());
+
+    LineReader reader(in, o.blockKB * 1024);
+    std::size_t lines = 0, matches = 0;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    for(bool more = true; more; )
+    {
+        // Up to one block per thread
+        std::size_t filled = 0;
+        while(filled < batches.size() && (more = reader.next(batches[filled])))
+            ++filled;
+
+        std::vector<std::thread> workers;
+        for(std::size_t t = 0; t < filled; ++t)
+        {
+            Batch& batch = batches[t];
+            batch.matched.assign(batch.lines.size(), 0);
+            if(filled == 1)
+                matchLines(batch, 0, batch.lines.size(), regexes[0], o.search, latencies[0]);
+            else
+                workers.push_back(std::thread(matchLines, std::ref(batch), 0, batch.lines.size(), std::cref(regexes[t]),
+                                              o.search, std::ref(latencies[t])));
+        }
+        for(std::size_t t = 0; t < workers.size(); ++t)
+            workers[t].join();
+
+        for(std::size_t t = 0; t < filled; ++t)
+        {
+            const Batch& batch = batches[t];
+            lines += batch.lines.size();
+            for(std::size_t i = 0; i < batch.lines.size(); ++i)
+            {
+                if(!batch.matched[i])
+                    continue;
+                ++matches;
+                if(o.print)
+                {
+                    std::fwrite(batch.lines[i].data(), 1, batch.lines[i].size(), stdout);
+                    std::fputc('\n', stdout);
+                }
+            }
+        }
+    }
+    std::fflush(stdout);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if(in != stdin)
+        std::fclose(in);
+
+    LatencyHistogram latency;
+    for(std::size_t t = 0; t < latencies.size(); ++t)
+        latency.merge(latencies[t]);
+
+    report << lines << " lines, " << matches << " matches, " << reader.bytes() / (1024.0 * 1024) << " MB in "
+           << secs * 1000 << " ms with " << regexes.size() << " thread(s)" << std::endl;
+    report << "    " << lines / secs << " lines/s, " << matches / secs << " matches/s, "
+           << reader.bytes() / secs / (1024 * 1024) << " MB/s" << std::endl;
+    report << "    latency of a line(" << latency.count() << " timed): p50 " << latency.percentile(50) << " ns, p90 "
+           << latency.percentile(90) << " ns, p99 " << latency.percentile(99) << " ns, p99.9 " << latency.percentile(99.9)
+           << " ns, max " << latency.max() << " ns" << std::endl;
+    return matches;
+}
+
+// The loop of matchPattern(): a word at a time with >>, a line per result with std::endl.
+std::size_t wordLoop(const std::string& path, const std::string& pattern, std::ostream& out)
+{
+    std::ifstream in(path.c_str());
+    std::regex r(pattern);
+    std::string str;
+    std::size_t found = 0;
+    while(in >> str)
+    {
+        if(std::regex_search(str, r))
+        {
+            out << "Pattern found ... " << std::endl;
+            ++found;
+        }
+        else
+            out << "Pattern not found ..." << std::endl;
+    }
+    return found;
+}
+
+void demonstrate()
+{
+    const std::string path = "36_regexBatch.txt";
+    const std::string pattern = "([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)";
+    {
+        std::ofstream out(path.c_str());
+        for(int i = 0; i < 400000; ++i)
+        {
+            if(i % 5 == 0)
+                out << "GET https://www.host" << i % 1000 << ".org/index.html 200\n";
+            else
+                out << "GET /static/file" << i << ".css 304 no_url_here\n";
+        }
+    }
+
+    std::cout << "----------------- Batch driver, regex_search of each line ----------------" << std::endl;
+    Options o;
+    o.search = true;
+    o.pattern = pattern;
+    o.file = path;
+    std::size_t lineMatches = run(o, std::cout);
+
+    unsigned hw = std::max(std::thread::hardware_concurrency(), 1u);
+    if(hw > 1)
+    {
+        o.threads = hw;
+        run(o, std::cout);
+    }
+
+    std::cout << "----------------- matchPattern() loop: >> and std::endl ----------------" << std::endl;
+    std::ofstream sink("/dev/null");
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    std::size_t wordMatches = wordLoop(path, pattern, sink);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << wordMatches << " matching words(" << lineMatches << " matching lines) in " << secs * 1000 << " ms" << std::endl;
+
+    std::remove(path.c_str());
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        demonstrate();
+        return 0;
+    }
+
+    Options o;
+    int i = 1;
+    for(; i < argc && argv[i][0] == '-' && argv[i][1]; ++i)
+    {
+        std::string a = argv[i];
+        if(a == "-s")                       o.search = true;
+        else if(a == "-p")                  o.print = true;
+        else if(a == "-g")                  o.grep = true;
+        else if(a == "-t" && i + 1 < argc)  o.threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if(a == "-b" && i + 1 < argc)  o.blockKB = std::max<std::size_t>(std::strtoul(argv[++i], nullptr, 10), 1);
+        else
+        {
+            std::cerr << "Unknown option " << a << std::endl;
+            return 2;
+        }
+    }
+    if(i >= argc)
+    {
+        std::cerr << "Usage: 36_regexBatch [-s] [-p] [-g] [-t threads] [-b block KB] pattern [file]" << std::endl;
+        return 2;
+    }
+    o.pattern = argv[i++];
+    if(i < argc)
+        o.file = argv[i];
+
+    try
+    {
+        return run(o, o.print ? std::cerr : std::cout) > 0 ? 0 : 1;     // As grep: 1 when nothing matched
+    }
+    catch(const std::regex_error& e)
+    {
+        std::cerr << "Invalid pattern: " << e.what() << std::endl;
+        return 2;
+    }
+}
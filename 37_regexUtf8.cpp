@@ -0,0 +1,203 @@
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+#include <locale>
+#include <codecvt>
+
+#include "regexDFA.h"
+#include "sampleUtil.h"
+
+/*********
+A program to show matching UTF-8 text with Unicode character classes and icase, without converting it.
+
+std::regex sees a std::string as bytes: in "Straße" the 'ß' is the 2 bytes C3 9F, that [[:w:]] does not match
+(they are not alphanumeric in any locale), '.' matches half of it, and icase cannot turn "É" into "é". The usual
+way out converts the text into a std::wstring(4 bytes per character on Linux) for a std::wregex built with a
+UTF-8 locale, then converts the positions of the matches back.
+
+FastRegex(regexDFA.h) with the FastRegex::utf8 flag decodes the pattern instead:
+
+    characters  A character of several bytes is a single atom: "é+" repeats the 2 bytes of 'é'.
+    classes     [[:w:]] \w [[:alpha:]] [[:upper:]] \s ... include the letters and spaces of the common scripts.
+                A set of code points is cut into ranges whose UTF-8 encodings differ only by the range of each
+                byte, e.g. 0800-FFFF into [E0][A0-BF][80-BF] and [E1-EF][80-BF][80-BF], which become an
+                automaton over bytes like any other part of the pattern.
+    icase       The other case of each letter(simple case folding: É/é, Σ/σ, Д/д ...) is added to the sets.
+
+The lazy DFA then runs over the bytes of the std::string as it is: the positions are byte offsets, and nothing
+is converted or allocated.
+
+The matches are compared with the ones of std::wregex(C.UTF-8 locale) on random strings, then the words and a
+rare name(icase) are found in a 16 MB text both ways. Finding every word needs the positions of each match(the
+Pike VM), a rare name only the lazy DFA, whose speed does not depend on the size of the classes.
+*********/
+
+typedef std::wstring_convert<std::codecvt_utf8<wchar_t> > Utf8Converter;
+
+struct Test
+{
+    const char* pattern;
+    bool icase;
+};
+
+// The byte offsets of the matches(and sub-matches) of each implementation
+std::vector<long> fastMatches(const std::string& s, const FastRegex& r)
+{
+    std::vector<long> out;
+    for(fast_sregex_iterator it(s.begin(), s.end(), r), end; it != end; ++it)
+        for(std::size_t i = 0; i < it->size(); ++i)
+        {
+            out.push_back((*it)[i].matched ? (*it)[i].first - s.begin() : -1);
+            out.push_back((*it)[i].matched ? (*it)[i].second - s.begin() : -1);
+        }
+    return out;
+}
+
+std::vector<long> wideMatches(const std::string& s, const std::wregex& r, Utf8Converter& convert)
+{
+    std::wstring w = convert.from_bytes(s);
+    std::vector<long> offset(1, 0);     // The byte offset of each character
+    for(std::size_t i = 0; i < w.size(); ++i)
+        offset.push_back(offset.back() + convert.to_bytes(w[i]).size());
+
+    std::vector<long> out;
+    for(std::wsregex_iterator it(w.begin(), w.end(), r), end; it != end; ++it)
+        for(std::size_t i = 0; i < it->size(); ++i)
+        {
+            out.push_back((*it)[i].matched ? offset[(*it)[i].first - w.begin()] : -1);
+            out.push_back((*it)[i].matched ? offset[(*it)[i].second - w.begin()] : -1);
+        }
+    return out;
+}
+
+bool compareWithWregex(const std::locale& loc)
+{
+    const std::vector<Test> tests = {
+        {"[[:w:]]+", false}, {"\\w+", false}, {"[[:alpha:]]+", false}, {"[[:upper:]][[:lower:]]*", false},
+        {"\\s+", false}, {"\\S+", false}, {".", false}, {"é+", false}, {"[à-ÿ]+", false}, {"[α-ω]+", false},
+        {"[^a-z ]+", false}, {"Straße", false}, {"日本", false}, {"(\\w+)\\s(\\w+)", false}, {"\\u00e9|\\u65e5", false},
+        {"[[:punct:]]", false}, {"é|ω|ä", true}, {"straße", true}, {"[а-я]+", true}, {"σοφία", true}, {"[^é]", true},
+        {"(Ω)(д*)ё", true}, {"[[:alpha:]]+", true}
+    };
+    const std::vector<std::string> pieces = {
+        "a", "Z", "é", "É", "ä", "Ä", "ß", "ẞ", "Ω", "ω", "ά", "Ά", "σ", "Σ", "д", "Д", "ё", "Ё", "日", "本", "語", "Straße",
+        " ", "\xe3\x80\x80", "\t", "\n", "\r", ",", "—", "€", "5", "_", "σοφία", "ΣΟΦΊΑ", "ÿ", "Ÿ"
+    };
+    RandomPieces random(pieces, 20, 37);
+    Utf8Converter convert;
+
+    bool same = true;
+    for(const Test& t : tests)
+    {
+        std::regex_constants::syntax_option_type f = t.icase ? std::regex_constants::icase : std::regex_constants::ECMAScript;
+        FastRegex fr(t.pattern, FastRegex::utf8 | f);
+        std::wregex wr;
+        wr.imbue(loc);
+        wr.assign(convert.from_bytes(t.pattern), f);
+
+        int bad = 0;
+        for(int n = 0; n < 3000; ++n)
+        {
+            std::string s = random();
+            if(fastMatches(s, fr) != wideMatches(s, wr, convert) && ++bad == 1)
+                std::cout << "    different for \"" << s << "\"" << std::endl;
+        }
+        std::cout << t.pattern << (t.icase ? "(icase)" : "") << (bad ? ": DIFFERENT" : ": same") << std::endl;
+        same = same && bad == 0;
+    }
+    return same;
+}
+
+int main()
+{
+    std::string text = "Ça coûte 5 € — Straße, ΣΟΦΊΑ σοφία, Москва, 日本語のテキスト";
+
+    std::cout << "----------------- [[:w:]]+ on bytes and on UTF-8 ----------------" << std::endl;
+    FastRegex bytes("[[:w:]]+");
+    FastRegex words("[[:w:]]+", FastRegex::utf8);
+    std::cout << "bytes:";
+    for(fast_sregex_iterator it(text.begin(), text.end(), bytes), end; it != end; ++it)
+        std::cout << " [" << it->view() << "]";
+    std::cout << std::endl << "UTF-8:";
+    for(fast_sregex_iterator it(text.begin(), text.end(), words), end; it != end; ++it)
+        std::cout << " [" << it->view() << "]";
+    std::cout << std::endl;
+
+    std::cout << "----------------- icase ----------------" << std::endl;
+    FastRegex names("ça|straße|σοφία|москва", FastRegex::utf8 | std::regex_constants::icase);
+    std::string upper = "ÇA, STRAẞE, ΣΟΦΊΑ, МОСКВА";
+    for(fast_sregex_iterator it(upper.begin(), upper.end(), names), end; it != end; ++it)
+        std::cout << "[" << it->view() << "] at byte " << it->position() << std::endl;
+
+    std::cout << "----------------- Invalid UTF-8 and unsupported patterns ----------------" << std::endl;
+    std::string broken = "caf\xc3 caf\xc3\xa9";
+    fast_smatch m;
+    if(fast_regex_search(broken, m, FastRegex("caf.", FastRegex::utf8)))
+        std::cout << "caf. found at byte " << m.position() << ", the truncated 'é' is not a character" << std::endl;
+    try
+    {
+        FastRegex boundary("\\bword\\b", FastRegex::utf8);
+    }
+    catch(const RegexUtf8Unsupported& e)
+    {
+        std::cout << "\\bword\\b: " << e.what() << ", error_escape: " << std::boolalpha
+                  << (e.code() == std::regex_constants::error_escape) << std::endl;
+    }
+
+    std::cout << "----------------- Same matches as std::wregex ----------------" << std::endl;
+    std::locale loc;
+    bool same = true;
+    try
+    {
+        loc = std::locale("C.UTF-8");
+    }
+    catch(const std::runtime_error&)
+    {
+        std::cout << "No C.UTF-8 locale, std::wregex cannot be compared" << std::endl;
+        loc = std::locale::classic();
+    }
+    if(loc != std::locale::classic())
+    {
+        same = compareWithWregex(loc);
+        std::cout << "Same matches for all patterns: " << std::boolalpha << same << std::endl;
+    }
+
+    std::cout << "----------------- A 16 MB UTF-8 text ----------------" << std::endl;
+    const std::vector<std::string> sentences = {
+        "Ça coûte 5 € — rendez-vous à la gare.", "Die Straße ist lang, aber schön.", "Η σοφία είναι δύναμη.",
+        "Москва — столица России.", "日本語のテキストを検索する。"
+    };
+    std::string big;
+    for(int i = 0; big.size() < (16 << 20); ++i)
+        big += (i % 1000 == 999) ? "Abfahrt nach ZÜRICH um 8 Uhr.\n" : sentences[i % sentences.size()] + "\n";
+
+    Utf8Converter convert;
+    std::size_t wideBytes = 0;
+    auto wideCount = [&](const wchar_t* pattern, std::regex_constants::syntax_option_type f) {
+        std::wstring w = convert.from_bytes(big);
+        wideBytes = w.size() * sizeof(wchar_t);
+        std::wregex wr;
+        wr.imbue(loc);
+        wr.assign(pattern, f);
+        std::size_t count = 0;
+        for(std::wsregex_iterator it(w.begin(), w.end(), wr), end; it != end; ++it)
+            ++count;
+        return count;
+    };
+    auto fastCount = [&](const FastRegex& fr) {
+        std::size_t count = 0;
+        for(fast_sregex_iterator it(big.begin(), big.end(), fr), end; it != end; ++it)
+            ++count;
+        return count;
+    };
+
+    FastRegex zurich("zürich", FastRegex::utf8 | std::regex_constants::icase);
+    double base = measureBytes("[[:w:]]+     wstring_convert + wsregex_iterator", [&]() { return wideCount(L"[[:w:]]+", std::regex_constants::ECMAScript); }, big.size(), 0);
+    measureBytes("[[:w:]]+     fast_sregex_iterator(utf8)        ", [&]() { return fastCount(words); }, big.size(), base);
+    base = measureBytes("zürich icase wstring_convert + wsregex_iterator", [&]() { return wideCount(L"zürich", std::regex_constants::icase); }, big.size(), 0);
+    measureBytes("zürich icase fast_sregex_iterator(utf8)        ", [&]() { return fastCount(zurich); }, big.size(), base);
+    std::cout << "The std::wstring takes " << wideBytes / (1024 * 1024) << " MB more, the UTF-8 text is matched in place" << std::endl;
+
+    return same ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "regexDFA.h"
+#include "sampleUtil.h"
+
+/*********
+A program to show case-insensitive matching without translating each character through the locale.
+
+14_regularExp_Iter.cpp builds its URL pattern with std::regex_constants::icase. libstdc++ then translates every
+character it compares by regex_traits::translate_nocase(), a call of ctype<char>::tolower() of the locale of the
+regex, on the pattern side and on the text side, at each step of the backtracking.
+
+FastRegex(regexDFA.h) folds the pattern once, when it is parsed(RegexByteFold):
+
+    literals    "a" becomes the class [aA]: the bytes whose tolower() is the same, from a 256 entry table built
+                from the regex_traits of the pattern.
+    classes     [a-c] becomes [a-cA-C], [^b] excludes 'b' and 'B', [[:lower:]] matches the letters of both cases.
+
+After that an icase pattern is an ordinary case-sensitive one, and the lazy DFA costs the same per character.
+The literal of the prefilter("GET " in "get /[a-z]+" ...) is searched caseless by LiteralScanner: each character
+of the text is ORed with 0x20 before it is compared with the lower case literal, 16(32) at once with SSE2(AVX2).
+
+The matches are compared with the ones of std::regex(icase) on random strings, then both are timed with and
+without icase on a log.
+*********/
+
+template<class M>
+std::vector<long> positions(const M& m)
+{
+    std::vector<long> out;
+    for(std::size_t i = 0; i < m.size(); ++i)
+    {
+        out.push_back(m[i].matched ? m.position(i) : -1);
+        out.push_back(m[i].matched ? m.length(i) : -1);
+    }
+    return out;
+}
+
+bool compareWithStd(const std::vector<std::string>& patterns)
+{
+    const std::vector<std::string> pieces = {
+        "get", "GET", "Get", "post", "POST", " /", "Index", "://", "HTTPS", "http", "www", ".", "Gnu", "ORG",
+        "error: ", "ERROR: ", "disk", "DISK", "a", "Z", "[", "`", "{", "@", "\xe9", "\xc9", "\n", "2024"
+    };
+    RandomPieces random(pieces, 30, 15);
+
+    bool same = true;
+    for(const std::string& p : patterns)
+    {
+        std::regex r(p, std::regex_constants::icase);
+        FastRegex fr(p, std::regex_constants::icase);
+        int bad = 0;
+        for(int n = 0; n < 2000; ++n)
+        {
+            std::string s = random();
+
+            std::vector<long> a, b;
+            for(std::sregex_iterator it(s.begin(), s.end(), r), end; it != end; ++it)
+            {
+                std::vector<long> m = positions(*it);
+                a.insert(a.end(), m.begin(), m.end());
+            }
+            for(fast_sregex_iterator it(s.begin(), s.end(), fr), end; it != end; ++it)
+            {
+                std::vector<long> m = positions(*it);
+                b.insert(b.end(), m.begin(), m.end());
+            }
+            bad += a != b;
+        }
+        const RegexPrefilter* pf = fr.prefilter();
+        bool caseless = pf && pf->scanner.caseless().find_first_not_of('\0') != std::string::npos;
+        std::cout << p << ": " << (fr.usesDFA() ? "DFA" : fr.backtrackProgram() ? "backtracking" : "std::regex") << (pf ? ", prefilter \"" + printable(pf->scanner.literal()) + "\"" : "")
+                  << (caseless ? "(caseless)" : "") << (bad ? ", DIFFERENT" : ", same") << std::endl;
+        same = same && bad == 0;
+    }
+    return same;
+}
+
+int main()
+{
+    const std::string url = "([[:w:]]+)://([[:w:]]+).([[:w:]]+).([[:w:]]+)";
+
+    std::cout << "----------------- The URL pattern of 14_regularExp_Iter.cpp, icase ----------------" << std::endl;
+    std::string strs = "HTTPS://WWW.GOOGLE.COM; http://www.yahoo.co.in;; Http://Www.Gnu.Org";
+    FastRegex urls(url, std::regex_constants::icase);
+    for(fast_sregex_iterator it(strs.begin(), strs.end(), urls), end; it != end; ++it)
+        std::cout << it->view(3) << " is accessed via " << it->view(1) << std::endl;
+
+    std::cout << "----------------- Same matches as std::regex(icase) ----------------" << std::endl;
+    bool same = compareWithStd({
+        url, "get|post", "get /[a-z]+", "error: disk", "https?://www\\.gnu\\.org", "[[:upper:]]+", "[[:lower:]]{2}",
+        "[^a-z ]+", "[Z-a]", "[a-c]g", "\\w+@\\w+", "(e)rror(:) (d)isk", "caf\\xe9", "(get|post)[^\\n]*\\1", "(disk)\\1"
+    });
+    std::cout << "Same matches for all patterns: " << std::boolalpha << same << std::endl;
+
+    std::cout << "----------------- An 8 MB log ----------------" << std::endl;
+    std::string log;
+    for(int i = 0; log.size() < (8 << 20); ++i)
+    {
+        switch(i % 4)
+        {
+        case 0: log += "GET /index.html 200 from https://www.gnu.org\n"; break;
+        case 1: log += "Post /api/v2/items 201 " + std::to_string(i) + "\n"; break;
+        case 2: log += (i % 400 == 2) ? "ERROR: Disk full on /var\n" : "get /favicon.ico 404\n"; break;
+        default: log += "see HTTP://WWW.YAHOO.CO.IN for details\n"; break;
+        }
+    }
+
+    for(const std::string& p : { url, std::string("error: disk") })
+    {
+        std::cout << p << std::endl;
+        std::regex r(p);
+        std::regex ri(p, std::regex_constants::icase);
+        FastRegex fr(p);
+        FastRegex fri(p, std::regex_constants::icase);
+
+        auto stdCount = [&log](const std::regex& re) {
+            std::size_t count = 0;
+            for(std::sregex_iterator it(log.begin(), log.end(), re), end; it != end; ++it)
+                ++count;
+            return count;
+        };
+        auto fastCount = [&log](const FastRegex& re) {
+            std::size_t count = 0;
+            for(fast_sregex_iterator it(log.begin(), log.end(), re), end; it != end; ++it)
+                ++count;
+            return count;
+        };
+        double base = measureBytes("    std::regex          ", [&]() { return stdCount(r); }, log.size(), 0);
+        double secs = measureBytes("    std::regex, icase   ", [&]() { return stdCount(ri); }, log.size(), 0);
+        std::cout << "    icase costs " << secs / base << " times case-sensitive" << std::endl;
+        base = measureBytes("    FastRegex           ", [&]() { return fastCount(fr); }, log.size(), 0);
+        secs = measureBytes("    FastRegex, icase    ", [&]() { return fastCount(fri); }, log.size(), 0);
+        std::cout << "    icase costs " << secs / base << " times case-sensitive" << std::endl;
+    }
+
+    return same ? 0 : 1;
+}
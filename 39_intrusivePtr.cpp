@@ -0,0 +1,388 @@
+#include <iostream>
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+#include "sampleUtil.h"
+
+/*********
+A program to show a reference counted pointer whose count lives inside the object(an intrusive count).
+
+9_SharedPtr.cpp manages a Shape with std::shared_ptr. std::shared_ptr<Shape>(new Shape(123)) allocates a control
+block(the use count, the weak count and the deleter) besides the Shape, and each copy increments a count that is
+on another cache line than the Shape. make_shared puts both in one allocation, but the shared_ptr is still two
+pointers, and a Shape cannot be given back to a shared_ptr from a raw pointer(the #if 0 part of 9_SharedPtr.cpp).
+
+IntrusivePtr<T> is a single pointer to a T derived from RefCounted, which holds the count and the deleter:
+
+    IntrusivePtr<Shape> p(new Shape(123))           the first owner sets the deleter(delete of the type given)
+    IntrusivePtr<Shape> p(new Shape[3], deleter)    a custom deleter, a function or a lambda without captures
+    make_intrusive<Shape>(1000)                     the same as IntrusivePtr<Shape>(new Shape(1000))
+
+    use_count(), get(), unique(), reset(), reset(ptr), operator->, operator*, static_pointer_cast,
+    dynamic_pointer_cast and const_pointer_cast behave as the ones of shared_ptr.
+
+As the count is in the object, a raw pointer can be given to several IntrusivePtr, they share the count.
+There is no weak pointer: the count is destroyed with the object(40_sharedPtrPolicy.cpp has weak pointers).
+
+The count is incremented relaxed and decremented with acq_rel. The locked instruction is skipped when the count is
+1, for the first owner and the last one: without weak pointers, nobody else can reach the object of a last owner.
+The moves are noexcept, so a growing vector of IntrusivePtr moves them instead of copying(a count update each).
+The creation, copy and destruction are then timed against shared_ptr and make_shared, on a single thread and with
+all threads copying the same pointer.
+*********/
+
+// The base of the objects managed by IntrusivePtr: the count and the deleter of the object.
+class RefCounted
+{
+public:
+    long use_count() const { return _refs.load(std::memory_order_relaxed); }
+
+protected:
+    RefCounted():_refs(0), _destroy(nullptr), _deleter(nullptr) {}
+    RefCounted(const RefCounted&):_refs(0), _destroy(nullptr), _deleter(nullptr) {}    // A copy has no owner yet
+    RefCounted& operator=(const RefCounted&) { return *this; }                          // The count stays
+    ~RefCounted() {}
+
+private:
+    template<class T> friend class IntrusivePtr;
+
+    typedef void (*Function)();     // Any function pointer, cast back to its type to be called
+    typedef void (*Destroy)(RefCounted*, Function);
+
+    template<class Y>
+    static void deleteAs(RefCounted* p, Function) { delete static_cast<Y*>(p); }
+
+    template<class Y>
+    static void callDeleter(RefCounted* p, Function deleter) { reinterpret_cast<void (*)(Y*)>(deleter)(static_cast<Y*>(p)); }
+
+    // A new object is given to its first owner by a single thread: the count is then set without a locked
+    // instruction. The last owner destroys the object without decrementing, as nobody else can copy it.
+    void adopt(Destroy destroy, Function deleter) const
+    {
+        if(_refs.load(std::memory_order_relaxed) == 0)
+        {
+            _refs.store(1, std::memory_order_relaxed);
+            _destroy = destroy;
+            _deleter = deleter;
+        }
+        else
+            retain();
+    }
+
+    void retain() const { _refs.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() const
+    {
+        // The acquire makes the writes of the other owners, done before their release, seen by the destructor.
+        if(_refs.load(std::memory_order_acquire) == 1 || _refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            _destroy(const_cast<RefCounted*>(this), _deleter);
+    }
+
+    mutable std::atomic<long> _refs;
+    mutable Destroy _destroy;
+    mutable Function _deleter;
+};
+
+template<class T>
+class IntrusivePtr
+{
+public:
+    typedef T element_type;
+
+    IntrusivePtr():_p(nullptr) {}
+    IntrusivePtr(std::nullptr_t):_p(nullptr) {}
+
+    template<class Y>
+    explicit IntrusivePtr(Y* p):_p(p)
+    {
+        if(p)
+            base(p)->adopt(&RefCounted::deleteAs<Y>, nullptr);
+    }
+
+    // d is called instead of delete, once the last owner is gone. It is a function or a lambda without captures.
+    template<class Y, class D>
+    IntrusivePtr(Y* p, D d):_p(p)
+    {
+        void (*deleter)(Y*) = d;
+        if(p)
+            base(p)->adopt(&RefCounted::callDeleter<Y>, reinterpret_cast<RefCounted::Function>(deleter));
+    }
+
+    IntrusivePtr(const IntrusivePtr& other):_p(other._p) { if(_p) base(_p)->retain(); }
+    IntrusivePtr(IntrusivePtr&& other) noexcept:_p(other._p) { other._p = nullptr; }
+
+    template<class Y>
+    IntrusivePtr(const IntrusivePtr<Y>& other):_p(other._p) { if(_p) base(_p)->retain(); }
+
+    template<class Y>
+    IntrusivePtr(IntrusivePtr<Y>&& other) noexcept:_p(other._p) { other._p = nullptr; }
+
+    ~IntrusivePtr() { if(_p) base(_p)->release(); }
+
+    IntrusivePtr& operator=(const IntrusivePtr& other) { IntrusivePtr(other).swap(*this); return *this; }
+    IntrusivePtr& operator=(IntrusivePtr&& other) noexcept { IntrusivePtr(std::move(other)).swap(*this); return *this; }
+    IntrusivePtr& operator=(std::nullptr_t) { reset(); return *this; }
+
+    void reset() { IntrusivePtr().swap(*this); }
+
+    template<class Y>
+    void reset(Y* p) { IntrusivePtr(p).swap(*this); }
+
+    template<class Y, class D>
+    void reset(Y* p, D d) { IntrusivePtr(p, d).swap(*this); }
+
+    void swap(IntrusivePtr& other) noexcept { std::swap(_p, other._p); }
+
+    T* get() const { return _p; }
+    T& operator*() const { return *_p; }
+    T* operator->() const { return _p; }
+    explicit operator bool() const { return _p != nullptr; }
+
+    long use_count() const { return _p ? base(_p)->use_count() : 0; }
+    bool unique() const { return use_count() == 1; }
+
+private:
+    template<class Y> friend class IntrusivePtr;
+
+    static const RefCounted* base(const RefCounted* p) { return p; }
+
+    T* _p;
+};
+
+template<class T, class U>
+bool operator==(const IntrusivePtr<T>& a, const IntrusivePtr<U>& b) { return a.get() == b.get(); }
+
+template<class T, class U>
+bool operator!=(const IntrusivePtr<T>& a, const IntrusivePtr<U>& b) { return a.get() != b.get(); }
+
+template<class T>
+bool operator==(const IntrusivePtr<T>& a, std::nullptr_t) { return !a; }
+
+template<class T>
+bool operator!=(const IntrusivePtr<T>& a, std::nullptr_t) { return static_cast<bool>(a); }
+
+template<class T, class... Args>
+IntrusivePtr<T> make_intrusive(Args&&... args)
+{
+    return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
+}
+
+// The casts share the count of p: the object has an owner already, its deleter stays.
+template<class T, class U>
+IntrusivePtr<T> static_pointer_cast(const IntrusivePtr<U>& p) { return IntrusivePtr<T>(static_cast<T*>(p.get())); }
+
+template<class T, class U>
+IntrusivePtr<T> dynamic_pointer_cast(const IntrusivePtr<U>& p) { return IntrusivePtr<T>(dynamic_cast<T*>(p.get())); }
+
+template<class T, class U>
+IntrusivePtr<T> const_pointer_cast(const IntrusivePtr<U>& p) { return IntrusivePtr<T>(const_cast<T*>(p.get())); }
+
+class Shape : public RefCounted
+{
+public:
+    static bool verbose;    // Off for the benchmarks
+
+    Shape() { if(verbose) std::cout << "Shape constructor <" << this << ">" << std::endl; }
+    Shape(int i):_i(i) { if(verbose) std::cout << "Shape constructor <" << this << "> i:" << _i << std::endl; }
+    Shape(const Shape& foo):RefCounted(foo), _i(foo._i) { if(verbose) std::cout << "Shape copy constructor <" << this << ">" << std::endl; }
+
+    virtual ~Shape() { if(verbose) std::cout << "Shape destructor <" << this << ">" << std::endl; }
+
+    virtual void draw() { std::cout << "Inside Shape::draw(), _i:" << _i << std::endl; }
+    int id() const { return _i; }
+protected:
+    int _i;
+};
+
+bool Shape::verbose = true;
+
+static_assert(std::is_nothrow_move_constructible<IntrusivePtr<Shape> >::value, "IntrusivePtr: a growing vector would copy, and count");
+
+class Circle : public Shape
+{
+public:
+    Circle(int i):Shape(i) {}
+    void draw() { std::cout << "Inside Circle::draw(), _i:" << _i << std::endl; }
+};
+
+void print(const IntrusivePtr<Shape>& ip)
+{
+    std::cout << "use_count:" << ip.use_count() << ", get(): " << ip.get()
+              << ", unique(): " << std::boolalpha << ip.unique() << std::endl;
+
+    ip->draw();
+}
+
+// Creates and destroys n objects, one at a time.
+template<class Make>
+long createDestroy(Make make, int n)
+{
+    long sum = 0;
+    for(int i = 0; i < n; ++i)
+        sum += make(i)->id();
+    return sum;
+}
+
+// Copies the pointers in the order given and reads each object: the count and the object are touched together.
+template<class P>
+long copyDestroy(const std::vector<P>& ptrs, const std::vector<int>& order)
+{
+    long sum = 0;
+    for(int i : order)
+    {
+        P copy = ptrs[i];
+        sum += copy->id();
+    }
+    return sum;
+}
+
+// Copies the whole vector, then destroys the copy: the counts are incremented and decremented in order.
+template<class P>
+long copyVector(const std::vector<P>& ptrs, int times)
+{
+    long sum = 0;
+    for(int t = 0; t < times; ++t)
+    {
+        std::vector<P> copy = ptrs;
+        sum += copy.back()->id();
+    }
+    return sum;
+}
+
+// Each thread copies the same pointer n times: the count of the one object is contended.
+template<class P>
+long contended(const P& shared, unsigned threads, int n)
+{
+    std::vector<long> sums(threads, 0);
+    std::vector<std::thread> workers;
+    for(unsigned t = 0; t < threads; ++t)
+        workers.push_back(std::thread([&shared, &sums, t, n]() {
+            long sum = 0;
+            for(int i = 0; i < n; ++i)
+            {
+                P copy = shared;
+                sum += copy->id();
+            }
+            sums[t] = sum;
+        }));
+    for(std::thread& w : workers)
+        w.join();
+
+    long sum = 0;
+    for(long s : sums)
+        sum += s;
+    return sum;
+}
+
+int main()
+{
+    IntrusivePtr<Shape> ip1(new Shape(123));
+    std::cout << "----------------- ip1 ----------------" << std::endl;
+    print(ip1);
+
+    IntrusivePtr<Shape> ip2 = ip1;
+    std::cout << "----------------- ip2 ----------------" << std::endl;
+    print(ip2);
+
+    IntrusivePtr<Shape> ip3 = make_intrusive<Shape>(1000);
+    std::cout << "----------------- ip3 ----------------" << std::endl;
+    print(ip3);
+
+    std::cout << "Calling draw() using the dereference operator" << std::endl;
+    (*ip3).draw();
+
+    IntrusivePtr<Shape> ip4 = make_intrusive<Shape>(50);
+    ip3 = ip4;
+    std::cout << "After ip3 = ip4, ip3.get(): " << ip3.get() << ", ip3.use_count():" << ip3.use_count()
+              << ", ip4.get(): " << ip4.get() << ", ip4.use_count(): " << ip4.use_count() << std::endl;
+
+    ip3 = nullptr;
+    std::cout << "After ip3 = nullptr, ip3.get(): " << ip3.get() << ", ip3.use_count():" << ip3.use_count()
+              << ", ip4.get(): " << ip4.get() << ", ip4.use_count(): " << ip4.use_count() << std::endl;
+
+    ip4.reset();
+    std::cout << "After ip4.reset(), ip4.get(): " << ip4.get() << ", ip4.use_count():" << ip4.use_count() << std::endl;
+
+    std::cout << "----------------- Custom deleters ----------------" << std::endl;
+    IntrusivePtr<Shape> ip(new Shape(1122), [](Shape* s) { std::cout << "Using custom delete..." << std::endl; delete s; });
+    ip.reset();
+    IntrusivePtr<Shape> ipArr(new Shape[3], [](Shape* s) { std::cout << "Using delete[]..." << std::endl; delete[] s; });
+    ipArr = nullptr;
+
+    std::cout << "----------------- Casts ----------------" << std::endl;
+    IntrusivePtr<Shape> shape = make_intrusive<Circle>(7);      // Deleted as a Circle
+    IntrusivePtr<Circle> circle = dynamic_pointer_cast<Circle>(shape);
+    IntrusivePtr<const Shape> constShape = static_pointer_cast<const Shape>(circle);
+    IntrusivePtr<Shape> again = const_pointer_cast<Shape>(constShape);
+    std::cout << "dynamic_pointer_cast<Circle>: " << (circle ? "a Circle" : "not a Circle") << ", use_count: " << shape.use_count() << std::endl;
+    again->draw();
+    circle = nullptr;
+    constShape = nullptr;
+    again = nullptr;
+    shape = nullptr;
+
+    // The #if 0 part of 9_SharedPtr.cpp is fine here: both pointers share the count that is in the object.
+    std::cout << "----------------- The same raw pointer twice ----------------" << std::endl;
+    Shape* raw = new Shape(12345);
+    {
+        IntrusivePtr<Shape> a(raw);
+        IntrusivePtr<Shape> b(raw);
+        std::cout << "use_count: " << b.use_count() << std::endl;
+    }
+
+    std::cout << "----------------- Sizes ----------------" << std::endl;
+    std::cout << "sizeof(shared_ptr<Shape>): " << sizeof(std::shared_ptr<Shape>) << ", sizeof(IntrusivePtr<Shape>): "
+              << sizeof(IntrusivePtr<Shape>) << ", sizeof(Shape) with its count: " << sizeof(Shape) << std::endl;
+
+    Shape::verbose = false;
+    const int n = 2000000;
+
+    std::cout << "----------------- Create and destroy " << n << " objects ----------------" << std::endl;
+    double base = measure("shared_ptr(new Shape)", [&]() { return createDestroy([](int i) { return std::shared_ptr<Shape>(new Shape(i)); }, n); }, n, 0);
+    measure("make_shared          ", [&]() { return createDestroy([](int i) { return std::make_shared<Shape>(i); }, n); }, n, base);
+    measure("IntrusivePtr(new)    ", [&]() { return createDestroy([](int i) { return IntrusivePtr<Shape>(new Shape(i)); }, n); }, n, base);
+    measure("make_intrusive       ", [&]() { return createDestroy([](int i) { return make_intrusive<Shape>(i); }, n); }, n, base);
+
+    // The objects are visited in a random order, so the counts are not in the cache.
+    const int objects = 1 << 20;
+    std::vector<int> order(objects);
+    for(int i = 0; i < objects; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(16));
+
+    std::vector<std::shared_ptr<Shape> > sps, mss;
+    std::vector<IntrusivePtr<Shape> > ips;
+    for(int i = 0; i < objects; ++i)
+    {
+        sps.push_back(std::shared_ptr<Shape>(new Shape(i)));
+        mss.push_back(std::make_shared<Shape>(i));
+        ips.push_back(make_intrusive<Shape>(i));
+    }
+
+    std::cout << "----------------- Copy, read and destroy " << objects << " pointers, random order ----------------" << std::endl;
+    base = measure("shared_ptr(new Shape)", [&]() { return copyDestroy(sps, order); }, objects, 0);
+    measure("make_shared          ", [&]() { return copyDestroy(mss, order); }, objects, base);
+    measure("IntrusivePtr         ", [&]() { return copyDestroy(ips, order); }, objects, base);
+
+    std::cout << "----------------- Copy and destroy a vector of " << objects << " pointers, 4 times ----------------" << std::endl;
+    base = measure("shared_ptr(new Shape)", [&]() { return copyVector(sps, 4); }, 4 * std::size_t(objects), 0);
+    measure("make_shared          ", [&]() { return copyVector(mss, 4); }, 4 * std::size_t(objects), base);
+    measure("IntrusivePtr         ", [&]() { return copyVector(ips, 4); }, 4 * std::size_t(objects), base);
+
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 2u);
+    const int copies = 1000000;
+    std::cout << "----------------- " << threads << " threads copying the same pointer " << copies << " times ----------------" << std::endl;
+    base = measure("shared_ptr(new Shape)", [&]() { return contended(sps.back(), threads, copies); }, threads * std::size_t(copies), 0);
+    measure("make_shared          ", [&]() { return contended(mss.back(), threads, copies); }, threads * std::size_t(copies), base);
+    measure("IntrusivePtr         ", [&]() { return contended(ips.back(), threads, copies); }, threads * std::size_t(copies), base);
+
+    return 0;
+}
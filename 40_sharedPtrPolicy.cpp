@@ -0,0 +1,458 @@
+#include <iostream>
+#include <memory>       // std::bad_weak_ptr
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <new>
+#include <type_traits>
+#include <cstddef>
+#include <utility>
+
+#include "sampleUtil.h"
+
+/*********
+A program to show a shared pointer whose counts are atomic or not, chosen at compile time.
+
+Each copy of a std::shared_ptr(sp2 = sp1, sp3 = sp4 in 9_SharedPtr.cpp) increments and decrements the use count
+with a locked instruction, as another thread may own a copy of the same pointer. An event loop that runs on a
+single thread pays for it on every copy.
+
+SharedPtr<T, Policy> and WeakPtr<T, Policy> are a shared_ptr and a weak_ptr whose counts are handled by Policy:
+
+    AtomicCount     std::atomic<long>, as std::shared_ptr: the copies can be used by several threads.
+    PlainCount      a long: the pointers, and all their copies, stay on one thread.
+
+    LocalPtr<T>     is SharedPtr<T, PlainCount>, LocalWeakPtr<T> is WeakPtr<T, PlainCount>.
+
+The two policies give different types, a LocalPtr cannot be converted into a SharedPtr<T, AtomicCount> by mistake.
+The counts are in a control block, not in the object as for IntrusivePtr(39_intrusivePtr.cpp): a WeakPtr
+needs them to outlive the object.
+
+SharedPtr:  use_count(), get(), unique(), reset(), reset(ptr), reset(ptr, deleter), operator->, operator*, and a
+            construction from a WeakPtr that throws std::bad_weak_ptr when it is expired.
+WeakPtr:    use_count(), expired(), lock(), reset(), as in 10_weak_ptr.cpp.
+
+make_shared_ptr<T, Policy>(args...) puts the object and the counts in a single allocation, as make_shared. The
+object is destroyed when the use count becomes 0, the memory is freed when the weak count becomes 0 too(the use
+count holds one weak count, as in libstdc++).
+
+printWP() of 10_weak_ptr.cpp is run with both policies, then the copies, lock() and make_shared_ptr are timed
+against std::shared_ptr. libstdc++ itself uses plain counts while a program has a single thread(it looks at
+__libc_single_threaded of glibc), so the timings are taken before and after a std::thread was started: once it
+has been, every std::shared_ptr of the program pays for the atomics, also the ones that stay on a single thread.
+*********/
+
+struct AtomicCount
+{
+    typedef std::atomic<long> type;
+    static const bool singleThreaded = false;
+
+    static long load(const type& c) { return c.load(std::memory_order_acquire); }
+    static void increment(type& c) { c.fetch_add(1, std::memory_order_relaxed); }
+    static long decrement(type& c) { return c.fetch_sub(1, std::memory_order_acq_rel) - 1; }
+
+    // The count of an expired object must stay 0: it is incremented only if it is not 0 yet.
+    static bool incrementIfNotZero(type& c)
+    {
+        long n = c.load(std::memory_order_relaxed);
+        while(n != 0)
+            if(c.compare_exchange_weak(n, n + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+                return true;
+        return false;
+    }
+};
+
+struct PlainCount
+{
+    typedef long type;
+    static const bool singleThreaded = true;
+
+    static long load(const type& c) { return c; }
+    static void increment(type& c) { ++c; }
+    static long decrement(type& c) { return --c; }
+    static bool incrementIfNotZero(type& c) { return c != 0 && ++c; }
+};
+
+// The counts of an object, and the way to destroy it.
+template<class Policy>
+class ControlBlock
+{
+public:
+    ControlBlock():_uses(1), _weaks(1) {}
+    virtual ~ControlBlock() {}
+
+    void retain() { Policy::increment(_uses); }
+    void retainWeak() { Policy::increment(_weaks); }
+    bool lock() { return Policy::incrementIfNotZero(_uses); }
+    long useCount() const { return Policy::load(_uses); }
+
+    void release()
+    {
+        // The last owner with no weak pointer: nobody else can reach the counts, no decrement is needed. Only on a
+        // single thread: with atomic counts, the two loads are two steps, and a WeakPtr of another thread may
+        // lock() between them, then drop its weak count.
+        if(Policy::singleThreaded && Policy::load(_uses) == 1 && Policy::load(_weaks) == 1)
+        {
+            dispose();
+            delete this;
+        }
+        else if(Policy::decrement(_uses) == 0)
+        {
+            dispose();
+            releaseWeak();      // The one held by the owners
+        }
+    }
+
+    void releaseWeak()
+    {
+        if(Policy::decrement(_weaks) == 0)
+            delete this;
+    }
+
+protected:
+    virtual void dispose() = 0;     // Destroys the object
+
+private:
+    ControlBlock(const ControlBlock&) = delete;
+    ControlBlock& operator=(const ControlBlock&) = delete;
+
+    typename Policy::type _uses;
+    typename Policy::type _weaks;
+};
+
+// A block for an object allocated by the caller, destroyed by a deleter.
+template<class Policy, class Y, class D>
+class PointerBlock : public ControlBlock<Policy>
+{
+public:
+    PointerBlock(Y* p, D d):_p(p), _d(std::move(d)) {}
+protected:
+    void dispose() { _d(_p); }
+private:
+    Y* _p;
+    D _d;
+};
+
+// A block holding the object itself, for make_shared_ptr.
+template<class Policy, class T>
+class InplaceBlock : public ControlBlock<Policy>
+{
+public:
+    template<class... Args>
+    explicit InplaceBlock(Args&&... args) { new (&_storage) T(std::forward<Args>(args)...); }
+
+    T* get() { return reinterpret_cast<T*>(&_storage); }
+protected:
+    void dispose() { get()->~T(); }
+private:
+    typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type _storage;
+};
+
+template<class T, class Policy> class WeakPtr;
+
+template<class T, class Policy = AtomicCount>
+class SharedPtr
+{
+public:
+    typedef T element_type;
+
+    SharedPtr():_p(nullptr), _cb(nullptr) {}
+    SharedPtr(std::nullptr_t):_p(nullptr), _cb(nullptr) {}
+
+    template<class Y>
+    explicit SharedPtr(Y* p):_p(p), _cb(nullptr) { adopt(p, std::default_delete<Y>()); }
+
+    template<class Y, class D>
+    SharedPtr(Y* p, D d):_p(p), _cb(nullptr) { adopt(p, std::move(d)); }
+
+    SharedPtr(const SharedPtr& other):_p(other._p), _cb(other._cb) { if(_cb) _cb->retain(); }
+    SharedPtr(SharedPtr&& other) noexcept:_p(other._p), _cb(other._cb) { other._p = nullptr; other._cb = nullptr; }
+
+    template<class Y>
+    SharedPtr(const SharedPtr<Y, Policy>& other):_p(other._p), _cb(other._cb) { if(_cb) _cb->retain(); }
+
+    // Throws std::bad_weak_ptr when the object is gone, as the std::shared_ptr constructor.
+    template<class Y>
+    explicit SharedPtr(const WeakPtr<Y, Policy>& weak):_p(nullptr), _cb(nullptr)
+    {
+        if(!weak._cb || !weak._cb->lock())
+            throw std::bad_weak_ptr();
+        _p = weak._p;
+        _cb = weak._cb;
+    }
+
+    ~SharedPtr() { if(_cb) _cb->release(); }
+
+    SharedPtr& operator=(const SharedPtr& other) { SharedPtr(other).swap(*this); return *this; }
+    SharedPtr& operator=(SharedPtr&& other) noexcept { SharedPtr(std::move(other)).swap(*this); return *this; }
+    SharedPtr& operator=(std::nullptr_t) { reset(); return *this; }
+
+    void reset() { SharedPtr().swap(*this); }
+
+    template<class Y>
+    void reset(Y* p) { SharedPtr(p).swap(*this); }
+
+    template<class Y, class D>
+    void reset(Y* p, D d) { SharedPtr(p, std::move(d)).swap(*this); }
+
+    void swap(SharedPtr& other) noexcept
+    {
+        std::swap(_p, other._p);
+        std::swap(_cb, other._cb);
+    }
+
+    T* get() const { return _p; }
+    T& operator*() const { return *_p; }
+    T* operator->() const { return _p; }
+    explicit operator bool() const { return _p != nullptr; }
+
+    long use_count() const { return _cb ? _cb->useCount() : 0; }
+    bool unique() const { return use_count() == 1; }
+
+private:
+    template<class Y, class P> friend class SharedPtr;
+    template<class Y, class P> friend class WeakPtr;
+    template<class Y, class P, class... Args> friend SharedPtr<Y, P> make_shared_ptr(Args&&... args);
+
+    // Takes the count of cb, already incremented
+    static SharedPtr fromBlock(T* p, ControlBlock<Policy>* cb)
+    {
+        SharedPtr sp;
+        sp._p = p;
+        sp._cb = cb;
+        return sp;
+    }
+
+    template<class Y, class D>
+    void adopt(Y* p, D d)
+    {
+        if(!p)
+            return;
+        try
+        {
+            _cb = new PointerBlock<Policy, Y, D>(p, d);
+        }
+        catch(...)
+        {
+            d(p);       // As std::shared_ptr, the object is deleted when the block cannot be allocated
+            throw;
+        }
+    }
+
+    T* _p;
+    ControlBlock<Policy>* _cb;
+};
+
+template<class T, class Policy = AtomicCount>
+class WeakPtr
+{
+public:
+    WeakPtr():_p(nullptr), _cb(nullptr) {}
+
+    template<class Y>
+    WeakPtr(const SharedPtr<Y, Policy>& sp):_p(sp._p), _cb(sp._cb) { if(_cb) _cb->retainWeak(); }
+
+    WeakPtr(const WeakPtr& other):_p(other._p), _cb(other._cb) { if(_cb) _cb->retainWeak(); }
+    WeakPtr(WeakPtr&& other) noexcept:_p(other._p), _cb(other._cb) { other._p = nullptr; other._cb = nullptr; }
+
+    ~WeakPtr() { if(_cb) _cb->releaseWeak(); }
+
+    WeakPtr& operator=(const WeakPtr& other) { WeakPtr(other).swap(*this); return *this; }
+    WeakPtr& operator=(WeakPtr&& other) noexcept { WeakPtr(std::move(other)).swap(*this); return *this; }
+
+    template<class Y>
+    WeakPtr& operator=(const SharedPtr<Y, Policy>& sp) { WeakPtr(sp).swap(*this); return *this; }
+
+    void reset() { WeakPtr().swap(*this); }
+
+    void swap(WeakPtr& other) noexcept
+    {
+        std::swap(_p, other._p);
+        std::swap(_cb, other._cb);
+    }
+
+    long use_count() const { return _cb ? _cb->useCount() : 0; }
+    bool expired() const { return use_count() == 0; }
+
+    // A SharedPtr to the object, or an empty one when it is gone: the check and the copy are one step.
+    SharedPtr<T, Policy> lock() const
+    {
+        return (_cb && _cb->lock()) ? SharedPtr<T, Policy>::fromBlock(_p, _cb) : SharedPtr<T, Policy>();
+    }
+
+private:
+    template<class Y, class P> friend class SharedPtr;
+
+    T* _p;
+    ControlBlock<Policy>* _cb;
+};
+
+template<class T, class Policy = AtomicCount, class... Args>
+SharedPtr<T, Policy> make_shared_ptr(Args&&... args)
+{
+    InplaceBlock<Policy, T>* cb = new InplaceBlock<Policy, T>(std::forward<Args>(args)...);
+    return SharedPtr<T, Policy>::fromBlock(cb->get(), cb);
+}
+
+template<class T>
+using LocalPtr = SharedPtr<T, PlainCount>;
+
+template<class T>
+using LocalWeakPtr = WeakPtr<T, PlainCount>;
+
+class Shape
+{
+public:
+    static bool verbose;    // Off for the benchmarks
+
+    Shape() { if(verbose) std::cout << "Shape constructor <" << this << ">" << std::endl; }
+    Shape(int i):_i(i) { if(verbose) std::cout << "Shape constructor <" << this << "> i:" << _i << std::endl; }
+    Shape(const Shape& foo):_i(foo._i) { if(verbose) std::cout << "Shape copy constructor <" << this << ">" << std::endl; }
+
+    ~Shape() { if(verbose) std::cout << "Shape destructor <" << this << ">" << std::endl; }
+
+    void draw() { std::cout << "<" << this << "> _i:" << _i << std::endl; }
+    int id() const { return _i; }
+protected:
+    int _i;
+};
+
+bool Shape::verbose = true;
+
+// A growing vector moves its elements only if the move cannot throw, it copies them otherwise(a count update each).
+static_assert(std::is_nothrow_move_constructible<SharedPtr<Shape, AtomicCount> >::value &&
+              std::is_nothrow_move_constructible<SharedPtr<Shape, PlainCount> >::value, "SharedPtr: a growing vector would copy");
+static_assert(std::is_nothrow_move_constructible<WeakPtr<Shape, AtomicCount> >::value &&
+              std::is_nothrow_move_constructible<WeakPtr<Shape, PlainCount> >::value, "WeakPtr: a growing vector would copy");
+
+// printWP() of 10_weak_ptr.cpp, for any of the weak pointers.
+template<class W>
+void printWP(const W& wp)
+{
+    if(wp.expired())
+        std::cout << "weak pointer expired !!" << std::endl;
+    else
+        wp.lock()->draw();
+}
+
+template<class SP, class WP>
+void weakDemo(SP sp)
+{
+    WP wp = sp;
+
+    printWP(wp);
+    std::cout << "use_count: " << sp.use_count() << std::endl;
+
+    sp.reset();
+    printWP(wp);
+}
+
+// Copies the pointer into a vector, then clears it: n increments and n decrements.
+template<class SP>
+long copies(const SP& sp, int n)
+{
+    std::vector<SP> v;
+    v.reserve(64);
+    long sum = 0;
+    for(int i = 0; i < n; i += 64)
+    {
+        for(int j = 0; j < 64; ++j)
+            v.push_back(sp);
+        sum += v.back()->id();
+        v.clear();
+    }
+    return sum;
+}
+
+// lock() of a weak pointer, the way printWP() reaches the object.
+template<class WP>
+long locks(const WP& wp, int n)
+{
+    long sum = 0;
+    for(int i = 0; i < n; ++i)
+        if(auto sp = wp.lock())
+            sum += sp->id();
+    return sum;
+}
+
+template<class Make>
+long creations(Make make, int n)
+{
+    long sum = 0;
+    for(int i = 0; i < n; ++i)
+        sum += make(i)->id();
+    return sum;
+}
+
+void benchmarks()
+{
+    const int n = 1 << 24;
+
+    std::shared_ptr<Shape> std_sp = std::make_shared<Shape>(1);
+    SharedPtr<Shape> atomic_sp = make_shared_ptr<Shape>(1);
+    LocalPtr<Shape> local_sp = make_shared_ptr<Shape, PlainCount>(1);
+
+    std::cout << "----------------- " << n << " copies and destructions ----------------" << std::endl;
+    double base = measure("std::shared_ptr        ", [&]() { return copies(std_sp, n); }, n, 0);
+    measure("SharedPtr, AtomicCount ", [&]() { return copies(atomic_sp, n); }, n, base);
+    measure("LocalPtr, PlainCount   ", [&]() { return copies(local_sp, n); }, n, base);
+
+    std::weak_ptr<Shape> std_wp = std_sp;
+    WeakPtr<Shape> atomic_wp = atomic_sp;
+    LocalWeakPtr<Shape> local_wp = local_sp;
+
+    std::cout << "----------------- " << n << " lock() of a weak pointer ----------------" << std::endl;
+    base = measure("std::weak_ptr          ", [&]() { return locks(std_wp, n); }, n, 0);
+    measure("WeakPtr, AtomicCount   ", [&]() { return locks(atomic_wp, n); }, n, base);
+    measure("LocalWeakPtr, PlainCount", [&]() { return locks(local_wp, n); }, n, base);
+
+    const int m = 1 << 22;
+    std::cout << "----------------- " << m << " objects made and destroyed ----------------" << std::endl;
+    base = measure("std::make_shared       ", [&]() { return creations([](int i) { return std::make_shared<Shape>(i); }, m); }, m, 0);
+    measure("make_shared_ptr, Atomic", [&]() { return creations([](int i) { return make_shared_ptr<Shape>(i); }, m); }, m, base);
+    measure("make_shared_ptr, Plain ", [&]() { return creations([](int i) { return make_shared_ptr<Shape, PlainCount>(i); }, m); }, m, base);
+
+}
+
+int main()
+{
+    std::cout << "----------------- 10_weak_ptr.cpp with std::shared_ptr ----------------" << std::endl;
+    weakDemo<std::shared_ptr<Shape>, std::weak_ptr<Shape> >(std::make_shared<Shape>(1212));
+
+    std::cout << "----------------- SharedPtr<Shape, AtomicCount> ----------------" << std::endl;
+    weakDemo<SharedPtr<Shape>, WeakPtr<Shape> >(make_shared_ptr<Shape>(1313));
+
+    std::cout << "----------------- LocalPtr<Shape> ----------------" << std::endl;
+    weakDemo<LocalPtr<Shape>, LocalWeakPtr<Shape> >(make_shared_ptr<Shape, PlainCount>(1414));
+
+    std::cout << "----------------- Custom deleter, bad_weak_ptr ----------------" << std::endl;
+    LocalWeakPtr<Shape> gone;
+    {
+        LocalPtr<Shape> arr(new Shape[2], [](Shape* s) { std::cout << "Using delete[]..." << std::endl; delete[] s; });
+        gone = arr;
+    }
+    try
+    {
+        LocalPtr<Shape> sp(gone);
+    }
+    catch(const std::bad_weak_ptr& e)
+    {
+        std::cout << "LocalPtr from an expired LocalWeakPtr: " << e.what() << std::endl;
+    }
+
+    std::cout << "----------------- Sizes ----------------" << std::endl;
+    std::cout << "sizeof(SharedPtr<Shape>): " << sizeof(SharedPtr<Shape>) << ", sizeof(LocalPtr<Shape>): " << sizeof(LocalPtr<Shape>)
+              << ", counts + Shape of make_shared_ptr: " << sizeof(InplaceBlock<PlainCount, Shape>) << std::endl;
+
+    Shape::verbose = false;
+    std::cout << "================= A single thread in the process ================" << std::endl;
+    benchmarks();
+
+    // libstdc++ makes the counts of std::shared_ptr atomic once a second thread was started, for good.
+    std::thread([]() {}).join();
+    std::cout << "================= After a std::thread was started ================" << std::endl;
+    benchmarks();
+
+    return 0;
+}
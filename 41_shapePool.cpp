@@ -0,0 +1,534 @@
+#include <iostream>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <new>
+#include <cstddef>
+#include <utility>
+
+#include "sampleUtil.h"
+
+/*********
+A program to show a pool of fixed size blocks, used by std::allocate_shared and by a unique_ptr deleter.
+
+9_SharedPtr.cpp, 10_weak_ptr.cpp and 11_uniquePtr.cpp create their Shapes with make_shared or new: each one is a
+call of malloc, and a free when it is destroyed, which takes the lock of a malloc arena when the cache of the
+thread is empty or full.
+
+SizeClassPools keeps a PoolArena for each size class(16, 32 ... 256 bytes). An arena cuts chunks of 64 KB into
+blocks of its size, kept in a free list:
+
+    thread cache    each thread has its own free list for each size class: allocate() and deallocate() take and
+                    put a block there, without a lock or an atomic instruction. It is refilled from(or given back
+                    to) the arena a list of 32 blocks at a time, under the lock of the arena.
+    stats()         the live objects, their high-water mark(the most live objects seen at the refills and by
+                    stats(), never below the live ones), the bytes and chunks taken from the heap.
+    release()       gives all the chunks back at once, when no object of the arena is alive and no other thread
+                    may be using it: the threads that used the arena must have ended, or called detach(). The
+                    live count alone does not tell that another thread is not inside allocate().
+    detach()        the thread gives the blocks of its caches back to the arenas. It can use them again later.
+
+Larger sizes go to operator new. The blocks are aligned to 16 bytes only, a type aligned to more is refused at
+compile time(static_assert). The pools are used through:
+
+    PoolAllocator<T>                            an allocator for std::allocate_shared, which puts the control
+                                                block and the object in one block of a size class.
+    make_pooled<T>(args...), PooledPtr<T>       a unique_ptr<T, PoolDeleter<T>>, whose deleter destroys the
+                                                object and gives its block back. A PooledPtr<Derived> is not
+                                                converted into a PooledPtr<Base>: the deleter needs the size.
+
+The churn of creating and destroying Shapes is timed against the heap, on a single thread and on several.
+The pool is not always the faster one. Measured on a 1 CPU machine, with 256K live Shapes replaced at random,
+make_pooled ran at 0.44-0.69x the speed of the heap and allocate_shared at 0.83-0.93x: the thread cache of glibc's
+malloc is as cheap as the pool's. Creating and destroying a few Shapes, all in the CPU cache, costs the same.
+*********/
+
+struct PoolStats
+{
+    std::size_t blockSize;
+    long live;              // Blocks allocated and not freed yet
+    long highWater;         // The most live blocks seen, at the refills of the thread caches and by stats()
+    std::size_t bytes;      // Taken from the heap
+    std::size_t chunks;
+};
+
+// The blocks of one size. The free lists are linked through the first word of the free blocks.
+class PoolArena
+{
+public:
+    static const std::size_t ChunkSize = 64 * 1024;
+    static const int Batch = 32;
+
+    // The blocks of a thread. allocs and frees are written by their thread only(a plain store), read by stats().
+    struct Cache
+    {
+        Cache():head(nullptr), count(0), allocs(0), frees(0), registered(false) {}
+
+        void* head;
+        int count;
+        std::atomic<long> allocs;
+        std::atomic<long> frees;
+        bool registered;
+    };
+
+    explicit PoolArena(std::size_t blockSize)
+        :_blockSize(blockSize), _carve(nullptr), _carveEnd(nullptr), _retired(0), _highWater(0) {}
+
+    ~PoolArena()
+    {
+        for(char* chunk : _chunks)
+            ::operator delete(chunk);
+    }
+
+    PoolArena(const PoolArena&) = delete;
+    PoolArena& operator=(const PoolArena&) = delete;
+
+    std::size_t blockSize() const { return _blockSize; }
+
+    void* allocate(Cache& c)
+    {
+        if(!c.registered)
+            attach(c);
+        if(!c.head)
+            refill(c);
+        void* p = c.head;
+        c.head = next(p);
+        --c.count;
+        c.allocs.store(c.allocs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return p;
+    }
+
+    void deallocate(Cache& c, void* p)
+    {
+        if(!c.registered)
+            attach(c);
+        next(p) = c.head;
+        c.head = p;
+        c.frees.store(c.frees.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if(++c.count > 2 * Batch)
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            give(c, Batch);
+        }
+    }
+
+    // The thread of c ends or detaches: its blocks go back to the arena, its counts are kept by the arena.
+    void retire(Cache& c)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        give(c, c.count);
+        _retired += c.allocs.load(std::memory_order_relaxed) - c.frees.load(std::memory_order_relaxed);
+        c.allocs.store(0, std::memory_order_relaxed);
+        c.frees.store(0, std::memory_order_relaxed);
+        for(std::size_t i = 0; i < _caches.size(); ++i)
+            if(_caches[i] == &c)
+            {
+                _caches[i] = _caches.back();
+                _caches.pop_back();
+                break;
+            }
+        c.registered = false;
+    }
+
+    PoolStats stats()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        long n = live();
+        _highWater = std::max(_highWater, n);
+        PoolStats s = { _blockSize, n, _highWater, _chunks.size() * ChunkSize, _chunks.size() };
+        return s;
+    }
+
+    // Frees all the chunks, if no block is in use and own(the cache of the calling thread) is the only cache left.
+    // The other caches are retired: their threads ended or detached, none of them can be inside the arena, and a
+    // thread using the arena from now on attaches under the lock, after the chunks are freed.
+    bool release(Cache& own)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if(live() != 0)
+            return false;
+        for(const Cache* c : _caches)
+            if(c != &own)
+                return false;
+        own.head = nullptr;
+        own.count = 0;
+        for(char* chunk : _chunks)
+            ::operator delete(chunk);
+        _chunks.clear();
+        _lists.clear();
+        _carve = _carveEnd = nullptr;
+        return true;
+    }
+
+private:
+    static void*& next(void* p) { return *static_cast<void**>(p); }
+
+    // The first use of the arena by a thread, or its first use after detach().
+    void attach(Cache& c)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _caches.push_back(&c);
+        c.registered = true;
+    }
+
+    // The cache is empty: it takes a list given back by a thread, whose blocks are not read here(they are not in the
+    // cache of this CPU, reading them one by one under the lock would be slow), or a batch of new blocks.
+    void refill(Cache& c)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if(!_lists.empty())
+        {
+            c.head = _lists.back().first;
+            c.count = _lists.back().second;
+            _lists.pop_back();
+        }
+        else
+        {
+            if(_carve == _carveEnd)
+            {
+                _chunks.push_back(static_cast<char*>(::operator new(ChunkSize)));
+                _carve = _chunks.back();
+                _carveEnd = _carve + ChunkSize / _blockSize * _blockSize;
+            }
+            for(int i = 0; i < Batch && _carve != _carveEnd; ++i, _carve += _blockSize)
+            {
+                next(_carve) = c.head;
+                c.head = _carve;
+                ++c.count;
+            }
+        }
+        _highWater = std::max(_highWater, live() + 1);     // With the block being allocated
+    }
+
+    // Moves the first n blocks of c, the last ones it freed, to a list of the arena. The lock is held.
+    void give(Cache& c, int n)
+    {
+        if(n <= 0 || !c.head)
+            return;
+        void* first = c.head;
+        void* last = first;
+        int count = 1;
+        for(; count < n && next(last); ++count)
+            last = next(last);
+        c.head = next(last);
+        c.count -= count;
+        next(last) = nullptr;
+        _lists.push_back(std::make_pair(first, count));
+    }
+
+    // The lock is held.
+    long live() const
+    {
+        long n = _retired;
+        for(const Cache* c : _caches)
+            n += c->allocs.load(std::memory_order_relaxed) - c->frees.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    const std::size_t _blockSize;
+
+    std::mutex _mtx;
+    std::vector<std::pair<void*, int> > _lists;     // The free blocks given back by the threads, and their number
+    char* _carve;                   // The part of the last chunk not cut yet
+    char* _carveEnd;
+    std::vector<char*> _chunks;
+    std::vector<Cache*> _caches;    // The caches of the running threads
+    long _retired;                  // The live blocks of the threads that ended
+    long _highWater;
+};
+
+class SizeClassPools
+{
+public:
+    static const std::size_t Granularity = 16;     // Also the alignment of the blocks: chunks are, sizes are multiples
+    static const std::size_t MaxSize = 256;
+    static const std::size_t Classes = MaxSize / Granularity;
+
+    static void* allocate(std::size_t bytes)
+    {
+        if(bytes == 0 || bytes > MaxSize)
+            return ::operator new(bytes);
+        std::size_t i = classOf(bytes);
+        return arena(i).allocate(caches().c[i]);
+    }
+
+    static void deallocate(void* p, std::size_t bytes)
+    {
+        if(bytes == 0 || bytes > MaxSize)
+            return ::operator delete(p);
+        std::size_t i = classOf(bytes);
+        arena(i).deallocate(caches().c[i], p);
+    }
+
+    static PoolArena& arena(std::size_t i)
+    {
+        static Arenas arenas;       // Thread-safe initialization
+        return *arenas.a[i];
+    }
+
+    // The arenas that were used
+    static std::vector<PoolStats> stats()
+    {
+        std::vector<PoolStats> out;
+        for(std::size_t i = 0; i < Classes; ++i)
+        {
+            PoolStats s = arena(i).stats();
+            if(s.chunks || s.highWater)
+                out.push_back(s);
+        }
+        return out;
+    }
+
+    // Releases the arenas without a live block and used by no other thread, returns the bytes given back to the heap.
+    static std::size_t release()
+    {
+        std::size_t bytes = 0;
+        for(std::size_t i = 0; i < Classes; ++i)
+        {
+            std::size_t held = arena(i).stats().bytes;
+            if(arena(i).release(caches().c[i]))
+                bytes += held;
+        }
+        return bytes;
+    }
+
+    // The calling thread stops using the pools for now: the blocks of its caches go back to the arenas.
+    static void detach() { caches().detach(); }
+
+private:
+    static std::size_t classOf(std::size_t bytes) { return (bytes + Granularity - 1) / Granularity - 1; }
+
+    struct Arenas
+    {
+        Arenas()
+        {
+            for(std::size_t i = 0; i < Classes; ++i)
+                a[i].reset(new PoolArena((i + 1) * Granularity));
+        }
+        std::unique_ptr<PoolArena> a[Classes];
+    };
+
+    // The caches of a thread, given back to the arenas when it ends(before the arenas are destroyed, for main()).
+    struct ThreadCaches
+    {
+        ~ThreadCaches() { detach(); }
+
+        void detach()
+        {
+            for(std::size_t i = 0; i < Classes; ++i)
+                if(c[i].registered)
+                    arena(i).retire(c[i]);
+        }
+        PoolArena::Cache c[Classes];
+    };
+
+    static ThreadCaches& caches()
+    {
+        static thread_local ThreadCaches t;
+        return t;
+    }
+};
+
+// An allocator of the pools, e.g. for std::allocate_shared.
+template<class T>
+struct PoolAllocator
+{
+    typedef T value_type;
+
+    PoolAllocator() {}
+    template<class U> PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(std::size_t n)
+    {
+        static_assert(alignof(T) <= SizeClassPools::Granularity, "PoolAllocator: the blocks are only Granularity aligned");
+        return static_cast<T*>(SizeClassPools::allocate(n * sizeof(T)));
+    }
+    void deallocate(T* p, std::size_t n) { SizeClassPools::deallocate(p, n * sizeof(T)); }
+};
+
+template<class T, class U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) { return true; }
+
+template<class T, class U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) { return false; }
+
+template<class T>
+struct PoolDeleter
+{
+    void operator()(T* p) const
+    {
+        p->~T();
+        SizeClassPools::deallocate(p, sizeof(T));
+    }
+};
+
+template<class T>
+using PooledPtr = std::unique_ptr<T, PoolDeleter<T> >;
+
+template<class T, class... Args>
+PooledPtr<T> make_pooled(Args&&... args)
+{
+    static_assert(alignof(T) <= SizeClassPools::Granularity, "make_pooled: the blocks are only Granularity aligned");
+    void* p = SizeClassPools::allocate(sizeof(T));
+    try
+    {
+        return PooledPtr<T>(new (p) T(std::forward<Args>(args)...));
+    }
+    catch(...)
+    {
+        SizeClassPools::deallocate(p, sizeof(T));   // The constructor threw: the block is given back
+        throw;
+    }
+}
+
+class Shape
+{
+public:
+    static bool verbose;    // Off for the benchmarks
+
+    Shape(int i = 0):_i(i) { if(verbose) std::cout << "Shape constructor <" << this << "> i:" << _i << std::endl; }
+    Shape(const Shape& foo):_i(foo._i) { if(verbose) std::cout << "Shape copy constructor <" << this << ">" << std::endl; }
+
+    ~Shape() { if(verbose) std::cout << "Shape destructor <" << this << ">" << std::endl; }
+
+    void draw() { std::cout << "Drawing <" << this << "> with _i:" << _i << std::endl; }
+    int id() const { return _i; }
+protected:
+    int _i;
+};
+
+bool Shape::verbose = true;
+
+void printStats()
+{
+    for(const PoolStats& s : SizeClassPools::stats())
+        std::cout << "    blocks of " << s.blockSize << " bytes: live " << s.live << ", high-water " << s.highWater
+                  << ", " << s.bytes << " bytes in " << s.chunks << " chunks" << std::endl;
+}
+
+// Creates and destroys n objects, one at a time.
+template<class Make>
+long createDestroy(Make make, int n)
+{
+    long sum = 0;
+    for(int i = 0; i < n; ++i)
+        sum += make(i)->id();
+    return sum;
+}
+
+// Keeps `live` objects, and replaces one at random n times: the blocks are freed in another order than allocated.
+template<class Make>
+long churn(Make make, int live, int n, unsigned seed)
+{
+    typedef decltype(make(0)) Ptr;
+    std::vector<Ptr> objects;
+    for(int i = 0; i < live; ++i)
+        objects.push_back(make(i));
+
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> pick(0, live - 1);
+    long sum = 0;
+    for(int i = 0; i < n; ++i)
+    {
+        Ptr& p = objects[pick(gen)];
+        sum += p->id();
+        p = make(i);
+    }
+    return sum;
+}
+
+template<class Make>
+long threadedChurn(Make make, unsigned threads, int live, int n)
+{
+    std::vector<long> sums(threads, 0);
+    std::vector<std::thread> workers;
+    for(unsigned t = 0; t < threads; ++t)
+        workers.push_back(std::thread([&make, &sums, t, live, n]() { sums[t] = churn(make, live, n, t); }));
+    for(std::thread& w : workers)
+        w.join();
+
+    long sum = 0;
+    for(long s : sums)
+        sum += s;
+    return sum;
+}
+
+int main()
+{
+    std::cout << "----------------- allocate_shared with a PoolAllocator ----------------" << std::endl;
+    {
+        std::shared_ptr<Shape> sp = std::allocate_shared<Shape>(PoolAllocator<Shape>(), 1000);
+        std::weak_ptr<Shape> wp = sp;
+        sp->draw();
+        printStats();
+        sp.reset();
+        std::cout << "After reset(), expired(): " << std::boolalpha << wp.expired() << std::endl;
+    }
+    printStats();       // The block stays until the weak_ptr is gone, as the control block is in it
+
+    std::cout << "----------------- make_pooled ----------------" << std::endl;
+    {
+        PooledPtr<Shape> up = make_pooled<Shape>(12345);
+        up->draw();
+        up.reset(make_pooled<Shape>(123).release());
+        up->draw();
+    }
+
+    std::cout << "----------------- Bulk release ----------------" << std::endl;
+    Shape::verbose = false;
+    {
+        std::vector<PooledPtr<Shape> > shapes;
+        for(int i = 0; i < 100000; ++i)
+            shapes.push_back(make_pooled<Shape>(i));
+        printStats();
+        std::cout << "release() with live Shapes: " << SizeClassPools::release() << " bytes released" << std::endl;
+    }
+    printStats();
+    {
+        // Another thread that used the pools and is still running: it could be inside allocate().
+        std::promise<void> done;
+        std::future<void> wait = done.get_future();
+        std::thread other([&wait]() {
+            make_pooled<Shape>(1);
+            wait.wait();
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::cout << "release() while another thread uses the pools: " << SizeClassPools::release() << " bytes released" << std::endl;
+        done.set_value();
+        other.join();
+    }
+    std::cout << "release() after the Shapes and the thread are gone: " << SizeClassPools::release() << " bytes released" << std::endl;
+    printStats();
+
+    const int n = 1 << 22;
+    std::cout << "----------------- Create and destroy " << n << " Shapes ----------------" << std::endl;
+    double base = measure("make_shared                ", [&]() { return createDestroy([](int i) { return std::make_shared<Shape>(i); }, n); }, n, 0);
+    measure("allocate_shared, pool     ", [&]() { return createDestroy([](int i) { return std::allocate_shared<Shape>(PoolAllocator<Shape>(), i); }, n); }, n, base);
+    base = measure("unique_ptr(new Shape)      ", [&]() { return createDestroy([](int i) { return std::unique_ptr<Shape>(new Shape(i)); }, n); }, n, 0);
+    measure("make_pooled                ", [&]() { return createDestroy([](int i) { return make_pooled<Shape>(i); }, n); }, n, base);
+
+    const int live = 1 << 18;
+    std::cout << "----------------- " << live << " live Shapes, " << n << " replaced at random ----------------" << std::endl;
+    base = measure("make_shared                ", [&]() { return churn([](int i) { return std::make_shared<Shape>(i); }, live, n, 1); }, n, 0);
+    measure("allocate_shared, pool     ", [&]() { return churn([](int i) { return std::allocate_shared<Shape>(PoolAllocator<Shape>(), i); }, live, n, 1); }, n, base);
+    base = measure("unique_ptr(new Shape)      ", [&]() { return churn([](int i) { return std::unique_ptr<Shape>(new Shape(i)); }, live, n, 1); }, n, 0);
+    measure("make_pooled                ", [&]() { return churn([](int i) { return make_pooled<Shape>(i); }, live, n, 1); }, n, base);
+
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 4u);
+    std::cout << "----------------- The same on " << threads << " threads ----------------" << std::endl;
+    base = measure("make_shared                ", [&]() { return threadedChurn([](int i) { return std::make_shared<Shape>(i); }, threads, live / threads, n / threads); }, n, 0);
+    measure("allocate_shared, pool     ", [&]() { return threadedChurn([](int i) { return std::allocate_shared<Shape>(PoolAllocator<Shape>(), i); }, threads, live / threads, n / threads); }, n, base);
+    base = measure("unique_ptr(new Shape)      ", [&]() { return threadedChurn([](int i) { return std::unique_ptr<Shape>(new Shape(i)); }, threads, live / threads, n / threads); }, n, 0);
+    measure("make_pooled                ", [&]() { return threadedChurn([](int i) { return make_pooled<Shape>(i); }, threads, live / threads, n / threads); }, n, base);
+
+    std::cout << "----------------- Pool stats ----------------" << std::endl;
+    printStats();
+
+    return 0;
+}
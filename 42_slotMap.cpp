@@ -0,0 +1,307 @@
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+#define SAMPLE_COUNT_HEAP      // heapBytes, heapAllocations
+#include "sampleUtil.h"
+
+/*********
+A program to show a slot map: a container whose objects are reached through handles that know when they expired.
+
+printWP() of 10_weak_ptr.cpp calls wp.expired(), then wp.lock(): two operations on the control block, and the
+object may be destroyed between them by another thread. Each weak_ptr is 16 bytes, and each object has its own
+allocation and control block.
+
+SlotMap<T> keeps the objects in a vector, without a gap, and gives a Handle for each:
+
+    Handle      64 bits: the index of a slot, and the generation of the slot when the object was inserted.
+    slot        the position of the object in the vector, and the generation of the slot, which is incremented
+                when the object is erased. A handle of an erased object no longer has the generation of its slot.
+
+    insert(obj), emplace(args...)   add an object, return its Handle.
+    get(h)                          the object, or nullptr when it was erased: a load of the slot and a compare,
+                                    then the object. There is nothing to lock: get() and the use of the object are
+                                    one step, on the thread that owns the map.
+    erase(h)                        destroys the object. The last object is moved into its place, so the objects
+                                    stay contiguous: begin(), end() iterate over the live objects only.
+
+The slots of the erased objects are reused(the free slots are a list). A slot whose generation would wrap around
+is not reused any more, so an old handle can never match a new object.
+
+The lookups through handles are timed against weak_ptr::lock() and the expired()/lock() of printWP(), and the
+memory of both is counted by replacing the global operator new.
+*********/
+
+template<class T>
+class SlotMap
+{
+public:
+    class Handle
+    {
+    public:
+        Handle():_index(0), _generation(0) {}       // A null handle: generation 0 is never used
+
+        std::uint64_t value() const { return (std::uint64_t(_generation) << 32) | _index; }
+        bool operator==(const Handle& other) const { return value() == other.value(); }
+        bool operator!=(const Handle& other) const { return value() != other.value(); }
+
+    private:
+        friend class SlotMap;
+        Handle(std::uint32_t index, std::uint32_t generation):_index(index), _generation(generation) {}
+
+        std::uint32_t _index;
+        std::uint32_t _generation;
+    };
+
+    typedef typename std::vector<T>::iterator iterator;
+    typedef typename std::vector<T>::const_iterator const_iterator;
+
+    SlotMap():_freeHead(NoSlot) {}
+
+    void reserve(std::size_t n)
+    {
+        _values.reserve(n);
+        _valueSlots.reserve(n);
+        _slots.reserve(n);
+    }
+
+    Handle insert(const T& value) { return emplace(value); }
+    Handle insert(T&& value) { return emplace(std::move(value)); }
+
+    template<class... Args>
+    Handle emplace(Args&&... args)
+    {
+        if(_freeHead == NoSlot)
+        {
+            _slots.push_back(Slot(NoSlot, 1));      // A new free slot
+            _freeHead = static_cast<std::uint32_t>(_slots.size() - 1);
+        }
+        std::uint32_t slot = _freeHead;
+
+        // The slot is taken once the object is built: a constructor that throws leaves the map as it was.
+        _valueSlots.push_back(slot);
+        try
+        {
+            _values.emplace_back(std::forward<Args>(args)...);
+        }
+        catch(...)
+        {
+            _valueSlots.pop_back();
+            throw;
+        }
+        _freeHead = _slots[slot].position;
+        _slots[slot].position = static_cast<std::uint32_t>(_values.size() - 1);
+        return Handle(slot, _slots[slot].generation);
+    }
+
+    T* get(Handle h)
+    {
+        if(h._index >= _slots.size())
+            return nullptr;
+        const Slot& s = _slots[h._index];
+        return s.generation == h._generation ? &_values[s.position] : nullptr;
+    }
+
+    const T* get(Handle h) const { return const_cast<SlotMap*>(this)->get(h); }
+
+    bool contains(Handle h) const { return get(h) != nullptr; }
+
+    bool erase(Handle h)
+    {
+        if(!contains(h))
+            return false;
+        Slot& s = _slots[h._index];
+        std::uint32_t position = s.position;
+
+        // The last object takes the place of the erased one.
+        if(position + 1 != _values.size())
+        {
+            _values[position] = std::move(_values.back());
+            _valueSlots[position] = _valueSlots.back();
+            _slots[_valueSlots[position]].position = position;
+        }
+        _values.pop_back();
+        _valueSlots.pop_back();
+
+        freeSlot(h._index);
+        return true;
+    }
+
+    void clear()
+    {
+        for(std::uint32_t slot : _valueSlots)
+            freeSlot(slot);
+        _values.clear();
+        _valueSlots.clear();
+    }
+
+    std::size_t size() const { return _values.size(); }
+    bool empty() const { return _values.empty(); }
+
+    iterator begin() { return _values.begin(); }
+    iterator end() { return _values.end(); }
+    const_iterator begin() const { return _values.begin(); }
+    const_iterator end() const { return _values.end(); }
+
+private:
+    static const std::uint32_t NoSlot = std::uint32_t(-1);
+    static const std::uint32_t Retired = std::uint32_t(-1);
+
+    struct Slot
+    {
+        Slot(std::uint32_t p, std::uint32_t g):position(p), generation(g) {}
+
+        std::uint32_t position;         // Of the object in _values, or the next free slot
+        std::uint32_t generation;
+    };
+
+    // The object of the slot is gone: the handles given for it no longer match. The last generation is never
+    // given, the slot is retired instead of wrapping around to the generations of old handles.
+    void freeSlot(std::uint32_t slot)
+    {
+        if(++_slots[slot].generation != Retired)
+        {
+            _slots[slot].position = _freeHead;
+            _freeHead = slot;
+        }
+    }
+
+    std::vector<T> _values;
+    std::vector<std::uint32_t> _valueSlots;     // The slot of each object, to update it when the object moves
+    std::vector<Slot> _slots;
+    std::uint32_t _freeHead;
+};
+
+class Shape
+{
+public:
+    static bool verbose;    // Off for the benchmarks
+
+    Shape(int i = 0):_i(i) { if(verbose) std::cout << "Shape constructor <" << this << "> i:" << _i << std::endl; }
+    Shape(const Shape& foo):_i(foo._i) { if(verbose) std::cout << "Shape copy constructor <" << this << ">" << std::endl; }
+    Shape& operator=(const Shape& foo) { _i = foo._i; return *this; }
+
+    ~Shape() { if(verbose) std::cout << "Shape destructor <" << this << ">" << std::endl; }
+
+    void draw() { std::cout << "<" << this << "> _i:" << _i << std::endl; }
+    int id() const { return _i; }
+protected:
+    int _i;
+};
+
+bool Shape::verbose = true;
+
+typedef SlotMap<Shape>::Handle ShapeHandle;
+
+// printWP() of 10_weak_ptr.cpp with a handle
+void printHandle(SlotMap<Shape>& shapes, ShapeHandle h)
+{
+    if(Shape* s = shapes.get(h))
+        s->draw();
+    else
+        std::cout << "Handle " << std::hex << h.value() << std::dec << " expired !!" << std::endl;
+}
+
+int main()
+{
+    std::cout << "----------------- 10_weak_ptr.cpp with a handle ----------------" << std::endl;
+    {
+        SlotMap<Shape> shapes;
+        ShapeHandle h = shapes.emplace(1212);
+        printHandle(shapes, h);
+
+        shapes.erase(h);
+        printHandle(shapes, h);
+
+        ShapeHandle reused = shapes.emplace(1313);   // The same slot, another generation
+        std::cout << "New handle " << std::hex << reused.value() << std::dec << " in the slot of the old one" << std::endl;
+        printHandle(shapes, h);
+        printHandle(shapes, reused);
+    }
+
+    Shape::verbose = false;
+    const int objects = 1 << 20;
+    const int lookups = 1 << 24;
+
+    std::cout << "----------------- " << objects << " Shapes, 1 in 8 erased ----------------" << std::endl;
+    std::size_t before = heapBytes.load();
+    std::vector<std::shared_ptr<Shape> > owners;
+    std::vector<std::weak_ptr<Shape> > weaks;
+    for(int i = 0; i < objects; ++i)
+    {
+        owners.push_back(std::make_shared<Shape>(i));
+        weaks.push_back(owners.back());
+    }
+    std::size_t weakBytes = heapBytes.load() - before;
+
+    before = heapBytes.load();
+    SlotMap<Shape> shapes;
+    std::vector<ShapeHandle> handles;
+    for(int i = 0; i < objects; ++i)
+        handles.push_back(shapes.emplace(i));
+    std::size_t slotBytes = heapBytes.load() - before;
+
+    std::mt19937 gen(19);
+    for(int i = 0; i < objects; i += 8)
+    {
+        owners[i].reset();
+        shapes.erase(handles[i]);
+    }
+
+    std::cout << "shared_ptr + weak_ptr: " << weakBytes / (1024 * 1024) << " MB, " << double(weakBytes) / objects << " bytes per Shape" << std::endl;
+    std::cout << "SlotMap + Handle     : " << slotBytes / (1024 * 1024) << " MB, " << double(slotBytes) / objects << " bytes per Shape" << std::endl;
+
+    // The same random order for both
+    std::vector<int> order(lookups);
+    std::uniform_int_distribution<int> pick(0, objects - 1);
+    for(int& i : order)
+        i = pick(gen);
+
+    std::cout << "----------------- " << lookups << " lookups at random ----------------" << std::endl;
+    double base = measure("weak_ptr expired() + lock()", [&]() {
+        long sum = 0;
+        for(int i : order)
+            if(!weaks[i].expired())
+                sum += weaks[i].lock()->id();   // May be empty with several threads: expired() was another step
+        return sum;
+    }, lookups, 0);
+    measure("weak_ptr lock()            ", [&]() {
+        long sum = 0;
+        for(int i : order)
+            if(std::shared_ptr<Shape> sp = weaks[i].lock())
+                sum += sp->id();
+        return sum;
+    }, lookups, base);
+    measure("SlotMap get(handle)        ", [&]() {
+        long sum = 0;
+        for(int i : order)
+            if(const Shape* s = shapes.get(handles[i]))
+                sum += s->id();
+        return sum;
+    }, lookups, base);
+
+    std::cout << "----------------- Iterate over the live Shapes, 16 times ----------------" << std::endl;
+    base = measure("vector<shared_ptr>         ", [&]() {
+        long sum = 0;
+        for(int t = 0; t < 16; ++t)
+            for(const std::shared_ptr<Shape>& sp : owners)
+                if(sp)
+                    sum += sp->id();
+        return sum;
+    }, 16 * shapes.size(), 0);
+    measure("SlotMap                    ", [&]() {
+        long sum = 0;
+        for(int t = 0; t < 16; ++t)
+            for(const Shape& s : shapes)
+                sum += s.id();
+        return sum;
+    }, 16 * shapes.size(), base);
+
+    return 0;
+}
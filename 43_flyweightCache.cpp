@@ -0,0 +1,235 @@
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include <functional>   // std::hash
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+
+/*********
+A program to show a cache of shared objects(flyweights) that holds weak_ptr, split into shards for the threads.
+
+10_weak_ptr.cpp shows a weak_ptr<Shape> as an observer that does not keep the Shape alive. A cache of Shapes
+keyed by their id can keep weak_ptr in the same way: a Shape in use by somebody is found and shared, one that
+nobody uses any more is destroyed, and created again on the next request.
+
+FlyweightCache<Key, T> is split into shards, each one a std::unordered_map<Key, weak_ptr<T>> with its own mutex
+(the shard of a key comes from the high bits of its hash). Threads asking for keys of different shards do not
+wait for each other:
+
+    get(key, make)  the live object of the key(a hit), else make() is called outside of the lock(a miss). When two
+                    threads miss the same key at once, the object of the first one is given to both.
+    metrics()       hits, misses, the expired entries purged, and the entries, summed over the shards.
+
+An entry whose object is gone stays in its map until it is found again, or until the shard is swept: each shard is
+swept(its expired entries erased) when its size doubles since the last sweep, under the lock of that shard only.
+Note that with make_shared the memory of an object stays allocated while a weak_ptr to it exists: the sweeps keep
+it bounded.
+
+The lookups of several threads are timed with 64 shards and with a single one(a cache with a global lock).
+
+Usage: 43_flyweightCache [max threads(default 32)]
+*********/
+
+template<class Key, class T, class Hash = std::hash<Key> >
+class FlyweightCache
+{
+public:
+    struct Metrics
+    {
+        unsigned long hits;
+        unsigned long misses;
+        unsigned long purged;
+        std::size_t entries;
+    };
+
+    explicit FlyweightCache(unsigned shardBits = 6):_shardBits(shardBits), _shards(new Shard[std::size_t(1) << shardBits]) {}
+
+    FlyweightCache(const FlyweightCache&) = delete;
+    FlyweightCache& operator=(const FlyweightCache&) = delete;
+
+    template<class Make>
+    std::shared_ptr<T> get(const Key& key, Make make)
+    {
+        Shard& s = shard(key);
+        {
+            std::lock_guard<std::mutex> lock(s.mtx);
+            auto found = s.entries.find(key);
+            if(found != s.entries.end())
+            {
+                if(std::shared_ptr<T> sp = found->second.lock())
+                {
+                    ++s.hits;
+                    return sp;
+                }
+            }
+            ++s.misses;
+        }
+
+        std::shared_ptr<T> made = make();       // Without the lock: the other keys of the shard are not blocked
+
+        std::lock_guard<std::mutex> lock(s.mtx);
+        std::weak_ptr<T>& entry = s.entries[key];
+        if(std::shared_ptr<T> first = entry.lock())
+            return first;                       // Made by another thread meanwhile
+        entry = made;
+        if(s.entries.size() >= s.sweepAt)
+            sweep(s);
+        return made;
+    }
+
+    std::shared_ptr<T> get(const Key& key) { return get(key, [&key]() { return std::make_shared<T>(key); }); }
+
+    Metrics metrics() const
+    {
+        Metrics m = { 0, 0, 0, 0 };
+        for(std::size_t i = 0; i < shards(); ++i)
+        {
+            std::lock_guard<std::mutex> lock(_shards[i].mtx);
+            m.hits += _shards[i].hits;
+            m.misses += _shards[i].misses;
+            m.purged += _shards[i].purged;
+            m.entries += _shards[i].entries.size();
+        }
+        return m;
+    }
+
+    std::size_t shards() const { return std::size_t(1) << _shardBits; }
+
+private:
+    static const std::size_t MinSweep = 64;
+
+    struct Shard
+    {
+        Shard():sweepAt(MinSweep), hits(0), misses(0), purged(0) {}
+
+        mutable std::mutex mtx;
+        std::unordered_map<Key, std::weak_ptr<T>, Hash> entries;
+        std::size_t sweepAt;        // The size of the map that starts the next sweep
+        unsigned long hits;
+        unsigned long misses;
+        unsigned long purged;
+        char padding[64];           // The locks of two shards are not on the same cache line
+    };
+
+    Shard& shard(const Key& key)
+    {
+        std::uint64_t h = static_cast<std::uint64_t>(Hash()(key)) * 0x9e3779b97f4a7c15ull;   // Mixes the bits up
+        return _shards[_shardBits ? h >> (64 - _shardBits) : 0];
+    }
+
+    // The lock of s is held.
+    void sweep(Shard& s)
+    {
+        for(auto it = s.entries.begin(); it != s.entries.end(); )
+        {
+            if(it->second.expired())
+            {
+                it = s.entries.erase(it);
+                ++s.purged;
+            }
+            else
+                ++it;
+        }
+        s.sweepAt = std::max(2 * s.entries.size(), std::size_t(MinSweep));     // A copy, so MinSweep is not odr-used
+    }
+
+    const unsigned _shardBits;
+    std::unique_ptr<Shard[]> _shards;
+};
+
+class Shape
+{
+public:
+    static bool verbose;    // Off for the benchmarks
+
+    Shape(int i):_i(i) { if(verbose) std::cout << "Shape constructor <" << this << "> i:" << _i << std::endl; }
+    ~Shape() { if(verbose) std::cout << "Shape destructor <" << this << ">" << std::endl; }
+
+    void draw() { std::cout << "<" << this << "> _i:" << _i << std::endl; }
+    int id() const { return _i; }
+protected:
+    int _i;
+};
+
+bool Shape::verbose = true;
+
+typedef FlyweightCache<int, Shape> ShapeCache;
+
+void printMetrics(const ShapeCache& cache)
+{
+    ShapeCache::Metrics m = cache.metrics();
+    std::cout << "hits " << m.hits << ", misses " << m.misses << ", purged " << m.purged << ", entries " << m.entries << std::endl;
+}
+
+// Each thread asks for n keys at random, 9 in 10 among the 256 popular ones, and keeps the last `kept` Shapes it got
+// alive: the other ones expire.
+double lookups(ShapeCache& cache, unsigned threads, int n, int keys, int kept)
+{
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for(unsigned t = 0; t < threads; ++t)
+        workers.push_back(std::thread([&cache, t, n, keys, kept]() {
+            std::mt19937 gen(t);
+            std::uniform_int_distribution<int> key(0, keys - 1);
+            std::uniform_int_distribution<int> popular(0, 255);
+            std::uniform_int_distribution<int> tenth(0, 9);
+            std::vector<std::shared_ptr<Shape> > recent(kept);
+            for(int i = 0; i < n; ++i)
+                recent[i % kept] = cache.get(tenth(gen) ? popular(gen) : key(gen));
+        }));
+    for(std::thread& w : workers)
+        w.join();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned maxThreads = (argc > 1) ? static_cast<unsigned>(std::max(std::atoi(argv[1]), 1)) : 32;
+
+    std::cout << "----------------- Shared while alive ----------------" << std::endl;
+    ShapeCache cache;
+    {
+        std::shared_ptr<Shape> a = cache.get(1212);
+        std::shared_ptr<Shape> b = cache.get(1212);
+        std::cout << "The same Shape: " << std::boolalpha << (a == b) << ", use_count: " << a.use_count() << std::endl;
+        a->draw();
+        printMetrics(cache);
+    }
+    std::shared_ptr<Shape> again = cache.get(1212);    // The weak_ptr expired: made again
+    printMetrics(cache);
+    again.reset();
+
+    std::cout << "----------------- Lazy sweeps ----------------" << std::endl;
+    Shape::verbose = false;
+    for(int i = 0; i < 100000; ++i)
+        cache.get(i);                                   // Nobody keeps them
+    printMetrics(cache);
+
+    const int n = 1 << 21;
+    const int keys = 1 << 16;
+    std::cout << "----------------- " << n << " lookups of " << keys << " keys, shared by the threads ----------------" << std::endl;
+    std::cout << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    for(unsigned bits : { 6u, 0u })
+    {
+        std::cout << (bits ? "64 shards" : "1 shard, a global lock") << std::endl;
+        double single = 0;
+        for(unsigned threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            ShapeCache timed(bits);
+            double secs = lookups(timed, threads, n / threads, keys, 256);
+            single = (threads == 1) ? secs : single;
+            ShapeCache::Metrics m = timed.metrics();
+            std::cout << "    " << threads << " thread(s): " << n / secs / 1e6 << " M lookups/s, speedup " << single / secs
+                      << ", hits " << 100.0 * m.hits / (m.hits + m.misses) << "%, purged " << m.purged << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,408 @@
+#include <iostream>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstddef>
+#include <utility>
+
+/*********
+A program to show a slot holding a shared_ptr, published by a writer and loaded by readers without a lock.
+
+9_SharedPtr.cpp reassigns a shared_ptr(sp3 = sp4). When one thread does that while others copy the same
+shared_ptr, they must use std::atomic_load(&sp) and std::atomic_store(&sp, ...). libstdc++ implements them with
+a pool of 16 mutexes picked by the address of the shared_ptr: all the readers of a slot take the same mutex.
+
+AtomicSharedPtr<T> keeps the shared_ptr in a Node, and the slot is an atomic pointer to the current Node:
+
+    store(sp), exchange(sp)     a new Node is published with an atomic exchange. The old one is retired: it is
+                                deleted(and its shared_ptr released) once no reader protects it.
+    load()                      a copy of the current shared_ptr: the Node is protected by a hazard pointer while
+                                the shared_ptr is copied. The copy increments the count of the object, a cache line
+                                written by all the readers.
+    ReadGuard g(slot)           the current object for the life of g, without a copy: g holds a hazard pointer to
+                                the Node, and nothing but this hazard pointer of the thread is written.
+
+Hazard pointers: each thread has a record of 4 pointers(taken the first time it reads, given back when it ends).
+A reader loads the Node, stores it in one of its hazard pointers, then loads the slot again: if the Node is still
+there, a writer that retires it afterwards will see the hazard pointer when it scans the records, and keep the
+Node. The readers never wait for the writer(they retry only when the slot changed between the two loads), the
+writers take a mutex to retire the Nodes, and scan the records every 64 retired Nodes.
+
+The Shapes stay alive as long as a shared_ptr or a ReadGuard refers to them, as with 9_SharedPtr.cpp and
+10_weak_ptr.cpp: each reader checks that the Shape it reads is not destroyed.
+
+The reads per second are timed with 1, 2, 4 ... readers and a writer swapping the Shape in a loop.
+
+Usage: 44_atomicSharedPtr [max readers(default 16)]
+*********/
+
+class HazardPointers
+{
+public:
+    static const int MaxThreads = 256;
+    static const int PerThread = 4;
+
+    // A hazard pointer of the calling thread, until it is destroyed.
+    class Hazard
+    {
+    public:
+        Hazard():_slot(acquire()) {}
+        ~Hazard()
+        {
+            _slot->store(nullptr, std::memory_order_release);
+            threadRecord().used &= ~(1u << (_slot - threadRecord().record->hazards));
+        }
+
+        Hazard(const Hazard&) = delete;
+        Hazard& operator=(const Hazard&) = delete;
+
+        // Loads src until the pointer read is protected: a writer retiring it later sees the hazard pointer. The store
+        // and the second load are seq_cst, with the exchange of the writer and the loads of snapshot().
+        template<class P>
+        P* protect(const std::atomic<P*>& src)
+        {
+            P* p = src.load(std::memory_order_relaxed);
+            for(;;)
+            {
+                _slot->store(p, std::memory_order_seq_cst);
+                P* again = src.load(std::memory_order_seq_cst);
+                if(again == p)
+                    return p;
+                p = again;
+            }
+        }
+
+    private:
+        std::atomic<void*>* _slot;
+    };
+
+    // The pointers protected by all the threads, sorted.
+    //
+    // Why a Node retired after the exchange of the writer is never missed: the record taken by the reader(the compare
+    // exchange of acquire()), its hazard store and its second load of the slot in protect(), the exchange of the
+    // writer and the loads below are all seq_cst, so they are in a single total order. protect() returns p only when
+    // its second load still read p, which is before the exchange that replaced p in that order. The exchange is
+    // before the scan, so the loads below come after the record was taken and after the hazard store: they see the
+    // record active and the hazard pointer(or a later value, stored once the reader is done with p).
+    // With acquire loads here, or a release store in protect(), a load could still read the old values.
+    static std::vector<void*> snapshot()
+    {
+        std::vector<void*> out;
+        for(int i = 0; i < MaxThreads; ++i)
+            if(records()[i].active.load(std::memory_order_seq_cst))
+                for(std::atomic<void*>& h : records()[i].hazards)
+                    if(void* p = h.load(std::memory_order_seq_cst))
+                        out.push_back(p);
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+private:
+    struct Record
+    {
+        Record():active(false)
+        {
+            for(std::atomic<void*>& h : hazards)
+                h.store(nullptr, std::memory_order_relaxed);
+        }
+
+        std::atomic<bool> active;
+        std::atomic<void*> hazards[PerThread];
+        char padding[64];           // The records of two threads are not on the same cache line
+    };
+
+    // The record of a thread, given back when the thread ends.
+    struct ThreadRecord
+    {
+        ThreadRecord():record(nullptr), used(0) {}
+        ~ThreadRecord()
+        {
+            if(record)
+                record->active.store(false, std::memory_order_release);
+        }
+
+        Record* record;
+        unsigned used;              // A bit for each hazard pointer in use
+    };
+
+    static Record* records()
+    {
+        static Record all[MaxThreads];
+        return all;
+    }
+
+    static ThreadRecord& threadRecord()
+    {
+        static thread_local ThreadRecord t;
+        return t;
+    }
+
+    static std::atomic<void*>* acquire()
+    {
+        ThreadRecord& t = threadRecord();
+        if(!t.record)
+        {
+            for(int i = 0; i < MaxThreads && !t.record; ++i)
+            {
+                bool expected = false;
+                if(records()[i].active.compare_exchange_strong(expected, true, std::memory_order_seq_cst))
+                    t.record = &records()[i];
+            }
+            if(!t.record)
+                throw std::length_error("HazardPointers: more than MaxThreads threads");
+        }
+        for(int i = 0; i < PerThread; ++i)
+            if(!(t.used & (1u << i)))
+            {
+                t.used |= 1u << i;
+                return &t.record->hazards[i];
+            }
+        throw std::length_error("HazardPointers: more than PerThread pointers protected by a thread");
+    }
+};
+
+template<class T>
+class AtomicSharedPtr
+{
+    struct Node
+    {
+        explicit Node(std::shared_ptr<T> sp):value(std::move(sp)) {}
+        const std::shared_ptr<T> value;
+    };
+
+public:
+    // The object of the slot when the guard was made, alive until the guard is destroyed.
+    class ReadGuard
+    {
+    public:
+        explicit ReadGuard(const AtomicSharedPtr& slot):_node(_hazard.protect(slot._node)) {}
+
+        T* get() const { return _node->value.get(); }
+        T& operator*() const { return *get(); }
+        T* operator->() const { return get(); }
+        explicit operator bool() const { return get() != nullptr; }
+
+    private:
+        HazardPointers::Hazard _hazard;
+        const Node* _node;
+    };
+
+    explicit AtomicSharedPtr(std::shared_ptr<T> sp = std::shared_ptr<T>()):_node(new Node(std::move(sp))) {}
+
+    // No reader may be left.
+    ~AtomicSharedPtr()
+    {
+        delete _node.load(std::memory_order_relaxed);
+        for(Node* n : _retired)
+            delete n;
+    }
+
+    AtomicSharedPtr(const AtomicSharedPtr&) = delete;
+    AtomicSharedPtr& operator=(const AtomicSharedPtr&) = delete;
+
+    std::shared_ptr<T> load() const
+    {
+        HazardPointers::Hazard hazard;
+        return hazard.protect(_node)->value;
+    }
+
+    void store(std::shared_ptr<T> sp) { exchange(std::move(sp)); }
+
+    std::shared_ptr<T> exchange(std::shared_ptr<T> sp)
+    {
+        Node* old = _node.exchange(new Node(std::move(sp)), std::memory_order_seq_cst);
+        std::shared_ptr<T> previous = old->value;
+        retire(old);
+        return previous;
+    }
+
+    // The readers never take a lock.
+    static bool is_lock_free() { return std::atomic<Node*>().is_lock_free(); }
+
+    std::size_t retired() const
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        return _retired.size();
+    }
+
+private:
+    static const std::size_t ScanAt = 64;
+
+    void retire(Node* old)
+    {
+        std::vector<Node*> free;
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _retired.push_back(old);
+            if(_retired.size() < ScanAt)
+                return;
+
+            std::vector<void*> hazards = HazardPointers::snapshot();
+            std::vector<Node*> kept;
+            for(Node* n : _retired)
+                (std::binary_search(hazards.begin(), hazards.end(), static_cast<void*>(n)) ? kept : free).push_back(n);
+            _retired.swap(kept);
+        }
+        for(Node* n : free)
+            delete n;           // Releases its shared_ptr: the object may be destroyed here, out of the lock
+    }
+
+    std::atomic<Node*> _node;
+    mutable std::mutex _mtx;
+    std::vector<Node*> _retired;
+};
+
+class Shape
+{
+public:
+    static bool verbose;    // Off for the benchmarks
+
+    Shape(int i):_i(i), _alive(Alive) { if(verbose) std::cout << "Shape constructor <" << this << "> i:" << _i << std::endl; }
+    ~Shape()
+    {
+        _alive = 0;
+        if(verbose) std::cout << "Shape destructor <" << this << ">" << std::endl;
+    }
+
+    void draw() const { std::cout << "<" << this << "> _i:" << _i << std::endl; }
+    int id() const { return _i; }
+    bool alive() const { return _alive == Alive; }
+protected:
+    static const unsigned Alive = 0x5a5a5a5a;
+
+    int _i;
+    volatile unsigned _alive;       // Cleared by the destructor, checked by the readers
+};
+
+bool Shape::verbose = true;
+
+// The ways to publish a Shape to the readers
+struct StdAtomicSlot        // std::atomic_load and std::atomic_store of libstdc++
+{
+    explicit StdAtomicSlot(std::shared_ptr<Shape> sp):_sp(std::move(sp)) {}
+    long read() const { std::shared_ptr<Shape> sp = std::atomic_load(&_sp); return sp->alive() ? sp->id() : -1; }
+    void store(std::shared_ptr<Shape> sp) { std::atomic_store(&_sp, std::move(sp)); }
+    std::shared_ptr<Shape> _sp;
+};
+
+struct MutexSlot            // A shared_ptr and a mutex
+{
+    explicit MutexSlot(std::shared_ptr<Shape> sp):_sp(std::move(sp)) {}
+    long read() const
+    {
+        std::shared_ptr<Shape> sp;
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            sp = _sp;
+        }
+        return sp->alive() ? sp->id() : -1;
+    }
+    void store(std::shared_ptr<Shape> sp)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _sp.swap(sp);
+    }
+    mutable std::mutex _mtx;
+    std::shared_ptr<Shape> _sp;
+};
+
+struct LoadSlot             // AtomicSharedPtr::load(), a shared_ptr copy
+{
+    explicit LoadSlot(std::shared_ptr<Shape> sp):_slot(std::move(sp)) {}
+    long read() const { std::shared_ptr<Shape> sp = _slot.load(); return sp->alive() ? sp->id() : -1; }
+    void store(std::shared_ptr<Shape> sp) { _slot.store(std::move(sp)); }
+    AtomicSharedPtr<Shape> _slot;
+};
+
+struct GuardSlot            // AtomicSharedPtr::ReadGuard, no copy
+{
+    explicit GuardSlot(std::shared_ptr<Shape> sp):_slot(std::move(sp)) {}
+    long read() const { AtomicSharedPtr<Shape>::ReadGuard g(_slot); return g->alive() ? g->id() : -1; }
+    void store(std::shared_ptr<Shape> sp) { _slot.store(std::move(sp)); }
+    AtomicSharedPtr<Shape> _slot;
+};
+
+// The readers read n times each while the writer swaps the Shape. Returns the reads per second, counts the Shapes
+// read after their destruction in bad.
+template<class Slot>
+double readers(unsigned threads, int n, long& bad)
+{
+    Slot slot(std::make_shared<Shape>(0));
+    std::atomic<unsigned> running(threads);
+    std::atomic<long> destroyed(0);
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    std::thread writer([&slot, &running]() {
+        for(int i = 1; running.load(std::memory_order_relaxed) > 0; ++i)
+        {
+            slot.store(std::make_shared<Shape>(i));
+            std::this_thread::yield();
+        }
+    });
+    std::vector<std::thread> workers;
+    for(unsigned t = 0; t < threads; ++t)
+        workers.push_back(std::thread([&slot, &running, &destroyed, n]() {
+            long wrong = 0;
+            for(int i = 0; i < n; ++i)
+                wrong += slot.read() < 0;
+            destroyed += wrong;
+            --running;
+        }));
+    for(std::thread& w : workers)
+        w.join();
+    writer.join();
+
+    bad += destroyed;
+    return threads * double(n) / std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned maxReaders = (argc > 1) ? static_cast<unsigned>(std::max(std::atoi(argv[1]), 1)) : 16;
+
+    std::cout << "----------------- sp3 = sp4, published ----------------" << std::endl;
+    {
+        AtomicSharedPtr<Shape> current(std::make_shared<Shape>(1000));
+        std::shared_ptr<Shape> sp4 = std::make_shared<Shape>(50);
+
+        std::shared_ptr<Shape> kept = current.load();
+        {
+            AtomicSharedPtr<Shape>::ReadGuard g(current);
+            current.store(sp4);         // Shape(1000) stays: kept and the guard refer to it
+            std::cout << "The guard still reads: ";
+            g->draw();
+        }
+        std::cout << "kept.use_count(): " << kept.use_count() << ", the retired Node still holds it until a scan" << std::endl;
+        kept.reset();
+        std::cout << "current.load(): ";
+        current.load()->draw();
+        std::cout << "Readers lock-free: " << std::boolalpha << AtomicSharedPtr<Shape>::is_lock_free() << std::endl;
+    }
+
+    Shape::verbose = false;
+    const int n = 1 << 20;
+    long bad = 0;
+    std::cout << "----------------- Reads per second, with a writer swapping the Shape ----------------" << std::endl;
+    std::cout << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    for(unsigned threads = 1; threads <= maxReaders; threads *= 2)
+    {
+        std::cout << threads << " reader(s)" << std::endl;
+        double base = readers<StdAtomicSlot>(threads, n / threads, bad);
+        std::cout << "    std::atomic_load(&sp)       : " << base / 1e6 << " M/s" << std::endl;
+        double r = readers<MutexSlot>(threads, n / threads, bad);
+        std::cout << "    std::mutex + shared_ptr     : " << r / 1e6 << " M/s, speedup " << r / base << std::endl;
+        r = readers<LoadSlot>(threads, n / threads, bad);
+        std::cout << "    AtomicSharedPtr::load()     : " << r / 1e6 << " M/s, speedup " << r / base << std::endl;
+        r = readers<GuardSlot>(threads, n / threads, bad);
+        std::cout << "    AtomicSharedPtr::ReadGuard  : " << r / 1e6 << " M/s, speedup " << r / base << std::endl;
+    }
+    std::cout << "Shapes read after their destruction: " << bad << std::endl;
+
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,363 @@
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <algorithm>
+#include <cstddef>
+
+/*********
+A program to show deleters that hand the objects to a queue, destroyed later in batches.
+
+The custom deleters of 9_SharedPtr.cpp(the lambda that prints and deletes, the delete[] of spArr) run on the
+thread that drops the last shared_ptr, in the middle of whatever it was doing. When the object owns others, e.g.
+a group of thousands of Shapes, that thread pays for all the destructors at once.
+
+ReclamationQueue keeps the objects given by its deleters, and destroys them later:
+
+    deleter<T>(bytes)           a deleter for shared_ptr<T> or unique_ptr<T, ...>, that queues the object.
+    arrayDeleter<T>(n)          the same for new T[n], destroyed with delete[].
+    start(), stop()             a background thread destroys the queued objects, a batch at a time: the lock is
+                                taken once per batch, the destructors run without it.
+    drain(max)                  destroys up to max objects on the calling thread, e.g. at the end of each turn
+                                of an event loop, when there is no background thread.
+    stats()                     the objects and bytes pending, their maximum, and the objects deferred,
+                                destroyed, in how many batches, and those that met the backpressure.
+
+The queue is bounded by a number of objects and a number of bytes(the sizes given to the deleters). A deleter
+finding it full waits for the background thread(backpressure), or destroys its object itself when there is no
+background thread, or when it runs on that thread(a destructor that releases other objects).
+
+The objects are destroyed on another thread than the one that released them: their destructors must allow it.
+
+The latency of releasing groups of Shapes(mostly small, a few with 20000 Shapes) is measured with the deleter
+of 9_SharedPtr.cpp and with a ReclamationQueue.
+*********/
+
+class ReclamationQueue
+{
+public:
+    struct Stats
+    {
+        std::size_t pendingObjects;
+        std::size_t pendingBytes;
+        std::size_t maxPendingBytes;
+        unsigned long deferred;
+        unsigned long destroyed;
+        unsigned long batches;
+        unsigned long waits;        // Deleters that waited for room in the queue
+        unsigned long inlined;      // Deleters that destroyed their object themselves, the queue being full
+    };
+
+    template<class T>
+    class Deleter
+    {
+    public:
+        Deleter(ReclamationQueue& q, std::size_t bytes):_q(&q), _bytes(bytes) {}
+        void operator()(T* p) const { _q->defer(p, &destroyObject<T>, _bytes); }
+    private:
+        ReclamationQueue* _q;
+        std::size_t _bytes;
+    };
+
+    template<class T>
+    class ArrayDeleter
+    {
+    public:
+        ArrayDeleter(ReclamationQueue& q, std::size_t n):_q(&q), _bytes(n * sizeof(T)) {}
+        void operator()(T* p) const { _q->defer(p, &destroyArray<T>, _bytes); }
+    private:
+        ReclamationQueue* _q;
+        std::size_t _bytes;
+    };
+
+    ReclamationQueue(std::size_t maxObjects, std::size_t maxBytes, std::size_t batch = 64)
+        :_maxObjects(maxObjects), _maxBytes(maxBytes), _batch(std::max(batch, std::size_t(1))), _running(false)
+    {
+        Stats s = { 0, 0, 0, 0, 0, 0, 0, 0 };
+        _stats = s;
+    }
+
+    ~ReclamationQueue()
+    {
+        stop();
+        drain(std::size_t(-1));
+    }
+
+    ReclamationQueue(const ReclamationQueue&) = delete;
+    ReclamationQueue& operator=(const ReclamationQueue&) = delete;
+
+    // bytes: what the object holds, for the bound and the stats(sizeof(T) by default).
+    template<class T>
+    Deleter<T> deleter(std::size_t bytes = sizeof(T)) { return Deleter<T>(*this, bytes); }
+
+    template<class T>
+    ArrayDeleter<T> arrayDeleter(std::size_t n) { return ArrayDeleter<T>(*this, n); }
+
+    void start()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if(_running)
+            return;
+        _running = true;
+        _worker = std::thread(&ReclamationQueue::work, this);
+        _workerId = _worker.get_id();
+    }
+
+    // The objects left in the queue stay there, for drain() or the destructor.
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            if(!_running)
+                return;
+            _running = false;
+        }
+        _ready.notify_all();
+        _room.notify_all();
+        _worker.join();
+        std::lock_guard<std::mutex> lock(_mtx);
+        _workerId = std::thread::id();
+    }
+
+    // Destroys up to max objects, returns their number.
+    std::size_t drain(std::size_t max)
+    {
+        std::size_t done = 0;
+        std::vector<Entry> batch;
+        while(done < max)
+        {
+            batch.clear();
+            {
+                std::lock_guard<std::mutex> lock(_mtx);
+                take(batch, std::min(_batch, max - done));
+            }
+            if(batch.empty())
+                break;
+            destroy(batch);
+            done += batch.size();
+        }
+        return done;
+    }
+
+    Stats stats() const
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        Stats s = _stats;
+        s.pendingObjects = _queue.size();
+        return s;
+    }
+
+private:
+    struct Entry
+    {
+        void* p;
+        void (*destroy)(void*);
+        std::size_t bytes;
+    };
+
+    template<class T>
+    static void destroyObject(void* p) { delete static_cast<T*>(p); }
+
+    template<class T>
+    static void destroyArray(void* p) { delete[] static_cast<T*>(p); }
+
+    void defer(void* p, void (*destroyFn)(void*), std::size_t bytes)
+    {
+        if(!p)
+            return;
+        Entry e = { p, destroyFn, bytes };
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            // The background thread cannot wait for itself
+            if(full(bytes) && _running && std::this_thread::get_id() != _workerId)
+            {
+                ++_stats.waits;
+                _ready.notify_one();
+                _room.wait(lock, [this, bytes]() { return !full(bytes) || !_running; });
+            }
+            if(full(bytes))
+            {
+                ++_stats.inlined;
+                lock.unlock();
+                destroyFn(p);
+                return;
+            }
+            _queue.push_back(e);
+            _stats.pendingBytes += bytes;
+            _stats.maxPendingBytes = std::max(_stats.maxPendingBytes, _stats.pendingBytes);
+            ++_stats.deferred;
+        }
+        _ready.notify_one();
+    }
+
+    // An empty queue takes any object, whatever its size.
+    bool full(std::size_t bytes) const
+    {
+        return !_queue.empty() && (_queue.size() >= _maxObjects || _stats.pendingBytes + bytes > _maxBytes);
+    }
+
+    // The lock is held.
+    void take(std::vector<Entry>& batch, std::size_t n)
+    {
+        for(; n > 0 && !_queue.empty(); --n)
+        {
+            batch.push_back(_queue.front());
+            _stats.pendingBytes -= _queue.front().bytes;
+            _queue.pop_front();
+        }
+        if(!batch.empty())
+        {
+            _stats.destroyed += batch.size();
+            ++_stats.batches;
+            _room.notify_all();
+        }
+    }
+
+    static void destroy(const std::vector<Entry>& batch)
+    {
+        for(const Entry& e : batch)
+            e.destroy(e.p);
+    }
+
+    void work()
+    {
+        std::vector<Entry> batch;
+        std::unique_lock<std::mutex> lock(_mtx);
+        while(_running)
+        {
+            _ready.wait(lock, [this]() { return !_queue.empty() || !_running; });
+            batch.clear();
+            take(batch, _batch);
+            lock.unlock();
+            destroy(batch);
+            lock.lock();
+        }
+    }
+
+    const std::size_t _maxObjects;
+    const std::size_t _maxBytes;
+    const std::size_t _batch;
+
+    mutable std::mutex _mtx;
+    std::condition_variable _ready;     // Objects to destroy, or stop()
+    std::condition_variable _room;      // Room in the queue
+    std::deque<Entry> _queue;
+    Stats _stats;
+    bool _running;
+    std::thread _worker;
+    std::thread::id _workerId;
+};
+
+class Shape
+{
+public:
+    static bool verbose;    // Off for the benchmarks
+
+    Shape(int i = 0):_i(i) { if(verbose) std::cout << "Shape constructor <" << this << "> i:" << _i << std::endl; }
+    ~Shape() { if(verbose) std::cout << "Shape destructor <" << this << ">" << std::endl; }
+
+    void draw() { std::cout << "Inside Shape::draw(), _i:" << _i << std::endl; }
+    int id() const { return _i; }
+protected:
+    int _i;
+};
+
+bool Shape::verbose = true;
+
+// A Shape owning others: its destruction destroys them all.
+struct Group
+{
+    explicit Group(int n)
+    {
+        for(int i = 0; i < n; ++i)
+            shapes.push_back(std::unique_ptr<Shape>(new Shape(i)));
+    }
+    std::vector<std::unique_ptr<Shape> > shapes;
+};
+
+void printStats(const ReclamationQueue& q)
+{
+    ReclamationQueue::Stats s = q.stats();
+    std::cout << "pending " << s.pendingObjects << " objects, " << s.pendingBytes << " bytes(max " << s.maxPendingBytes
+              << "), deferred " << s.deferred << ", destroyed " << s.destroyed << " in " << s.batches << " batches, waits "
+              << s.waits << ", inlined " << s.inlined << std::endl;
+}
+
+// Releases groups of Shapes, returns the time of each release in microseconds.
+template<class MakeDeleter>
+std::vector<double> releaseLatencies(MakeDeleter makeDeleter, int groups)
+{
+    std::vector<double> us;
+    for(int g = 0; g < groups; ++g)
+    {
+        int n = (g % 50 == 49) ? 20000 : 20;
+        std::shared_ptr<Group> sp(new Group(n), makeDeleter(n));
+
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        sp.reset();
+        us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+    }
+    std::sort(us.begin(), us.end());
+    return us;
+}
+
+void printLatencies(const char* name, const std::vector<double>& us)
+{
+    std::cout << name << ": p50 " << us[us.size() / 2] << " us, p99 " << us[us.size() * 99 / 100] << " us, p99.9 "
+              << us[us.size() * 999 / 1000] << " us, max " << us.back() << " us" << std::endl;
+}
+
+int main()
+{
+    std::cout << "----------------- The deleters of 9_SharedPtr.cpp, deferred ----------------" << std::endl;
+    {
+        ReclamationQueue queue(1024, 1 << 20);
+        std::shared_ptr<Shape> sp(new Shape(1122), queue.deleter<Shape>());
+        std::shared_ptr<Shape> spArr(new Shape[3], queue.arrayDeleter<Shape>(3));
+        sp.reset();
+        spArr.reset();
+        std::cout << "Released, nothing destroyed yet: ";
+        printStats(queue);
+        std::cout << "drain(): " << queue.drain(100) << " objects destroyed" << std::endl;
+        printStats(queue);
+    }
+
+    std::cout << "----------------- Backpressure ----------------" << std::endl;
+    Shape::verbose = false;
+    {
+        ReclamationQueue queue(16, 1 << 20);
+        for(int i = 0; i < 100; ++i)
+            std::unique_ptr<Shape, ReclamationQueue::Deleter<Shape> >(new Shape(i), queue.deleter<Shape>());
+        std::cout << "No background thread, bound of 16 objects: ";
+        printStats(queue);
+
+        queue.start();
+        for(int i = 0; i < 10000; ++i)
+            std::unique_ptr<Group, ReclamationQueue::Deleter<Group> >(new Group(10), queue.deleter<Group>(10 * sizeof(Shape)));
+        queue.stop();
+        queue.drain(std::size_t(-1));
+        std::cout << "Background thread: ";
+        printStats(queue);
+    }
+
+    const int groups = 5000;
+    std::cout << "----------------- Release latency of " << groups << " groups, 1 in 50 of 20000 Shapes ----------------" << std::endl;
+    std::vector<double> direct = releaseLatencies([](int) {
+        return [](Group* g) { delete g; };      // The deleter of 9_SharedPtr.cpp, without the output
+    }, groups);
+    printLatencies("delete on the releasing thread  ", direct);
+
+    ReclamationQueue queue(4096, 64 << 20);
+    queue.start();
+    std::vector<double> deferred = releaseLatencies([&queue](int n) { return queue.deleter<Group>(n * sizeof(Shape)); }, groups);
+    queue.stop();
+    queue.drain(std::size_t(-1));
+    printLatencies("ReclamationQueue, background    ", deferred);
+    printStats(queue);
+
+    return 0;
+}
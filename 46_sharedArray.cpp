@@ -0,0 +1,299 @@
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <cstddef>
+
+#define SAMPLE_COUNT_HEAP      // heapBytes, heapAllocations
+#include "sampleUtil.h"
+
+/*********
+A program to show a shared array whose control block and elements are a single allocation.
+
+spArr of 9_SharedPtr.cpp is a shared_ptr<Shape>(new Shape[3], deleter): two allocations(the array, then the control
+block), and nothing knows the size of the array. uptrs of 11_uniquePtr.cpp, a unique_ptr<Shape[]>(new Shape[4]),
+has operator[] but no size and no bounds either.
+
+SharedArray<T> is made by make_shared_array<T>(n, args...)(each element is built from args), or by
+generate_shared_array<T>(n, f)(element i is built from f(i)):
+
+    size(), operator[], at(i)   the length, an element, an element with its bounds checked(std::out_of_range).
+    begin(), end(), data()      the elements are contiguous: the iterators are pointers.
+    element(i)                  a shared_ptr<T> to element i, made with the aliasing constructor of shared_ptr: it
+                                shares the count of the whole array, which stays alive while any of them does.
+    use_count()                 the SharedArray and the element handles alive.
+
+The elements are put after the control block of std::allocate_shared: the allocator given to it allocates the room of
+the n elements at the end of the control block. std::allocate_shared allocates its control block with a single
+allocate(1)(libstdc++, libc++ and the MSVC library all do), which the allocator checks.
+
+The elements are built in order, and destroyed in the reverse order. When a constructor throws, the elements already
+built are destroyed and the allocation is freed before the exception goes on.
+
+The allocations are counted by replacing the global operator new, and the creation of small arrays and the iteration
+over a large one are timed against shared_ptr(new Shape[n], deleter) and a vector<shared_ptr<Shape>>.
+*********/
+
+template<class T>
+class SharedArray
+{
+public:
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    SharedArray():_size(0) {}
+
+    std::size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    T& operator[](std::size_t i) const { return _first.get()[i]; }
+
+    T& at(std::size_t i) const
+    {
+        if(i >= _size)
+            throw std::out_of_range("SharedArray::at(): index " + std::to_string(i) + " >= size " + std::to_string(_size));
+        return _first.get()[i];
+    }
+
+    std::shared_ptr<T> element(std::size_t i) const { return std::shared_ptr<T>(_first, &at(i)); }
+
+    T* data() const { return _first.get(); }
+    iterator begin() const { return _first.get(); }
+    iterator end() const { return _first.get() + _size; }
+
+    long use_count() const { return _first.use_count(); }
+    explicit operator bool() const { return static_cast<bool>(_first); }
+
+    template<class U, class... Args>
+    friend SharedArray<U> make_shared_array(std::size_t n, const Args&... args);
+
+    template<class U, class Generate>
+    friend SharedArray<U> generate_shared_array(std::size_t n, Generate f);
+
+private:
+    static_assert(alignof(T) <= alignof(std::max_align_t), "SharedArray: the elements are over-aligned");
+
+    // The elements, at the end of the allocation of the control block.
+    class Elements
+    {
+    public:
+        // data is set by Allocator::allocate(), which std::allocate_shared calls before this constructor.
+        template<class Build>
+        Elements(T* const* data, std::size_t n, Build build):_data(*data), _size(0)
+        {
+            try
+            {
+                for(; _size < n; ++_size)
+                    build(static_cast<void*>(_data + _size), _size);
+            }
+            catch(...)
+            {
+                destroy();
+                throw;
+            }
+        }
+
+        ~Elements() { destroy(); }
+
+        Elements(const Elements&) = delete;
+        Elements& operator=(const Elements&) = delete;
+
+        T* data() const { return _data; }
+
+    private:
+        void destroy()
+        {
+            while(_size > 0)
+                _data[--_size].~T();
+        }
+
+        T* _data;
+        std::size_t _size;      // Of the elements built
+    };
+
+    // Gives std::allocate_shared the room of its control block and of n elements in one block.
+    template<class U>
+    class Allocator
+    {
+    public:
+        typedef U value_type;
+        template<class V> struct rebind { typedef Allocator<V> other; };
+
+        Allocator(std::size_t n, T** data):_n(n), _data(data) {}
+        template<class V>
+        Allocator(const Allocator<V>& other):_n(other._n), _data(other._data) {}
+
+        U* allocate(std::size_t count)
+        {
+            if(count != 1)
+                throw std::logic_error("SharedArray: the control block is expected in a single allocate(1)");
+            if(_n > (std::size_t(-1) - offset()) / sizeof(T))
+                throw std::bad_array_new_length();
+            char* p = static_cast<char*>(::operator new(offset() + _n * sizeof(T)));
+            *_data = reinterpret_cast<T*>(p + offset());
+            return reinterpret_cast<U*>(p);
+        }
+
+        void deallocate(U* p, std::size_t) { ::operator delete(p); }
+
+        template<class V>
+        bool operator==(const Allocator<V>& other) const { return _n == other._n && _data == other._data; }
+        template<class V>
+        bool operator!=(const Allocator<V>& other) const { return !(*this == other); }
+
+    private:
+        template<class V> friend class Allocator;
+
+        // The control block, rounded up to the alignment of the elements
+        static std::size_t offset() { return (sizeof(U) + alignof(T) - 1) / alignof(T) * alignof(T); }
+
+        std::size_t _n;
+        T** _data;
+    };
+
+    template<class Build>
+    static SharedArray make(std::size_t n, Build build)
+    {
+        T* data = nullptr;
+        std::shared_ptr<Elements> block = std::allocate_shared<Elements>(Allocator<Elements>(n, &data), &data, n, build);
+        SharedArray a;
+        a._first = std::shared_ptr<T>(block, block->data());
+        a._size = n;
+        return a;
+    }
+
+    std::shared_ptr<T> _first;      // Aliases the first element, sharing the count of the block
+    std::size_t _size;
+};
+
+template<class T, class... Args>
+SharedArray<T> make_shared_array(std::size_t n, const Args&... args)
+{
+    return SharedArray<T>::make(n, [&](void* where, std::size_t) { ::new(where) T(args...); });
+}
+
+template<class T, class Generate>
+SharedArray<T> generate_shared_array(std::size_t n, Generate f)
+{
+    return SharedArray<T>::make(n, [&f](void* where, std::size_t i) { ::new(where) T(f(i)); });
+}
+
+class Shape
+{
+public:
+    static bool verbose;    // Off for the benchmarks
+    static int throwAt;     // The id whose constructor throws, to show the cleanup
+
+    Shape(int i = 0):_i(i)
+    {
+        if(_i == throwAt)
+            throw std::runtime_error("Shape " + std::to_string(_i) + " cannot be built");
+        if(verbose) std::cout << "Shape constructor <" << this << "> i:" << _i << std::endl;
+    }
+    ~Shape() { if(verbose) std::cout << "Shape destructor <" << this << "> i:" << _i << std::endl; }
+
+    void draw() { std::cout << "Inside Shape::draw(), _i:" << _i << std::endl; }
+    int id() const { return _i; }
+protected:
+    int _i;
+};
+
+bool Shape::verbose = true;
+int Shape::throwAt = -1;
+
+// For measure(): the allocations made by the global operator new
+unsigned long heapAllocationCount() { return heapAllocations.load(); }
+
+int main()
+{
+    std::cout << "----------------- spArr of 9_SharedPtr.cpp ----------------" << std::endl;
+    std::shared_ptr<Shape> second;
+    {
+        unsigned long before = heapAllocations.load();
+        std::size_t bytes = heapBytes.load();
+        SharedArray<Shape> spArr = generate_shared_array<Shape>(3, [](std::size_t i) { return int(100 + i); });
+        std::cout << heapAllocations.load() - before << " allocation(s) of " << heapBytes.load() - bytes << " bytes, size "
+                  << spArr.size() << std::endl;
+
+        for(Shape& s : spArr)
+            s.draw();
+
+        second = spArr.element(1);
+        std::cout << "element(1): " << second.get() << ", use_count: " << spArr.use_count() << std::endl;
+
+        try
+        {
+            spArr.at(3).draw();
+        }
+        catch(const std::out_of_range& e)
+        {
+            std::cout << "Exception: " << e.what() << std::endl;
+        }
+        std::cout << "spArr goes out of scope" << std::endl;
+    }
+    std::cout << "The array is alive through element(1): ";
+    second->draw();
+    std::cout << "second.reset()" << std::endl;
+    second.reset();
+
+    std::cout << "----------------- A constructor that throws ----------------" << std::endl;
+    Shape::throwAt = 2;
+    try
+    {
+        SharedArray<Shape> arr = generate_shared_array<Shape>(4, [](std::size_t i) { return int(i); });
+    }
+    catch(const std::runtime_error& e)
+    {
+        std::cout << "Exception: " << e.what() << std::endl;
+    }
+    Shape::throwAt = -1;
+
+    Shape::verbose = false;
+    const int arrays = 1 << 20;
+    std::cout << "----------------- " << arrays << " arrays of 4 Shapes, made and released ----------------" << std::endl;
+    double base = measure("shared_ptr(new Shape[4], deleter)", [&]() {
+        long sum = 0;
+        for(int i = 0; i < arrays; ++i)
+        {
+            std::shared_ptr<Shape> sp(new Shape[4], [](Shape* s) { delete[] s; });
+            sum += sp.get()[3].id();
+        }
+        return sum;
+    }, arrays, 0, heapAllocationCount);
+    measure("make_shared_array<Shape>(4)      ", [&]() {
+        long sum = 0;
+        for(int i = 0; i < arrays; ++i)
+        {
+            SharedArray<Shape> a = make_shared_array<Shape>(4);
+            sum += a[3].id();
+        }
+        return sum;
+    }, arrays, base, heapAllocationCount);
+
+    const int shapes = 1 << 22;
+    std::cout << "----------------- Iterate over " << shapes << " Shapes, 16 times ----------------" << std::endl;
+    std::vector<std::shared_ptr<Shape> > owners;
+    for(int i = 0; i < shapes; ++i)
+        owners.push_back(std::make_shared<Shape>(i));
+    SharedArray<Shape> arr = generate_shared_array<Shape>(shapes, [](std::size_t i) { return int(i); });
+
+    base = measure("vector<shared_ptr<Shape>>", [&]() {
+        long sum = 0;
+        for(int t = 0; t < 16; ++t)
+            for(const std::shared_ptr<Shape>& sp : owners)
+                sum += sp->id();
+        return sum;
+    }, 16 * std::size_t(shapes), 0, heapAllocationCount);
+    measure("SharedArray<Shape>       ", [&]() {
+        long sum = 0;
+        for(int t = 0; t < 16; ++t)
+            for(const Shape& s : arr)
+                sum += s.id();
+        return sum;
+    }, 16 * std::size_t(shapes), base, heapAllocationCount);
+
+    return 0;
+}
@@ -0,0 +1,367 @@
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <tuple>
+#include <type_traits>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <string>
+#include <cstdlib>
+#include <cstddef>
+
+#include "sampleUtil.h"
+
+/*********
+A program to show a batch of shapes stored by kind, in columns(struct of arrays), instead of one object per shape.
+
+The Shapes of 9_SharedPtr.cpp, 10_weak_ptr.cpp and 11_uniquePtr.cpp are allocated one at a time, and drawn one at a
+time through a pointer. With a class per kind of shape and a virtual draw(), a scene is a vector<unique_ptr<Shape>>:
+drawing it loads each pointer, then the object somewhere on the heap, then its vtable, and calls the function of
+its kind, the kinds being mixed.
+
+ShapeBatch keeps the shapes of each kind together, each field in its own vector(Columns<Fields...>):
+
+    addCircle(), addRectangle(), addTriangle()  append a shape to the columns of its kind.
+    draw(canvas)            one loop per kind: the function is chosen once per group instead of once per shape,
+                            and each loop reads its columns from start to end.
+    eraseIf(pred)           erases the shapes whose id matches, moving the others down in one pass: the columns
+                            stay contiguous, in the order of insertion.
+    size(), circles()...    the number of shapes, and the columns of each kind.
+
+Columns<Fields...> is a tuple of vectors, one per field. A push_back() that throws(bad_alloc) leaves all the
+columns at their previous size.
+
+A scene of 10M shapes is drawn as a vector<unique_ptr<Shape>> and as a ShapeBatch, then 1 in 10 shapes is erased.
+
+Usage: 47_shapeBatch [shapes(default 10000000)]
+*********/
+
+template<class... Fields>
+class Columns
+{
+public:
+    template<std::size_t I>
+    using Column = std::vector<typename std::tuple_element<I, std::tuple<Fields...> >::type>;
+
+    std::size_t size() const { return std::get<0>(_columns).size(); }
+    bool empty() const { return size() == 0; }
+
+    template<std::size_t I>
+    Column<I>& column() { return std::get<I>(_columns); }
+
+    template<std::size_t I>
+    const Column<I>& column() const { return std::get<I>(_columns); }
+
+    void reserve(std::size_t n)
+    {
+        Reserve r = { n };
+        each(r);
+    }
+
+    void push_back(const Fields&... values)
+    {
+        std::size_t n = size();
+        try
+        {
+            push<0>(values...);
+        }
+        catch(...)
+        {
+            Truncate t = { n };
+            each(t);
+            throw;
+        }
+    }
+
+    // Keeps the rows whose keep[row] is set, in their order. Returns the number of rows erased.
+    std::size_t compact(const std::vector<char>& keep)
+    {
+        std::size_t n = size();
+        Compact c = { keep };
+        each(c);
+        return n - size();
+    }
+
+private:
+    struct Reserve
+    {
+        std::size_t n;
+        template<class V> void operator()(V& column) { column.reserve(n); }
+    };
+
+    struct Truncate
+    {
+        std::size_t n;
+        template<class V> void operator()(V& column) { if(column.size() > n) column.erase(column.begin() + n, column.end()); }
+    };
+
+    struct Compact
+    {
+        const std::vector<char>& keep;
+        template<class V> void operator()(V& column)
+        {
+            typename V::value_type* values = column.data();
+            const char* rows = keep.data();
+            std::size_t n = column.size(), k = 0;
+            for(std::size_t row = 0; row < n; ++row)
+            {
+                values[k] = values[row];        // Without a branch: overwritten when the row is erased
+                k += rows[row];
+            }
+            column.erase(column.begin() + k, column.end());
+        }
+    };
+
+    template<std::size_t I, class V, class... Rest>
+    void push(const V& value, const Rest&... rest)
+    {
+        std::get<I>(_columns).push_back(value);
+        push<I + 1>(rest...);
+    }
+
+    template<std::size_t I>
+    void push() {}
+
+    template<std::size_t I = 0, class F>
+    typename std::enable_if<(I < sizeof...(Fields))>::type each(F& f)
+    {
+        f(std::get<I>(_columns));
+        each<I + 1>(f);
+    }
+
+    template<std::size_t I = 0, class F>
+    typename std::enable_if<(I == sizeof...(Fields))>::type each(F&) {}
+
+    std::tuple<std::vector<Fields>...> _columns;
+};
+
+// What draw() does with a shape: adds its area to the cell of the canvas under its position.
+class Canvas
+{
+public:
+    static const int Side = 256;        // Cells of 4x4 units: the shapes are in [0, 1024)
+
+    Canvas():_coverage(Side * Side, 0.0), _shapes(0) {}
+
+    void fill(float x, float y, float area)
+    {
+        _coverage[cell(y) * Side + cell(x)] += area;
+        ++_shapes;
+    }
+
+    double total() const
+    {
+        double sum = 0;
+        for(double c : _coverage)
+            sum += c;
+        return sum;
+    }
+
+    unsigned long shapes() const { return _shapes; }
+
+private:
+    static int cell(float v) { return std::min(static_cast<int>(v) >> 2, Side - 1); }
+
+    std::vector<double> _coverage;
+    unsigned long _shapes;
+};
+
+const float Pi = 3.14159265f;
+
+class Shape
+{
+public:
+    explicit Shape(int id):_id(id) {}
+    virtual ~Shape() {}
+
+    virtual void draw(Canvas& canvas) const = 0;
+    int id() const { return _id; }
+protected:
+    int _id;
+};
+
+class Circle : public Shape
+{
+public:
+    Circle(int id, float x, float y, float r):Shape(id), _x(x), _y(y), _r(r) {}
+    void draw(Canvas& canvas) const override { canvas.fill(_x, _y, Pi * _r * _r); }
+private:
+    float _x, _y, _r;
+};
+
+class Rectangle : public Shape
+{
+public:
+    Rectangle(int id, float x, float y, float w, float h):Shape(id), _x(x), _y(y), _w(w), _h(h) {}
+    void draw(Canvas& canvas) const override { canvas.fill(_x, _y, _w * _h); }
+private:
+    float _x, _y, _w, _h;
+};
+
+class Triangle : public Shape
+{
+public:
+    Triangle(int id, float x, float y, float base, float height):Shape(id), _x(x), _y(y), _base(base), _height(height) {}
+    void draw(Canvas& canvas) const override { canvas.fill(_x, _y, 0.5f * _base * _height); }
+private:
+    float _x, _y, _base, _height;
+};
+
+class ShapeBatch
+{
+public:
+    typedef Columns<int, float, float, float> Circles;              // id, x, y, radius
+    typedef Columns<int, float, float, float, float> Rectangles;    // id, x, y, width, height
+    typedef Columns<int, float, float, float, float> Triangles;     // id, x, y, base, height
+
+    void addCircle(int id, float x, float y, float r) { _circles.push_back(id, x, y, r); }
+    void addRectangle(int id, float x, float y, float w, float h) { _rectangles.push_back(id, x, y, w, h); }
+    void addTriangle(int id, float x, float y, float base, float height) { _triangles.push_back(id, x, y, base, height); }
+
+    std::size_t size() const { return _circles.size() + _rectangles.size() + _triangles.size(); }
+
+    const Circles& circles() const { return _circles; }
+    const Rectangles& rectangles() const { return _rectangles; }
+    const Triangles& triangles() const { return _triangles; }
+
+    void draw(Canvas& canvas) const
+    {
+        const std::vector<float>& cx = _circles.column<1>();
+        const std::vector<float>& cy = _circles.column<2>();
+        const std::vector<float>& cr = _circles.column<3>();
+        for(std::size_t i = 0; i < cx.size(); ++i)
+            canvas.fill(cx[i], cy[i], Pi * cr[i] * cr[i]);
+
+        const std::vector<float>& rx = _rectangles.column<1>();
+        const std::vector<float>& ry = _rectangles.column<2>();
+        const std::vector<float>& rw = _rectangles.column<3>();
+        const std::vector<float>& rh = _rectangles.column<4>();
+        for(std::size_t i = 0; i < rx.size(); ++i)
+            canvas.fill(rx[i], ry[i], rw[i] * rh[i]);
+
+        const std::vector<float>& tx = _triangles.column<1>();
+        const std::vector<float>& ty = _triangles.column<2>();
+        const std::vector<float>& tb = _triangles.column<3>();
+        const std::vector<float>& th = _triangles.column<4>();
+        for(std::size_t i = 0; i < tx.size(); ++i)
+            canvas.fill(tx[i], ty[i], 0.5f * tb[i] * th[i]);
+    }
+
+    // pred(id): true for the shapes to erase. Returns their number.
+    template<class Pred>
+    std::size_t eraseIf(Pred pred)
+    {
+        return eraseIf(_circles, pred) + eraseIf(_rectangles, pred) + eraseIf(_triangles, pred);
+    }
+
+private:
+    template<class Group, class Pred>
+    static std::size_t eraseIf(Group& group, Pred& pred)
+    {
+        const std::vector<int>& ids = group.template column<0>();
+        std::vector<char> keep(ids.size());
+        for(std::size_t i = 0; i < ids.size(); ++i)
+            keep[i] = !pred(ids[i]);
+        return group.compact(keep);
+    }
+
+    Circles _circles;
+    Rectangles _rectangles;
+    Triangles _triangles;
+};
+
+int main(int argc, char* argv[])
+{
+    int shapes = (argc > 1) ? std::max(std::atoi(argv[1]), 1) : 10000000;
+
+    std::cout << "----------------- A small batch ----------------" << std::endl;
+    {
+        ShapeBatch batch;
+        batch.addCircle(1, 10, 10, 2);
+        batch.addRectangle(2, 20, 20, 3, 4);
+        batch.addTriangle(3, 30, 30, 4, 5);
+        batch.addCircle(4, 40, 40, 1);
+        Canvas canvas;
+        batch.draw(canvas);
+        std::cout << batch.circles().size() << " circles, " << batch.rectangles().size() << " rectangles, "
+                  << batch.triangles().size() << " triangles, area " << canvas.total() << std::endl;
+
+        std::size_t erased = batch.eraseIf([](int id) { return id % 2 == 1; });
+        std::cout << "eraseIf(odd id): " << erased << " erased, ids left:";
+        for(int id : batch.circles().column<0>())
+            std::cout << " " << id;
+        for(int id : batch.rectangles().column<0>())
+            std::cout << " " << id;
+        std::cout << std::endl;
+    }
+
+    std::cout << "----------------- A scene of " << shapes << " shapes, kinds mixed ----------------" << std::endl;
+    std::vector<std::unique_ptr<Shape> > scene;
+    ShapeBatch batch;
+    {
+        std::mt19937 gen(24);
+        std::uniform_int_distribution<int> kind(0, 2);
+        std::uniform_real_distribution<float> pos(0, 1024);
+        std::uniform_real_distribution<float> size(1, 8);
+        scene.reserve(shapes);
+        for(int id = 0; id < shapes; ++id)
+        {
+            float x = pos(gen), y = pos(gen), a = size(gen), b = size(gen);
+            switch(kind(gen))
+            {
+            case 0:
+                scene.push_back(std::unique_ptr<Shape>(new Circle(id, x, y, a)));
+                batch.addCircle(id, x, y, a);
+                break;
+            case 1:
+                scene.push_back(std::unique_ptr<Shape>(new Rectangle(id, x, y, a, b)));
+                batch.addRectangle(id, x, y, a, b);
+                break;
+            default:
+                scene.push_back(std::unique_ptr<Shape>(new Triangle(id, x, y, a, b)));
+                batch.addTriangle(id, x, y, a, b);
+                break;
+            }
+        }
+    }
+
+    const int frames = 5;
+    std::cout << "Draw, " << frames << " frames" << std::endl;
+    double base = measure("    vector<unique_ptr<Shape>>", [&]() {
+        double sum = 0;
+        for(int f = 0; f < frames; ++f)
+        {
+            Canvas canvas;
+            for(const std::unique_ptr<Shape>& s : scene)
+                s->draw(canvas);
+            sum += canvas.total();
+        }
+        return sum;
+    }, std::size_t(frames) * shapes, 0, nullptr, "shape");
+    measure("    ShapeBatch               ", [&]() {
+        double sum = 0;
+        for(int f = 0; f < frames; ++f)
+        {
+            Canvas canvas;
+            batch.draw(canvas);
+            sum += canvas.total();
+        }
+        return sum;
+    }, std::size_t(frames) * shapes, base, nullptr, "shape");
+
+    // The ShapeBatch first: the next large malloc() after the vector freed its Shapes would pay for merging their blocks.
+    std::cout << "Erase 1 in 10 shapes" << std::endl;
+    auto tenth = [](int id) { return id % 10 == 0; };
+    double batchSecs = measure("    ShapeBatch               ", [&]() { return double(batch.eraseIf(tenth)); }, shapes, 0, nullptr, "shape");
+    double sceneSecs = measure("    vector<unique_ptr<Shape>>", [&]() {
+        std::size_t n = scene.size();
+        scene.erase(std::remove_if(scene.begin(), scene.end(),
+                                   [&tenth](const std::unique_ptr<Shape>& s) { return tenth(s->id()); }), scene.end());
+        return double(n - scene.size());
+    }, shapes, 0, nullptr, "shape");
+    std::cout << "    ShapeBatch speedup " << sceneSecs / batchSecs << std::endl;
+    std::cout << "Left: " << scene.size() << " and " << batch.size() << " shapes" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,346 @@
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <cstddef>
+
+#include "sampleUtil.h"
+
+/*********
+A program to show a member kept inside its owner(an optional-like value), instead of a pointer to the heap.
+
+Square of 11_uniquePtr.cpp holds its Colour through a pointer: _col(new Colour()). Each Square is two allocations,
+each access to its Colour goes through the pointer, and with a raw pointer the Colour is never deleted(Square has no
+destructor). A unique_ptr<Colour>(UNIQUE_PTR) fixes the leak, not the allocation.
+
+Inline<T> keeps the room of a T inside the object that holds it, and may be empty:
+
+    Inline<T>(inPlace, args...)     builds the T in place from args.
+    emplace(args...)                destroys the T held, if any, then builds a new one in place. When the constructor
+                                    throws, the Inline is left empty: there is nothing to destroy.
+    reset()                         destroys the T held, if any.
+    has_value(), operator bool      whether a T is held.
+    operator*, operator->, get()    the T held(get() returns nullptr when empty).
+
+The destructor of Inline<T> destroys the T held. A member is destroyed when the constructor of its owner throws after
+building it, so a Square whose constructor throws destroys its Colour: nothing to catch or delete by hand.
+Copies and moves copy or move the T held, the moves are noexcept when those of T are.
+
+The Colours alive and their allocations(Colour has its own operator new) are counted for Square(-1) and for a
+Colour whose constructor throws, with a raw pointer, a unique_ptr and an Inline. Then the creation of Squares and
+the reading of their Colours are timed.
+*********/
+
+struct InPlace {};
+const InPlace inPlace = {};
+
+template<class T>
+class Inline
+{
+public:
+    Inline():_full(false) {}
+
+    template<class... Args>
+    explicit Inline(InPlace, Args&&... args):_full(false) { emplace(std::forward<Args>(args)...); }
+
+    Inline(const Inline& other):_full(false)
+    {
+        if(other._full)
+            emplace(*other);
+    }
+
+    // noexcept when the move of T is, as std::optional: a vector<Square> moves its Squares when it grows, instead of
+    // copying them(std::move_if_noexcept).
+    Inline(Inline&& other) noexcept(std::is_nothrow_move_constructible<T>::value):_full(false)
+    {
+        if(other._full)
+            emplace(std::move(*other));
+    }
+
+    ~Inline() { reset(); }
+
+    Inline& operator=(const Inline& other)
+    {
+        if(this != &other)
+        {
+            if(other._full && _full)
+                **this = *other;
+            else if(other._full)
+                emplace(*other);
+            else
+                reset();
+        }
+        return *this;
+    }
+
+    Inline& operator=(Inline&& other)
+        noexcept(std::is_nothrow_move_constructible<T>::value && std::is_nothrow_move_assignable<T>::value)
+    {
+        if(this != &other)
+        {
+            if(other._full && _full)
+                **this = std::move(*other);
+            else if(other._full)
+                emplace(std::move(*other));
+            else
+                reset();
+        }
+        return *this;
+    }
+
+    template<class... Args>
+    T& emplace(Args&&... args)
+    {
+        reset();
+        ::new(static_cast<void*>(&_storage)) T(std::forward<Args>(args)...);     // Empty when it throws
+        _full = true;
+        return **this;
+    }
+
+    void reset()
+    {
+        if(_full)
+        {
+            _full = false;
+            (**this).~T();
+        }
+    }
+
+    bool has_value() const { return _full; }
+    explicit operator bool() const { return _full; }
+
+    T& operator*() { return *reinterpret_cast<T*>(&_storage); }
+    const T& operator*() const { return *reinterpret_cast<const T*>(&_storage); }
+    T* operator->() { return &**this; }
+    const T* operator->() const { return &**this; }
+
+    T* get() { return _full ? &**this : nullptr; }
+    const T* get() const { return _full ? &**this : nullptr; }
+
+private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type _storage;
+    bool _full;
+};
+
+class Colour
+{
+public:
+    static bool verbose;    // Off for the benchmarks
+    static bool throwNext;  // The next constructor throws
+    static long live;       // Built and not destroyed yet
+    static long allocated;  // By new Colour, and not deleted yet
+    static unsigned long allocations;
+
+    static void* operator new(std::size_t size)
+    {
+        ++allocated;
+        ++allocations;
+        return ::operator new(size);
+    }
+
+    static void operator delete(void* p)
+    {
+        --allocated;
+        ::operator delete(p);
+    }
+
+    Colour(unsigned rgb = 0x808080):_rgb(rgb)
+    {
+        if(throwNext)
+        {
+            throwNext = false;
+            throw std::runtime_error("Colour cannot be built");
+        }
+        ++live;
+        if(verbose) std::cout << "Colour constructor ..." << std::endl;
+    }
+    Colour(const Colour& other):_rgb(other._rgb) { ++live; }
+    Colour(Colour&& other) noexcept:_rgb(other._rgb) { ++live; }
+    ~Colour()
+    {
+        --live;
+        if(verbose) std::cout << "Colour destructor ..." << std::endl;
+    }
+
+    unsigned rgb() const { return _rgb; }
+private:
+    unsigned _rgb;
+};
+
+bool Colour::verbose = true;
+bool Colour::throwNext = false;
+long Colour::live = 0;
+long Colour::allocated = 0;
+unsigned long Colour::allocations = 0;
+
+// Square of 11_uniquePtr.cpp, except that a negative length is not caught: the constructor throws.
+class RawSquare
+{
+public:
+    RawSquare(int l):_len(l), _col(new Colour())
+    {
+        if(_len < 0)
+            throw std::invalid_argument("Length cant be less than 0");
+    }
+    unsigned rgb() const { return _col->rgb(); }
+protected:
+    double _len;
+    Colour* _col;           // Never deleted, as in 11_uniquePtr.cpp
+};
+
+class UniqueSquare
+{
+public:
+    UniqueSquare(int l, unsigned rgb = 0x808080):_len(l), _col(new Colour(rgb))
+    {
+        if(_len < 0)
+            throw std::invalid_argument("Length cant be less than 0");
+    }
+    unsigned rgb() const { return _col->rgb(); }
+protected:
+    double _len;
+    std::unique_ptr<Colour> _col;
+};
+
+class Square
+{
+public:
+    Square(int l, unsigned rgb = 0x808080):_len(l), _col(inPlace, rgb)
+    {
+        if(_len < 0)
+            throw std::invalid_argument("Length cant be less than 0");
+    }
+    unsigned rgb() const { return _col->rgb(); }
+protected:
+    double _len;
+    Inline<Colour> _col;
+};
+
+static_assert(std::is_nothrow_move_constructible<Square>::value, "Square: a growing vector would copy its Colours");
+
+// Builds a Square of length l, catching its exception; prints the Colours and the allocations left behind.
+template<class S>
+void check(const char* name, int l)
+{
+    long live = Colour::live;
+    long allocated = Colour::allocated;
+    unsigned long allocations = Colour::allocations;
+    try
+    {
+        S s(l);
+        std::cout << "rgb " << std::hex << s.rgb() << std::dec << std::endl;
+    }
+    catch(const std::exception& e)
+    {
+        std::cout << "Caught: " << e.what() << std::endl;
+    }
+    std::cout << name << "(" << l << "): " << Colour::allocations - allocations << " allocation(s), "
+              << Colour::live - live << " Colour(s) alive and " << Colour::allocated - allocated << " allocation(s) leaked" << std::endl;
+}
+
+// For measure(): the allocations of Colours
+unsigned long colourAllocations() { return Colour::allocations; }
+
+int main()
+{
+    std::cout << "----------------- Square(-1) ----------------" << std::endl;
+    check<RawSquare>("RawSquare   ", -1);
+    check<UniqueSquare>("UniqueSquare", -1);
+    check<Square>("Square      ", -1);
+
+    std::cout << "----------------- Square(1) ----------------" << std::endl;
+    check<RawSquare>("RawSquare   ", 1);
+    check<UniqueSquare>("UniqueSquare", 1);
+    check<Square>("Square      ", 1);
+
+    std::cout << "----------------- The Colour constructor throws ----------------" << std::endl;
+    Colour::throwNext = true;
+    check<UniqueSquare>("UniqueSquare", 1);
+    Colour::throwNext = true;
+    check<Square>("Square      ", 1);
+
+    std::cout << "----------------- Inline<Colour> ----------------" << std::endl;
+    {
+        long live = Colour::live;
+        Inline<Colour> col;
+        std::cout << "Empty: has_value() " << std::boolalpha << col.has_value() << ", get() " << col.get() << std::endl;
+        col.emplace(0xff0000);
+        Inline<Colour> copy = col;
+        Colour::throwNext = true;
+        try
+        {
+            col.emplace(0x00ff00);
+        }
+        catch(const std::exception& e)
+        {
+            std::cout << "Caught: " << e.what() << ", has_value() " << col.has_value() << std::endl;
+        }
+        std::cout << "copy: rgb " << std::hex << copy->rgb() << std::dec << ", Colours alive " << Colour::live - live << std::endl;
+    }
+    std::cout << "sizeof: UniqueSquare " << sizeof(UniqueSquare) << " + " << sizeof(Colour) << " on the heap, Square "
+              << sizeof(Square) << std::endl;
+
+    Colour::verbose = false;
+    const int squares = 1 << 22;
+    std::cout << "----------------- " << squares << " Squares, made and destroyed ----------------" << std::endl;
+    double base = measure("vector<UniqueSquare>", [&]() {
+        std::vector<UniqueSquare> v;
+        v.reserve(squares);
+        for(int i = 0; i < squares; ++i)
+            v.emplace_back(i, unsigned(i));
+        return (unsigned long)v.back().rgb();
+    }, squares, 0, colourAllocations);
+    measure("vector<Square>      ", [&]() {
+        std::vector<Square> v;
+        v.reserve(squares);
+        for(int i = 0; i < squares; ++i)
+            v.emplace_back(i, unsigned(i));
+        return (unsigned long)v.back().rgb();
+    }, squares, base, colourAllocations);
+
+    std::cout << "----------------- " << squares << " Squares, made and destroyed, without reserve() ----------------" << std::endl;
+    base = measure("vector<UniqueSquare>", [&]() {
+        std::vector<UniqueSquare> v;
+        for(int i = 0; i < squares; ++i)
+            v.emplace_back(i, unsigned(i));
+        return (unsigned long)v.back().rgb();
+    }, squares, 0, colourAllocations);
+    measure("vector<Square>      ", [&]() {
+        std::vector<Square> v;
+        for(int i = 0; i < squares; ++i)
+            v.emplace_back(i, unsigned(i));
+        return (unsigned long)v.back().rgb();
+    }, squares, base, colourAllocations);
+
+    std::cout << "----------------- Read the Colour of " << squares << " Squares, 16 times ----------------" << std::endl;
+    std::vector<UniqueSquare> uniques;
+    std::vector<Square> inlines;
+    uniques.reserve(squares);
+    inlines.reserve(squares);
+    for(int i = 0; i < squares; ++i)
+    {
+        uniques.emplace_back(i, unsigned(i));
+        inlines.emplace_back(i, unsigned(i));
+    }
+    base = measure("vector<UniqueSquare>", [&]() {
+        unsigned long sum = 0;
+        for(int t = 0; t < 16; ++t)
+            for(const UniqueSquare& s : uniques)
+                sum += s.rgb();
+        return sum;
+    }, 16 * std::size_t(squares), 0, colourAllocations);
+    measure("vector<Square>      ", [&]() {
+        unsigned long sum = 0;
+        for(int t = 0; t < 16; ++t)
+            for(const Square& s : inlines)
+                sum += s.rgb();
+        return sum;
+    }, 16 * std::size_t(squares), base, colourAllocations);
+
+    return 0;
+}
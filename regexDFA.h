@@ -0,0 +1,3018 @@
+#ifndef REGEX_DFA_H
+#define REGEX_DFA_H
+
+#include <regex>
+#include <string>
+#include <vector>
+#include <bitset>
+#include <map>
+#include <set>
+#include <memory>
+#include <iterator>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <chrono>
+#include <unordered_map>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/*********
+regexDFA.h: A regular expression engine based on finite automata, usable in place of std::regex.
+
+std::regex (libstdc++) matches a pattern by backtracking: every start offset and every alternative is tried
+one after the other, so the time taken grows very quickly with the length of the input.
+
+A pattern without back-references (\1, \2 ...) describes a regular language, and can be matched by a
+Deterministic Finite Automaton(DFA), that looks at each character of the input only once.
+
+FastRegex compiles such a pattern into:
+
+    RegexProgram    A Thompson NFA (a small instruction program) built from the parsed pattern.
+    LazyDFA         A DFA built from the NFA on demand: a DFA state is the set of NFA states that can be active,
+                    and a transition is computed the first time it is taken, then cached in a 256 entry table.
+    Pike VM         A simulation of the NFA that tracks the sub-match positions of each NFA thread.
+
+Matching is done in two passes: the DFA finds if (and where) the pattern matches, and only then the Pike VM
+is run to find the sub-matches. Inputs that do not match never reach the Pike VM.
+
+Patterns with back-references need backtracking: their program(with Backref instructions) is run by
+RegexBacktracker, which memoizes the states that failed and can be given a budget of steps or time
+(FastRegex::setBudget()), so a pathological pattern it runs cannot stall a thread, with icase too. Anything outside
+the supported subset falls back to std::regex, so a FastRegex can be used for any pattern accepted by std::regex;
+the budget does not limit std::regex(fallback() tells these patterns, e.g. back-references with a repeated part
+that can match nothing, (a*)*\1).
+A pattern repeating a part that can match nothing, e.g. (a*)*, still uses the DFA to reject the inputs that
+do not match, but std::regex locates the match: libstdc++ handles such empty repetitions in its own way.
+
+Supported subset (ECMAScript grammar):
+    literals, .  [...]  [^...]  [[:class:]]  \d \D \w \W \s \S  \n \t \r \f \v \0 \xHH
+    ( )  (?: )  |  * + ? {n} {n,} {n,m} and their lazy (*? +? ...) forms, ^ $, back-references \1 \2 ...
+    icase: the pattern is folded once into case-insensitive classes("a" becomes [aA]), so the automata compare
+    bytes as for any other pattern, where std::regex translates each character through the locale. A
+    back-reference compares its characters through the same translation.
+
+The entry points mirror the ones of <regex>:
+
+    std::regex_match(str, sm, r)            fast_regex_match(str, fm, fr)
+    std::regex_search(str, sm, r)           fast_regex_search(str, fm, fr)
+    std::sregex_iterator it(b, e, r)        fast_sregex_iterator it(b, e, fr)
+    std::smatch / std::cmatch               fast_smatch / fast_cmatch
+
+Prefilter:
+Most patterns contain a literal that every match has to include, like the "://" of the URL pattern.
+FastRegex looks for that literal first (LiteralScanner compares 16/32 characters at once with SSE2/AVX2),
+and runs the automaton only in a window around each place the literal is found. The window extends from the
+literal over the characters the parts of the pattern before/after it can match, so the result is the same.
+
+UTF-8:
+With the FastRegex::utf8 flag, the pattern and the text are UTF-8. A character of several bytes is one character
+for '.', [...], repetitions and icase, and the classes(\w \s [[:alpha:]] [[:upper:]] ...) include the letters and
+spaces of the common scripts(RegexUnicode). The classes are compiled into byte automata matching their UTF-8
+encodings, so the text is matched as it is, without converting it into a std::wstring for std::wregex. Positions
+are byte offsets, and invalid UTF-8 in the text is matched by nothing. There is no std::regex to fall back to:
+a valid pattern outside the supported subset(or with back-references and icase) throws RegexUtf8Unsupported,
+a std::regex_error with code error_escape.
+
+Snapshots:
+fr.snapshot() writes the compiled pattern(its programs and prefilter) into a versioned blob, checked by a checksum
+and a fingerprint of the pattern and flags. FastRegex::fromSnapshot() rebuilds the FastRegex from such a blob,
+e.g. mapped from a file, without parsing or compiling the pattern.
+
+NOTE: A FastRegex caches the DFA states it builds inside the object, so unlike std::regex the same
+FastRegex object should not be used by multiple threads at the same time. Copy it for each thread instead,
+the copies share the compiled program.
+*********/
+
+typedef std::bitset<256> ByteSet;
+
+// A node of the parsed pattern.
+struct RegexNode
+{
+    enum Kind { Empty, Bytes, Concat, Alternate, Repeat, Group, Backref, LineBegin, LineEnd };
+
+    explicit RegexNode(Kind k):kind(k), min(0), max(0), greedy(true), index(-1) {}
+
+    Kind kind;
+    ByteSet set;                                    // Bytes: the characters matched
+    std::vector<std::unique_ptr<RegexNode> > kids;  // Concat, Alternate: the parts, Repeat/Group: the one child
+    int min, max;                                   // Repeat: the count, max < 0 is unbounded
+    bool greedy;                                    // Repeat
+    int index;                                      // Group: capture index(-1 when non-capturing), Backref: group referred
+};
+
+typedef std::unique_ptr<RegexNode> RegexNodePtr;
+
+// A set of characters as sorted, disjoint ranges: of code points in UTF-8 mode, of bytes otherwise.
+class RegexCharSet
+{
+public:
+    typedef std::pair<unsigned, unsigned> Range;
+
+    RegexCharSet() {}
+
+    explicit RegexCharSet(const ByteSet& s)
+    {
+        for(unsigned c = 0; c < 256; ++c)
+            if(s[c])
+                add(c, c);
+    }
+
+    void add(unsigned lo, unsigned hi)
+    {
+        if(!_ranges.empty() && _ranges.back().second + 1 == lo)
+            _ranges.back().second = hi;     // The common case, characters added in order
+        else
+        {
+            _ranges.push_back(Range(lo, hi));
+            normalize();
+        }
+    }
+
+    void add(const RegexCharSet& other)
+    {
+        _ranges.insert(_ranges.end(), other._ranges.begin(), other._ranges.end());
+        normalize();
+    }
+
+    bool contains(unsigned c) const
+    {
+        std::vector<Range>::const_iterator it = std::upper_bound(_ranges.begin(), _ranges.end(), Range(c, ~0u));
+        return it != _ranges.begin() && (it - 1)->second >= c;
+    }
+
+    bool empty() const                          { return _ranges.empty(); }
+    const std::vector<Range>& ranges() const    { return _ranges; }
+
+    // The characters of [0, max] not in the set. Above 0xFFFF the surrogates(D800-DFFF) are left out: they
+    // are not characters, and UTF-8 cannot encode them.
+    RegexCharSet complement(unsigned max) const
+    {
+        RegexCharSet out;
+        unsigned next = 0;
+        for(std::size_t i = 0; i < _ranges.size() && next <= max; ++i)
+        {
+            if(_ranges[i].first > next)
+                out._ranges.push_back(Range(next, std::min(_ranges[i].first - 1, max)));
+            next = _ranges[i].second + 1;
+        }
+        if(next <= max)
+            out._ranges.push_back(Range(next, max));
+        if(max > 0xFFFF)
+            out.remove(0xD800, 0xDFFF);
+        return out;
+    }
+
+    // The members below 256, the whole set when the pattern is not UTF-8.
+    ByteSet bytes() const
+    {
+        ByteSet s;
+        for(std::size_t i = 0; i < _ranges.size() && _ranges[i].first < 256; ++i)
+            for(unsigned c = _ranges[i].first; c <= _ranges[i].second && c < 256; ++c)
+                s[c] = true;
+        return s;
+    }
+
+private:
+    void normalize()
+    {
+        std::sort(_ranges.begin(), _ranges.end());
+        std::size_t n = 0;
+        for(std::size_t i = 0; i < _ranges.size(); ++i)
+        {
+            if(n > 0 && _ranges[i].first <= _ranges[n - 1].second + 1)
+                _ranges[n - 1].second = std::max(_ranges[n - 1].second, _ranges[i].second);
+            else
+                _ranges[n++] = _ranges[i];
+        }
+        _ranges.resize(n);
+    }
+
+    void remove(unsigned lo, unsigned hi)
+    {
+        std::vector<Range> kept;
+        for(std::size_t i = 0; i < _ranges.size(); ++i)
+        {
+            if(_ranges[i].first < lo)
+                kept.push_back(Range(_ranges[i].first, std::min(_ranges[i].second, lo - 1)));
+            if(_ranges[i].second > hi)
+                kept.push_back(Range(std::max(_ranges[i].first, hi + 1), _ranges[i].second));
+        }
+        _ranges.swap(kept);
+    }
+
+    std::vector<Range> _ranges;
+};
+
+// What the UTF-8 mode knows of Unicode: the encoding, simple case folding, and the letters, spaces and
+// punctuation of the scripts in common use(Latin, Greek, Cyrillic, Armenian, Hebrew, Arabic, Devanagari, Thai,
+// Georgian, Hangul, kana and CJK ideographs). The classes are subsets of the ones of a glibc UTF-8 locale(what
+// std::wregex sees), not the full Unicode database: a letter of another script is matched as itself, but is not
+// in [[:alpha:]] or \w.
+struct RegexUnicode
+{
+    static const unsigned MaxCode = 0x10FFFF;
+
+    // Encodes c(not a surrogate) into out, returns the number of bytes.
+    static int encode(unsigned c, unsigned char* out)
+    {
+        if(c < 0x80)
+        {
+            out[0] = static_cast<unsigned char>(c);
+            return 1;
+        }
+        int n = c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+        static const unsigned char lead[] = { 0, 0, 0xC0, 0xE0, 0xF0 };
+        for(int i = n - 1; i > 0; --i, c >>= 6)
+            out[i] = static_cast<unsigned char>(0x80 | (c & 0x3F));
+        out[0] = static_cast<unsigned char>(lead[n] | c);
+        return n;
+    }
+
+    // Decodes the character at p and moves p after it. Returns false, p unchanged, for an invalid sequence:
+    // a stray continuation byte, a truncated or overlong sequence, a surrogate or a code point above 10FFFF.
+    static bool decode(const char*& p, const char* e, unsigned& c)
+    {
+        const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+        std::ptrdiff_t left = e - p;
+        if(left <= 0)
+            return false;
+        int n = u[0] < 0x80 ? 1 : u[0] < 0xC2 ? 0 : u[0] < 0xE0 ? 2 : u[0] < 0xF0 ? 3 : u[0] < 0xF5 ? 4 : 0;
+        if(n == 0 || left < n)
+            return false;
+        c = n == 1 ? u[0] : u[0] & (0x7F >> n);
+        for(int i = 1; i < n; ++i)
+        {
+            if((u[i] & 0xC0) != 0x80)
+                return false;
+            c = (c << 6) | (u[i] & 0x3F);
+        }
+        static const unsigned least[] = { 0, 0, 0x80, 0x800, 0x10000 };
+        if(c < least[n] || c > MaxCode || (c >= 0xD800 && c <= 0xDFFF))
+            return false;
+        p += n;
+        return true;
+    }
+
+    // The pairs (upper case, lower case) of simple case folding.
+    static const std::vector<RegexCharSet::Range>& caseFolds()
+    {
+        static const std::vector<RegexCharSet::Range> folds = buildFolds();
+        return folds;
+    }
+
+    // The set with the other case of each of its letters added, as an icase pattern matches it.
+    static RegexCharSet fold(const RegexCharSet& s)
+    {
+        const std::vector<RegexCharSet::Range>& folds = caseFolds();
+        RegexCharSet out = s;
+        for(int pass = 0; pass < 2; ++pass)     // Twice: the micro sign folds to mu, mu to the capital mu
+        {
+            RegexCharSet added;
+            for(std::size_t i = 0; i < folds.size(); ++i)
+            {
+                if(out.contains(folds[i].first))
+                    added.add(folds[i].second, folds[i].second);
+                if(out.contains(folds[i].second))
+                    added.add(folds[i].first, folds[i].first);
+            }
+            out.add(added);
+        }
+        return out;
+    }
+
+    // The characters above 127 of a named class, the ASCII ones are RegexParser::namedClass()'s.
+    static RegexCharSet namedClass(const std::string& name)
+    {
+        static const RegexCharSet::Range letters[] = {
+            {0xAA, 0xAA}, {0xB5, 0xB5}, {0xBA, 0xBA}, {0xC0, 0xD6}, {0xD8, 0xF6}, {0xF8, 0x2C1}, {0x370, 0x373},
+            {0x376, 0x377}, {0x37B, 0x37D}, {0x37F, 0x37F}, {0x386, 0x386}, {0x388, 0x38A}, {0x38C, 0x38C},
+            {0x38E, 0x3A1}, {0x3A3, 0x3F5}, {0x3F7, 0x481}, {0x48A, 0x52F}, {0x531, 0x556}, {0x561, 0x587},
+            {0x5D0, 0x5EA}, {0x620, 0x64A}, {0x671, 0x6D3}, {0x904, 0x939}, {0xE01, 0xE30}, {0x10A0, 0x10C5},
+            {0x10D0, 0x10FA}, {0x1100, 0x11FF}, {0x1E00, 0x1F15}, {0x1F18, 0x1F1D}, {0x1F20, 0x1F45},
+            {0x1F48, 0x1F4D}, {0x1F50, 0x1F57}, {0x1F59, 0x1F59}, {0x1F5B, 0x1F5B}, {0x1F5D, 0x1F5D},
+            {0x1F5F, 0x1F7D}, {0x1F80, 0x1FB4}, {0x1FB6, 0x1FBC}, {0x2D00, 0x2D25}, {0x3041, 0x3096},
+            {0x30A1, 0x30FA}, {0x3400, 0x4DBF}, {0x4E00, 0x9FFF}, {0xAC00, 0xD7A3}, {0xF900, 0xFA6D}, {0xFA70, 0xFAD9},
+            {0xFF21, 0xFF3A}, {0xFF41, 0xFF5A}, {0xFF66, 0xFF9D}, {0x20000, 0x2A6DF}
+        };
+        static const RegexCharSet::Range spaces[] = {     // The no-break spaces are not spaces for iswspace()
+            {0x1680, 0x1680}, {0x2000, 0x2006}, {0x2008, 0x200A}, {0x2028, 0x2029}, {0x205F, 0x205F}, {0x3000, 0x3000}
+        };
+        static const RegexCharSet::Range puncts[] = {
+            {0xA1, 0xA9}, {0xAB, 0xB4}, {0xB6, 0xB9}, {0xBB, 0xBF}, {0xD7, 0xD7}, {0xF7, 0xF7}, {0x2010, 0x2027},
+            {0x2030, 0x205E}, {0x20A0, 0x20C0}, {0x3001, 0x3003}, {0x3008, 0x3011}, {0xFF01, 0xFF0F}
+        };
+
+        RegexCharSet s;
+        if(name == "alpha" || name == "alnum" || name == "w")
+            for(const RegexCharSet::Range& r : letters)
+                s.add(r.first, r.second);
+        else if(name == "space" || name == "s")
+            for(const RegexCharSet::Range& r : spaces)
+                s.add(r.first, r.second);
+        else if(name == "punct")
+            for(const RegexCharSet::Range& r : puncts)
+                s.add(r.first, r.second);
+        else if(name == "upper" || name == "lower")
+        {
+            bool upper = name == "upper";
+            const std::vector<RegexCharSet::Range>& folds = caseFolds();
+            RegexCharSet cased;
+            for(std::size_t i = 0; i < folds.size(); ++i)
+            {
+                unsigned c = upper ? folds[i].first : folds[i].second;
+                if(c > 127)
+                    cased.add(c, c);
+            }
+            s.add(cased);
+            if(!upper)
+                s.add(0xDF, 0xDF);      // German sharp s, the lower case letter without an upper case one
+        }
+        else if(name == "print" || name == "graph")
+        {
+            s.add(name == "print" ? 0xA0 : 0xA1, 0xD7FF);
+            s.add(0xE000, MaxCode);
+        }
+        return s;
+    }
+
+    // The node matching the UTF-8 encoding of one of the characters of s: the set is cut into ranges whose
+    // encodings differ only by the range of each byte, e.g. 0800-FFFF into [E0][A0-BF][80-BF] and
+    // [E1-EF][80-BF][80-BF], and the sequences sharing their first bytes are merged into a tree of alternatives.
+    // The characters below 128 are a single Bytes node.
+    static RegexNodePtr utf8Node(const RegexCharSet& s)
+    {
+        std::vector<Sequence> sequences;
+        for(std::size_t i = 0; i < s.ranges().size(); ++i)
+            split(s.ranges()[i].first, s.ranges()[i].second, sequences);
+
+        RegexNodePtr ascii(new RegexNode(RegexNode::Bytes));
+        std::vector<Sequence> multi;
+        for(std::size_t i = 0; i < sequences.size(); ++i)
+        {
+            if(sequences[i].size() == 1)
+                for(unsigned c = sequences[i][0].first; c <= sequences[i][0].second; ++c)
+                    ascii->set[c] = true;
+            else
+                multi.push_back(sequences[i]);
+        }
+        if(multi.empty())
+            return ascii;
+
+        RegexNodePtr rest = tree(multi, 0, multi.size(), 0);
+        if(ascii->set.none())
+            return rest;
+        RegexNodePtr alt(new RegexNode(RegexNode::Alternate));
+        alt->kids.push_back(std::move(ascii));
+        alt->kids.push_back(std::move(rest));
+        return alt;
+    }
+
+private:
+    typedef std::vector<std::pair<unsigned char, unsigned char> > Sequence;     // A range for each byte
+
+    static void split(unsigned lo, unsigned hi, std::vector<Sequence>& out)
+    {
+        static const unsigned limits[] = { 0x7F, 0x7FF, 0xFFFF };
+        for(unsigned limit : limits)
+        {
+            if(lo <= limit && hi > limit)
+            {
+                split(lo, limit, out);
+                split(limit + 1, hi, out);
+                return;
+            }
+        }
+
+        unsigned char a[4], b[4];
+        int n = encode(lo, a);
+        encode(hi, b);
+        for(int i = 1; i < n; ++i)
+        {
+            // The bytes after the first i-1 ones can only take any range when the lower bytes span 80-BF.
+            unsigned m = (1u << (6 * i)) - 1;
+            if((lo & ~m) != (hi & ~m))
+            {
+                if((lo & m) != 0)
+                {
+                    split(lo, lo | m, out);
+                    split((lo | m) + 1, hi, out);
+                    return;
+                }
+                if((hi & m) != m)
+                {
+                    split(lo, (hi & ~m) - 1, out);
+                    split(hi & ~m, hi, out);
+                    return;
+                }
+            }
+        }
+
+        Sequence seq;
+        for(int i = 0; i < n; ++i)
+            seq.push_back(std::make_pair(a[i], b[i]));
+        out.push_back(seq);
+    }
+
+    // The alternatives of seqs[first, last), which have the same ranges for their first depth bytes.
+    static RegexNodePtr tree(const std::vector<Sequence>& seqs, std::size_t first, std::size_t last, std::size_t depth)
+    {
+        RegexNodePtr alt(new RegexNode(RegexNode::Alternate));
+        RegexNodePtr ends(new RegexNode(RegexNode::Bytes));      // The sequences whose last byte this is
+        for(std::size_t i = first; i < last; )
+        {
+            std::size_t j = i + 1;
+            while(j < last && seqs[j][depth] == seqs[i][depth])
+                ++j;
+
+            RegexNodePtr byte(new RegexNode(RegexNode::Bytes));
+            for(unsigned c = seqs[i][depth].first; c <= seqs[i][depth].second; ++c)
+                byte->set[c] = true;
+
+            if(depth + 1 == seqs[i].size())
+                ends->set |= byte->set;
+            else
+            {
+                RegexNodePtr cat(new RegexNode(RegexNode::Concat));
+                cat->kids.push_back(std::move(byte));
+                RegexNodePtr rest = tree(seqs, i, j, depth + 1);
+                if(rest->kind == RegexNode::Concat)
+                    std::move(rest->kids.begin(), rest->kids.end(), std::back_inserter(cat->kids));
+                else
+                    cat->kids.push_back(std::move(rest));
+                addMerged(*alt, std::move(cat));
+            }
+            i = j;
+        }
+        if(ends->set.any())
+            alt->kids.insert(alt->kids.begin(), std::move(ends));
+        return balance(alt->kids, 0, alt->kids.size());
+    }
+
+    // The alternatives kids[first, last) as a binary tree: the Pike VM skips the half that cannot read the next
+    // character, instead of trying the alternatives one after the other.
+    static RegexNodePtr balance(std::vector<RegexNodePtr>& kids, std::size_t first, std::size_t last)
+    {
+        if(last - first == 1)
+            return std::move(kids[first]);
+        std::size_t middle = first + (last - first) / 2;
+        RegexNodePtr alt(new RegexNode(RegexNode::Alternate));
+        alt->kids.push_back(balance(kids, first, middle));
+        alt->kids.push_back(balance(kids, middle, last));
+        return alt;
+    }
+
+    static bool same(const RegexNode& a, const RegexNode& b)
+    {
+        if(a.kind != b.kind || a.set != b.set || a.kids.size() != b.kids.size())
+            return false;
+        for(std::size_t i = 0; i < a.kids.size(); ++i)
+            if(!same(*a.kids[i], *b.kids[i]))
+                return false;
+        return true;
+    }
+
+    // Adds cat(a first byte and what follows it) to alt, or only its first bytes to an alternative followed by
+    // the same bytes: [C4-CA][80-BF] and [D0-D2][80-BF] are [C4-CA D0-D2][80-BF]. The first bytes of the
+    // alternatives are disjoint, so their order does not matter.
+    static void addMerged(RegexNode& alt, RegexNodePtr cat)
+    {
+        for(std::size_t k = 0; k < alt.kids.size(); ++k)
+        {
+            RegexNode& other = *alt.kids[k];
+            if(other.kids.size() != cat->kids.size())
+                continue;
+            bool tail = true;
+            for(std::size_t i = 1; tail && i < cat->kids.size(); ++i)
+                tail = same(*other.kids[i], *cat->kids[i]);
+            if(tail)
+            {
+                other.kids[0]->set |= cat->kids[0]->set;
+                return;
+            }
+        }
+        alt.kids.push_back(std::move(cat));
+    }
+
+    static std::vector<RegexCharSet::Range> buildFolds()
+    {
+        std::vector<RegexCharSet::Range> f;
+        struct Block { unsigned first, last, step, delta; };
+        static const Block blocks[] = {
+            {'A', 'Z', 1, 32}, {0xC0, 0xD6, 1, 32}, {0xD8, 0xDE, 1, 32},       // ASCII, Latin-1
+            {0x100, 0x12E, 2, 1}, {0x132, 0x136, 2, 1}, {0x139, 0x147, 2, 1},  // Latin Extended-A
+            {0x14A, 0x176, 2, 1}, {0x179, 0x17D, 2, 1},
+            {0x391, 0x3A1, 1, 32}, {0x3A3, 0x3AB, 1, 32}, {0x388, 0x38A, 1, 37}, // Greek
+            {0x410, 0x42F, 1, 32}, {0x400, 0x40F, 1, 80}, {0x460, 0x480, 2, 1}, // Cyrillic
+            {0x48A, 0x4BE, 2, 1}, {0x4C1, 0x4CD, 2, 1}, {0x4D0, 0x52E, 2, 1},
+            {0x531, 0x556, 1, 48},                                              // Armenian
+            {0x10A0, 0x10C5, 1, 0x1C60},                                        // Georgian
+            {0x1E00, 0x1E94, 2, 1}, {0x1EA0, 0x1EFE, 2, 1},                     // Latin Extended Additional
+            {0xFF21, 0xFF3A, 1, 32}                                             // Fullwidth
+        };
+        for(const Block& b : blocks)
+            for(unsigned c = b.first; c <= b.last; c += b.step)
+                f.push_back(RegexCharSet::Range(c, c + b.delta));
+
+        static const RegexCharSet::Range singles[] = {
+            {0x178, 0xFF}, {0x39C, 0xB5}, {0x3A3, 0x3C2}, {0x386, 0x3AC}, {0x38C, 0x3CC}, {0x38E, 0x3CD},
+            {0x38F, 0x3CE}, {0x1E9E, 0xDF}, {0x212A, 'k'}, {0x212B, 0xE5}
+        };
+        f.insert(f.end(), std::begin(singles), std::end(singles));
+        return f;
+    }
+};
+
+// The case folding of an icase pattern that is not UTF-8. std::regex translates every character it compares by
+// ctype<char>::tolower() of its locale(regex_traits::translate_nocase()); here the 256 translations are looked up
+// once, when the pattern is parsed, and each character or class of the pattern becomes the set of bytes with the
+// same translation: "a" is [aA], [a-c] is [a-cA-C]. Matching never calls the locale.
+struct RegexByteFold
+{
+    RegexByteFold()
+    {
+        std::regex_traits<char> traits;     // The global locale, as the std::regex of the pattern would use
+        for(int c = 0; c < 256; ++c)
+            lower[c] = static_cast<unsigned char>(traits.translate_nocase(static_cast<char>(c)));
+    }
+
+    ByteSet fold(const ByteSet& s) const
+    {
+        ByteSet translated, out;
+        for(int c = 0; c < 256; ++c)
+            if(s[c])
+                translated[lower[c]] = true;
+        for(int c = 0; c < 256; ++c)
+            out[c] = translated[lower[c]];
+        return out;
+    }
+
+    unsigned char lower[256];
+};
+
+// Parses the ECMAScript subset described above into a tree of RegexNode.
+// Throws RegexParser::Unsupported for anything else, including invalid patterns (std::regex reports the error then).
+//
+// In Utf8 mode the pattern and the input are UTF-8: a character of the pattern, a class or '.' is compiled into
+// the alternatives of its UTF-8 encodings(RegexUnicode::utf8Node()), the named classes and \w \s include the
+// letters and spaces of RegexUnicode, and \xHH \uXXXX are code points. Icase adds the other case of each letter
+// to every character and class: by RegexUnicode::fold() in Utf8 mode, by RegexByteFold otherwise.
+class RegexParser
+{
+public:
+    struct Unsupported {};
+
+    enum Mode { Utf8 = 1, Icase = 2 };
+
+    explicit RegexParser(const std::string& pattern, unsigned mode = 0)
+        :_p(pattern), _pos(0), _groups(0), _backrefs(false), _utf8((mode & Utf8) != 0), _icase((mode & Icase) != 0)
+    {
+        if(_icase && !_utf8)
+            _byteFold.reset(new RegexByteFold());
+    }
+
+    RegexNodePtr parse()
+    {
+        RegexNodePtr n = parseAlternate();
+        if(_pos != _p.size())
+            throw Unsupported();
+        return n;
+    }
+
+    int groups() const          { return _groups; }
+    bool hasBackrefs() const    { return _backrefs; }
+
+    static ByteSet namedClass(const std::string& name)
+    {
+        ByteSet s;
+        for(int c = 0; c < 128; ++c)    // Classes of the "C" locale, bytes above 127 belong to none of them.
+        {
+            bool digit = c >= '0' && c <= '9';
+            bool upper = c >= 'A' && c <= 'Z';
+            bool lower = c >= 'a' && c <= 'z';
+            bool space = c == ' ' || (c >= '\t' && c <= '\r');
+            bool print = c >= 0x20 && c < 0x7f;
+            bool alnum = digit || upper || lower;
+            bool punct = print && !alnum && c != ' ';
+            bool xdigit = digit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+
+            bool in = false;
+            if(name == "alnum")                         in = alnum;
+            else if(name == "alpha")                    in = upper || lower;
+            else if(name == "blank")                    in = c == ' ' || c == '\t';
+            else if(name == "cntrl")                    in = c < 0x20 || c == 0x7f;
+            else if(name == "digit" || name == "d")     in = digit;
+            else if(name == "graph")                    in = print && c != ' ';
+            else if(name == "lower")                    in = lower;
+            else if(name == "print")                    in = print;
+            else if(name == "punct")                    in = punct;
+            else if(name == "space" || name == "s")     in = space;
+            else if(name == "upper")                    in = upper;
+            else if(name == "xdigit")                   in = xdigit;
+            else if(name == "w")                        in = alnum || c == '_';
+            else throw Unsupported();
+
+            s[c] = in;
+        }
+        return s;
+    }
+
+private:
+    bool more() const           { return _pos < _p.size(); }
+    char peek() const           { return _p[_pos]; }
+    unsigned maxChar() const    { return _utf8 ? RegexUnicode::MaxCode : 0xFF; }
+
+    static RegexNodePtr bytes(const ByteSet& s)
+    {
+        RegexNodePtr n(new RegexNode(RegexNode::Bytes));
+        n->set = s;
+        return n;
+    }
+
+    RegexNodePtr node(const RegexCharSet& s) const
+    {
+        return _utf8 ? RegexUnicode::utf8Node(s) : bytes(s.bytes());
+    }
+
+    RegexNodePtr single(unsigned c) const
+    {
+        RegexCharSet s;
+        s.add(c, c);
+        return node(_icase ? fold(s) : s);
+    }
+
+    RegexCharSet fold(const RegexCharSet& s) const
+    {
+        return _utf8 ? RegexUnicode::fold(s) : RegexCharSet(_byteFold->fold(s.bytes()));
+    }
+
+    RegexCharSet charClass(const std::string& name) const
+    {
+        RegexCharSet s(namedClass(name));
+        if(_utf8)
+            s.add(RegexUnicode::namedClass(name));
+        return s;
+    }
+
+    // The character at _pos, a code point in Utf8 mode.
+    unsigned nextChar()
+    {
+        if(!_utf8)
+            return static_cast<unsigned char>(_p[_pos++]);
+        const char* p = _p.data() + _pos;
+        unsigned c = 0;
+        if(!RegexUnicode::decode(p, _p.data() + _p.size(), c))
+            throw Unsupported();
+        _pos = p - _p.data();
+        return c;
+    }
+
+    RegexNodePtr parseAlternate()
+    {
+        RegexNodePtr first = parseConcat();
+        if(!more() || peek() != '|')
+            return first;
+
+        RegexNodePtr alt(new RegexNode(RegexNode::Alternate));
+        alt->kids.push_back(std::move(first));
+        while(more() && peek() == '|')
+        {
+            ++_pos;
+            alt->kids.push_back(parseConcat());
+        }
+        return alt;
+    }
+
+    RegexNodePtr parseConcat()
+    {
+        RegexNodePtr cat(new RegexNode(RegexNode::Concat));
+        while(more() && peek() != '|' && peek() != ')')
+        {
+            RegexNodePtr n = parseRepeat(parseAtom());
+            if(n->kind == RegexNode::Concat)    // The bytes of a UTF-8 character: a literal for the prefilter
+                std::move(n->kids.begin(), n->kids.end(), std::back_inserter(cat->kids));
+            else
+                cat->kids.push_back(std::move(n));
+        }
+
+        if(cat->kids.size() == 1)
+            return std::move(cat->kids[0]);
+        if(cat->kids.empty())
+            return RegexNodePtr(new RegexNode(RegexNode::Empty));
+        return cat;
+    }
+
+    int parseNumber()
+    {
+        if(!more() || peek() < '0' || peek() > '9')
+            throw Unsupported();
+        int n = 0;
+        while(more() && peek() >= '0' && peek() <= '9')
+        {
+            n = n * 10 + (_p[_pos++] - '0');
+            if(n > 1000)            // Larger counts would expand into a huge program.
+                throw Unsupported();
+        }
+        return n;
+    }
+
+    RegexNodePtr parseRepeat(RegexNodePtr atom)
+    {
+        if(!more())
+            return atom;
+
+        int min = 0, max = -1;
+        switch(peek())
+        {
+        case '*': min = 0; max = -1; break;
+        case '+': min = 1; max = -1; break;
+        case '?': min = 0; max = 1; break;
+        case '{':
+            ++_pos;
+            min = max = parseNumber();
+            if(more() && peek() == ',')
+            {
+                ++_pos;
+                max = (more() && peek() == '}') ? -1 : parseNumber();
+            }
+            if(!more() || peek() != '}' || (max >= 0 && max < min))
+                throw Unsupported();
+            break;
+        default:
+            return atom;
+        }
+        ++_pos;
+
+        if(atom->kind == RegexNode::LineBegin || atom->kind == RegexNode::LineEnd)
+            throw Unsupported();
+
+        RegexNodePtr rep(new RegexNode(RegexNode::Repeat));
+        rep->min = min;
+        rep->max = max;
+        if(more() && peek() == '?')
+        {
+            rep->greedy = false;
+            ++_pos;
+        }
+        rep->kids.push_back(std::move(atom));
+
+        if(more() && (peek() == '*' || peek() == '+' || peek() == '?' || peek() == '{'))
+            throw Unsupported();    // "a**" is an error in ECMAScript
+        return rep;
+    }
+
+    RegexNodePtr parseAtom()
+    {
+        char c = _p[_pos++];
+        switch(c)
+        {
+        case '(':
+        {
+            RegexNodePtr g(new RegexNode(RegexNode::Group));
+            if(more() && peek() == '?')
+            {
+                if(_pos + 1 >= _p.size() || _p[_pos + 1] != ':')
+                    throw Unsupported();    // Look-ahead assertions
+                _pos += 2;
+            }
+            else
+                g->index = ++_groups;
+
+            g->kids.push_back(parseAlternate());
+            if(!more() || peek() != ')')
+                throw Unsupported();
+            ++_pos;
+            if(g->index > 0)
+                _closed.insert(g->index);
+            return g;
+        }
+        case '[':
+            return node(parseClass());
+        case '.':
+        {
+            RegexCharSet lines;
+            lines.add('\n', '\n');
+            lines.add('\r', '\r');
+            return node(lines.complement(maxChar()));
+        }
+        case '^':
+            return RegexNodePtr(new RegexNode(RegexNode::LineBegin));
+        case '$':
+            return RegexNodePtr(new RegexNode(RegexNode::LineEnd));
+        case '\\':
+        {
+            if(more() && peek() >= '1' && peek() <= '9')
+            {
+                RegexNodePtr b(new RegexNode(RegexNode::Backref));
+                b->index = parseNumber();
+                if(!_closed.count(b->index))
+                    throw Unsupported();    // A group still open or not opened yet: std::regex reports error_backref
+                _backrefs = true;
+                return b;
+            }
+            RegexCharSet s;
+            unsigned ch = 0;
+            return parseEscape(s, ch) ? single(ch) : node(s);
+        }
+        case '*': case '+': case '?': case '{': case '}': case ']': case ')':
+            throw Unsupported();
+        default:
+            --_pos;
+            return single(nextChar());
+        }
+    }
+
+    unsigned parseHex(int digits)
+    {
+        unsigned v = 0;
+        for(int i = 0; i < digits; ++i)
+        {
+            if(!more() || !namedClass("xdigit")[static_cast<unsigned char>(peek())])
+                throw Unsupported();
+            char h = _p[_pos++];
+            v = v * 16 + (h <= '9' ? h - '0' : (h | 0x20) - 'a' + 10);
+        }
+        return v;
+    }
+
+    // Parses the escape sequence following a '\'. Returns true for a single character(left in ch),
+    // false for a class(left in s).
+    bool parseEscape(RegexCharSet& s, unsigned& ch)
+    {
+        if(!more())
+            throw Unsupported();
+
+        char c = _p[_pos++];
+        switch(c)
+        {
+        case 'd': case 'w': case 's':
+            s = charClass(std::string(1, c));
+            return false;
+        case 'D': case 'W': case 'S':
+            s = charClass(std::string(1, static_cast<char>(c | 0x20))).complement(maxChar());
+            return false;
+        case 'n': ch = '\n'; break;
+        case 't': ch = '\t'; break;
+        case 'r': ch = '\r'; break;
+        case 'f': ch = '\f'; break;
+        case 'v': ch = '\v'; break;
+        case '0': ch = '\0'; break;
+        case 'x': ch = parseHex(2); break;
+        case 'u':
+            if(!_utf8)
+                throw Unsupported();
+            ch = parseHex(4);
+            if(ch >= 0xD800 && ch <= 0xDFFF)
+                throw Unsupported();    // Surrogate pairs of UTF-16
+            break;
+        default:
+            if(namedClass("alnum")[static_cast<unsigned char>(c)])
+                throw Unsupported();    // \b, \B, \cX ...
+            --_pos;
+            ch = nextChar();
+            break;
+        }
+        return true;
+    }
+
+    // One element inside [...]. Returns true for a single character(left in ch, it can start a range),
+    // false for a class(left in s).
+    bool parseClassItem(RegexCharSet& s, unsigned& ch)
+    {
+        if(!more())
+            throw Unsupported();
+
+        if(peek() == '[' && _pos + 1 < _p.size() && _p[_pos + 1] == ':')
+        {
+            std::string::size_type end = _p.find(":]", _pos + 2);
+            if(end == std::string::npos)
+                throw Unsupported();
+            s = charClass(_p.substr(_pos + 2, end - _pos - 2));
+            _pos = end + 2;
+            return false;
+        }
+        if(peek() == '[')
+            throw Unsupported();    // [. .] and [= =]
+
+        if(peek() == '\\')
+        {
+            ++_pos;
+            return parseEscape(s, ch);
+        }
+
+        ch = nextChar();
+        return true;
+    }
+
+    RegexCharSet parseClass()
+    {
+        RegexCharSet result;
+        bool negate = false;
+        if(more() && peek() == '^')
+        {
+            negate = true;
+            ++_pos;
+        }
+        if(more() && peek() == ']')
+            throw Unsupported();
+
+        while(more() && peek() != ']')
+        {
+            RegexCharSet item;
+            unsigned lo = 0;
+            bool single = parseClassItem(item, lo);
+
+            if(single && _pos + 1 < _p.size() && peek() == '-' && _p[_pos + 1] != ']')
+            {
+                ++_pos;
+                unsigned hi = 0;
+                if(!parseClassItem(item, hi) || hi < lo)
+                    throw Unsupported();
+                result.add(lo, hi);
+            }
+            else if(single)
+                result.add(lo, lo);
+            else
+                result.add(item);
+        }
+        if(!more())
+            throw Unsupported();
+        ++_pos;     // ']'
+
+        if(_icase)
+            result = fold(result);
+        return negate ? result.complement(maxChar()) : result;
+    }
+
+    std::string _p;
+    std::string::size_type _pos;
+    int _groups;
+    std::set<int> _closed;          // The groups whose ')' has been read, the only ones a back-reference may name
+    bool _backrefs;
+    bool _utf8;
+    bool _icase;
+    std::unique_ptr<RegexByteFold> _byteFold;
+};
+
+// The binary form of a compiled pattern, written by FastRegex::snapshot():
+//
+//   header     magic "FRXSNAP\0"(8 bytes), version(u32), syntax flags(u32), fingerprint(u64),
+//              payload size(u64), checksum(u64)
+//   payload    the pattern, the number of groups, which parts are present, then the programs and the prefilter
+//
+// Integers are in the byte order of the machine that wrote them(a machine of the other order sees a wrong
+// version), a ByteSet is 4 u64 of 64 characters each. The fingerprint is the FNV-1a hash of the pattern and
+// its flags, the checksum the FNV-1a hash of the payload.
+struct RegexSnapshot
+{
+    static const std::uint32_t Version = 2;
+    static const std::size_t HeaderSize = 40;
+
+    // FNV-1a taken 8 bytes at a time(then byte by byte for the tail): one multiplication per 8 bytes.
+    static std::uint64_t fnv1a(const char* p, std::size_t n, std::uint64_t h = 14695981039346656037ULL)
+    {
+        std::size_t i = 0;
+        for(; i + 8 <= n; i += 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, p + i, sizeof word);
+            h = (h ^ word) * 1099511628211ULL;
+        }
+        for(; i < n; ++i)
+            h = (h ^ static_cast<unsigned char>(p[i])) * 1099511628211ULL;
+        return h;
+    }
+
+    static std::uint64_t fingerprint(const std::string& pattern, std::uint32_t flags)
+    {
+        std::uint64_t h = fnv1a(pattern.data(), pattern.size());
+        return fnv1a(reinterpret_cast<const char*>(&flags), sizeof flags, h);
+    }
+
+    class Writer
+    {
+    public:
+        explicit Writer(std::string& out):_out(out) {}
+
+        void raw(const std::string& s)  { _out += s; }
+        void u8(unsigned v)             { _out += static_cast<char>(v); }
+        void u32(std::uint32_t v)       { _out.append(reinterpret_cast<const char*>(&v), sizeof v); }
+        void u64(std::uint64_t v)       { _out.append(reinterpret_cast<const char*>(&v), sizeof v); }
+        void bytes(const std::string& s)
+        {
+            u32(static_cast<std::uint32_t>(s.size()));
+            _out += s;
+        }
+        void set(const ByteSet& s)
+        {
+            const ByteSet low(~0ULL);
+            for(int i = 0; i < 4; ++i)
+                u64(((s >> (64 * i)) & low).to_ullong());
+        }
+
+    private:
+        std::string& _out;
+    };
+
+    // Reads what a Writer wrote. Nothing is read past the end: a read beyond it returns 0 and sets failed().
+    class Reader
+    {
+    public:
+        Reader(const char* p, const char* e):_p(p), _e(e), _failed(false) {}
+
+        bool failed() const             { return _failed; }
+        std::size_t left() const        { return _e - _p; }
+        const char* pos() const         { return _p; }
+
+        const char* raw(std::size_t n)
+        {
+            if(_failed || left() < n)
+            {
+                _failed = true;
+                return nullptr;
+            }
+            const char* p = _p;
+            _p += n;
+            return p;
+        }
+
+        unsigned u8()
+        {
+            const char* p = raw(1);
+            return p ? static_cast<unsigned char>(*p) : 0;
+        }
+        std::uint32_t u32()             { return fixed<std::uint32_t>(); }
+        std::uint64_t u64()             { return fixed<std::uint64_t>(); }
+        std::string bytes()
+        {
+            std::uint32_t n = u32();
+            const char* p = raw(n);
+            return p ? std::string(p, n) : std::string();
+        }
+        ByteSet set()
+        {
+            std::uint64_t words[4];
+            for(int i = 0; i < 4; ++i)
+                words[i] = u64();
+            ByteSet s;
+            for(int i = 3; i >= 0; --i)
+                s = (s << 64) | ByteSet(words[i]);
+            return s;
+        }
+
+    private:
+        template<class T>
+        T fixed()
+        {
+            T v = 0;
+            if(const char* p = raw(sizeof v))
+                std::memcpy(&v, p, sizeof v);
+            return v;
+        }
+
+        const char* _p;
+        const char* _e;
+        bool _failed;
+    };
+
+    // The header and the payload.
+    static std::string seal(const std::string& payload, const std::string& pattern, std::uint32_t flags)
+    {
+        std::string blob("FRXSNAP", 8);
+        blob.reserve(HeaderSize + payload.size());
+        Writer w(blob);
+        w.u32(Version);
+        w.u32(flags);
+        w.u64(fingerprint(pattern, flags));
+        w.u64(payload.size());
+        w.u64(fnv1a(payload.data(), payload.size()));
+        blob += payload;
+        return blob;
+    }
+
+    // Checks the header of a blob against the pattern and flags expected, and the checksum of the payload.
+    // r is left at the beginning of the payload.
+    static bool open(Reader& r, const std::string& pattern, std::uint32_t flags)
+    {
+        const char* magic = r.raw(8);
+        if(!magic || std::memcmp(magic, "FRXSNAP", 8) != 0)
+            return false;
+        if(r.u32() != Version || r.u32() != flags || r.u64() != fingerprint(pattern, flags))
+            return false;
+        std::uint64_t size = r.u64();
+        std::uint64_t checksum = r.u64();
+        return !r.failed() && size == r.left() && fnv1a(r.pos(), r.left()) == checksum;
+    }
+};
+
+// One instruction of the Thompson NFA.
+struct RegexInst
+{
+    enum Op { Byte, Split, Jump, Save, AssertBegin, AssertEnd, Backref, Match };
+
+    Op op;
+    int x;      // Split/Jump: target (Split prefers x), Save: capture slot, Byte: index of the ByteSet,
+                // Backref: the group referred, Match: the pattern matched(of the ones given to compileSet)
+    int y;      // Split: the second target
+};
+
+struct RegexProgram
+{
+    std::vector<RegexInst> insts;
+    std::vector<ByteSet> sets;
+    int slots;          // 2 * (number of groups + 1), the begin/end offset of every sub-match
+    ByteSet firstBytes; // The characters a match can begin with
+    bool nullable;      // The pattern can match an empty sequence
+
+    static const std::size_t MaxInsts = 20000;
+
+    // Builds the program for a tree. Only RegexBacktracker runs a program with back-references.
+    static std::shared_ptr<RegexProgram> compile(const RegexNode& root, int groups)
+    {
+        std::shared_ptr<RegexProgram> prog(new RegexProgram());
+        prog->slots = 2 * (groups + 1);
+
+        prog->emit(RegexInst::Save, 0);
+        prog->emitNode(root);
+        prog->emit(RegexInst::Save, 1);
+        prog->emit(RegexInst::Match);
+
+        prog->computeFirstBytes();
+        return prog;
+    }
+
+    // Builds one program matching any of the trees, the Match instruction of the tree i having x = i.
+    // The program has no sub-matches, it is meant for the DFA only(see LazyDFA::matchingPatterns()).
+    static std::shared_ptr<RegexProgram> compileSet(const std::vector<const RegexNode*>& roots)
+    {
+        std::shared_ptr<RegexProgram> prog(new RegexProgram());
+        prog->slots = 0;
+
+        for(std::size_t i = 0; i < roots.size(); ++i)
+        {
+            int split = (i + 1 < roots.size()) ? prog->emit(RegexInst::Split, prog->next() + 1) : -1;
+            prog->emitNode(*roots[i]);
+            prog->emit(RegexInst::Match, static_cast<int>(i));
+            if(split >= 0)
+                prog->insts[split].y = prog->next();
+        }
+        if(roots.empty())
+            prog->emit(RegexInst::Jump, 0);     // Never reaches a Match
+
+        prog->computeFirstBytes();
+        return prog;
+    }
+
+    // Equal sets(the 40 copies of [^;] in [^;]{1,40} ...) are written once, the Byte instructions are renumbered.
+    void write(RegexSnapshot::Writer& w) const
+    {
+        std::map<std::string, int> index;      // The bytes of a set, its number in the snapshot
+        std::vector<int> renumber(sets.size());
+        std::string unique;
+        for(std::size_t i = 0; i < sets.size(); ++i)
+        {
+            std::string key;
+            RegexSnapshot::Writer k(key);
+            k.set(sets[i]);
+            std::pair<std::map<std::string, int>::iterator, bool> it = index.insert(std::make_pair(key, static_cast<int>(index.size())));
+            if(it.second)
+                unique += key;
+            renumber[i] = it.first->second;
+        }
+
+        w.u32(static_cast<std::uint32_t>(slots));
+        w.u8(nullable);
+        w.set(firstBytes);
+        w.u32(static_cast<std::uint32_t>(insts.size()));
+        for(std::size_t i = 0; i < insts.size(); ++i)
+        {
+            w.u8(insts[i].op);
+            w.u32(static_cast<std::uint32_t>(insts[i].op == RegexInst::Byte ? renumber[insts[i].x] : insts[i].x));
+            w.u32(static_cast<std::uint32_t>(insts[i].y));
+        }
+        w.u32(static_cast<std::uint32_t>(index.size()));
+        w.raw(unique);
+    }
+
+    // Reads a program written by write(), nullptr if it is not a valid one(a target or a set out of range ...).
+    static std::shared_ptr<RegexProgram> read(RegexSnapshot::Reader& r)
+    {
+        std::shared_ptr<RegexProgram> none;
+        std::shared_ptr<RegexProgram> prog(new RegexProgram());
+        prog->slots = static_cast<int>(r.u32());
+        prog->nullable = r.u8() != 0;
+        prog->firstBytes = r.set();
+
+        std::size_t count = r.u32();
+        if(r.failed() || count == 0 || count > MaxInsts || prog->slots < 0 || prog->slots % 2 || prog->slots > 2 * static_cast<int>(MaxInsts))
+            return none;
+        prog->insts.resize(count);
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            RegexInst& in = prog->insts[i];
+            unsigned op = r.u8();
+            if(op > RegexInst::Match)
+                return none;
+            in.op = static_cast<RegexInst::Op>(op);
+            in.x = static_cast<int>(r.u32());
+            in.y = static_cast<int>(r.u32());
+        }
+        std::size_t sets = r.u32();
+        if(r.failed() || sets > count)
+            return none;
+        prog->sets.resize(sets);
+        for(std::size_t i = 0; i < sets; ++i)
+            prog->sets[i] = r.set();
+
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            const RegexInst& in = prog->insts[i];
+            bool ok = true;
+            switch(in.op)
+            {
+            case RegexInst::Byte:       ok = below(in.x, sets) && i + 1 < count; break;
+            case RegexInst::Split:      ok = below(in.x, count) && below(in.y, count); break;
+            case RegexInst::Jump:       ok = below(in.x, count); break;
+            case RegexInst::Save:       ok = below(in.x, prog->slots) && i + 1 < count; break;
+            case RegexInst::Backref:    ok = below(in.x, prog->slots / 2) && i + 1 < count; break;
+            case RegexInst::Match:      break;
+            default:                    ok = i + 1 < count; break;     // The assertions
+            }
+            if(!ok)
+                return none;
+        }
+        return r.failed() ? none : prog;
+    }
+
+private:
+    RegexProgram():slots(2), nullable(false) {}
+
+    static bool below(int v, std::size_t n) { return v >= 0 && static_cast<std::size_t>(v) < n; }
+
+    int emit(RegexInst::Op op, int x = 0, int y = 0)
+    {
+        if(insts.size() >= MaxInsts)
+            throw RegexParser::Unsupported();
+        RegexInst in = { op, x, y };
+        insts.push_back(in);
+        return static_cast<int>(insts.size()) - 1;
+    }
+
+    int next() const { return static_cast<int>(insts.size()); }
+
+    void emitNode(const RegexNode& n)
+    {
+        switch(n.kind)
+        {
+        case RegexNode::Empty:
+            break;
+        case RegexNode::Bytes:
+            sets.push_back(n.set);
+            emit(RegexInst::Byte, static_cast<int>(sets.size()) - 1);
+            break;
+        case RegexNode::Concat:
+            for(std::size_t i = 0; i < n.kids.size(); ++i)
+                emitNode(*n.kids[i]);
+            break;
+        case RegexNode::Alternate:
+        {
+            std::vector<int> jumps;
+            for(std::size_t i = 0; i + 1 < n.kids.size(); ++i)
+            {
+                int split = emit(RegexInst::Split, next() + 1);
+                emitNode(*n.kids[i]);
+                jumps.push_back(emit(RegexInst::Jump));
+                insts[split].y = next();
+            }
+            emitNode(*n.kids.back());
+            for(std::size_t i = 0; i < jumps.size(); ++i)
+                insts[jumps[i]].x = next();
+            break;
+        }
+        case RegexNode::Group:
+        {
+            bool capture = n.index >= 0 && 2 * n.index < slots;    // Not kept with regex_constants::nosubs
+            if(capture)
+                emit(RegexInst::Save, 2 * n.index);
+            emitNode(*n.kids[0]);
+            if(capture)
+                emit(RegexInst::Save, 2 * n.index + 1);
+            break;
+        }
+        case RegexNode::Repeat:
+            emitRepeat(n);
+            break;
+        case RegexNode::LineBegin:
+            emit(RegexInst::AssertBegin);
+            break;
+        case RegexNode::LineEnd:
+            emit(RegexInst::AssertEnd);
+            break;
+        case RegexNode::Backref:
+            if(2 * n.index >= slots)
+                throw RegexParser::Unsupported();   // No such group(or nosubs): std::regex reports it
+            emit(RegexInst::Backref, n.index);
+            break;
+        }
+    }
+
+    // The preferred branch of a Split goes into the repeated part for a greedy repeat, out of it for a lazy one.
+    void preferBody(int split, int body, int out, bool greedy)
+    {
+        insts[split].x = greedy ? body : out;
+        insts[split].y = greedy ? out : body;
+    }
+
+    void emitRepeat(const RegexNode& n)
+    {
+        const RegexNode& body = *n.kids[0];
+
+        for(int i = 0; i < n.min; ++i)
+            emitNode(body);
+
+        if(n.max < 0)
+        {
+            int split = emit(RegexInst::Split);
+            emitNode(body);
+            emit(RegexInst::Jump, split);
+            preferBody(split, split + 1, next(), n.greedy);
+            return;
+        }
+
+        std::vector<int> splits;
+        for(int i = n.min; i < n.max; ++i)
+        {
+            splits.push_back(emit(RegexInst::Split));
+            emitNode(body);
+        }
+        for(std::size_t i = 0; i < splits.size(); ++i)
+            preferBody(splits[i], splits[i] + 1, next(), n.greedy);
+    }
+
+    void computeFirstBytes()
+    {
+        std::vector<char> seen(insts.size(), 0);
+        std::vector<int> stack(1, 0);
+        while(!stack.empty())
+        {
+            int pc = stack.back();
+            stack.pop_back();
+            if(seen[pc])
+                continue;
+            seen[pc] = 1;
+
+            const RegexInst& in = insts[pc];
+            switch(in.op)
+            {
+            case RegexInst::Byte:   firstBytes |= sets[in.x]; break;
+            case RegexInst::Match:  nullable = true; break;
+            case RegexInst::Split:  stack.push_back(in.y); stack.push_back(in.x); break;
+            case RegexInst::Jump:   stack.push_back(in.x); break;
+            case RegexInst::Backref:firstBytes.set(); stack.push_back(pc + 1); break;
+            default:                stack.push_back(pc + 1); break;
+            }
+        }
+        if(nullable)
+            firstBytes.set();
+    }
+};
+
+// A DFA built on demand from a RegexProgram.
+// State 0 is the dead state(no NFA state left), a transition value of -1 is not computed yet.
+class LazyDFA
+{
+public:
+    // unanchored: a match may begin at any offset, as if the pattern started with a non-greedy ".*"
+    LazyDFA(const RegexProgram& prog, bool unanchored):_prog(&prog), _unanchored(unanchored), _mark(prog.insts.size(), 0)
+    {
+        reset();
+    }
+
+    // regex_match(): does the whole of [b, e) match?
+    bool fullMatch(const char* b, const char* e)
+    {
+        int s = start(true);
+        for(const char* p = b; p != e && s != Dead; ++p)
+            s = next(s, static_cast<unsigned char>(*p));
+        return s != Dead && acceptsAtEnd(s);
+    }
+
+    // regex_search(): returns the offset where the earliest ending match ends, -1 if [from, e) contains no match.
+    // bol/eol: ^ can match at b, $ can match at e
+    std::ptrdiff_t earliestEnd(const char* b, const char* from, const char* e, bool bol = true, bool eol = true)
+    {
+        int s = start(from == b && bol);
+        if(_states[s].match)
+            return from - b;
+
+        for(const char* p = from; p != e; ++p)
+        {
+            s = next(s, static_cast<unsigned char>(*p));
+            if(_states[s].match)
+                return p + 1 - b;
+            if(s == Dead)
+                return -1;
+        }
+        return eol && acceptsAtEnd(s) ? e - b : -1;
+    }
+
+    // For a program built by RegexProgram::compileSet(): sets matched[i] for every pattern i that matches
+    // the whole of [b, e)(anchored DFA) or a part of it(unanchored DFA), reading [b, e) once.
+    void matchingPatterns(const char* b, const char* e, std::vector<char>& matched)
+    {
+        std::size_t left = std::count(matched.begin(), matched.end(), 0);
+        int s = start(true);
+
+        for(const char* p = b; ; ++p)
+        {
+            if(_unanchored)
+                left -= mark(_states[s].ids, matched);
+            if(p == e || s == Dead || left == 0)
+                break;
+            s = next(s, static_cast<unsigned char>(*p));
+        }
+        if(s != Dead && left > 0)
+        {
+            acceptsAtEnd(s);
+            mark(_states[s].endIds, matched);
+        }
+    }
+
+    std::size_t stateCount() const { return _states.size(); }
+
+    static const int Dead = 0;
+    static const std::size_t MaxStates = 4096;  // The cache is flushed when it grows beyond this.
+
+private:
+    struct State
+    {
+        std::vector<int> insts;     // Byte, Match and pending AssertEnd instructions
+        bool match;                 // Contains the Match instruction
+        int atEnd;                  // Matches at the end of the input: -1 not known yet, 0, 1
+        std::vector<int> ids;       // The x of the Match instructions
+        std::vector<int> endIds;    // The same, at the end of the input(once atEnd is known)
+    };
+
+    static std::size_t mark(const std::vector<int>& ids, std::vector<char>& matched)
+    {
+        std::size_t marked = 0;
+        for(std::size_t i = 0; i < ids.size(); ++i)
+        {
+            if(!matched[ids[i]])
+            {
+                matched[ids[i]] = 1;
+                ++marked;
+            }
+        }
+        return marked;
+    }
+
+    std::vector<int> matchIds(const std::vector<int>& insts) const
+    {
+        std::vector<int> ids;
+        for(std::size_t i = 0; i < insts.size(); ++i)
+            if(_prog->insts[insts[i]].op == RegexInst::Match)
+                ids.push_back(_prog->insts[insts[i]].x);
+        return ids;
+    }
+
+    void reset()
+    {
+        _states.clear();
+        _trans.clear();
+        _index.clear();
+        _start[0] = _start[1] = -1;
+        intern(std::vector<int>());     // Dead
+    }
+
+    int start(bool atBegin)
+    {
+        int& s = _start[atBegin ? 1 : 0];
+        if(s < 0)
+        {
+            std::vector<int> seed(1, 0);
+            s = intern(closure(seed, atBegin, false));
+        }
+        return s;
+    }
+
+    int next(int s, unsigned char c)
+    {
+        int t = _trans[s * 256 + c];
+        if(t >= 0)
+            return t;
+
+        std::vector<int> seed;
+        const std::vector<int>& insts = _states[s].insts;
+        for(std::size_t i = 0; i < insts.size(); ++i)
+        {
+            const RegexInst& in = _prog->insts[insts[i]];
+            if(in.op == RegexInst::Byte && _prog->sets[in.x][c])
+                seed.push_back(insts[i] + 1);
+        }
+        if(_unanchored)
+            seed.push_back(0);
+
+        std::vector<int> target = closure(seed, false, false);
+
+        if(_states.size() >= MaxStates)
+        {
+            reset();    // Invalidates s, which is not needed any more.
+            return intern(target);
+        }
+
+        t = intern(target);
+        _trans[s * 256 + c] = t;
+        return t;
+    }
+
+    bool acceptsAtEnd(int s)
+    {
+        if(_states[s].atEnd < 0)
+        {
+            _states[s].endIds = matchIds(closure(_states[s].insts, false, true));
+            _states[s].atEnd = !_states[s].endIds.empty();
+        }
+        return _states[s].atEnd == 1;
+    }
+
+    // Follows the instructions that do not consume a character, collecting the ones that do (or that wait).
+    std::vector<int> closure(const std::vector<int>& seed, bool atBegin, bool atEnd)
+    {
+        std::vector<int> result;
+        std::vector<int> stack(seed.rbegin(), seed.rend());
+        std::vector<int> marked;
+
+        while(!stack.empty())
+        {
+            int pc = stack.back();
+            stack.pop_back();
+            if(_mark[pc])
+                continue;
+            _mark[pc] = 1;
+            marked.push_back(pc);
+
+            const RegexInst& in = _prog->insts[pc];
+            switch(in.op)
+            {
+            case RegexInst::Byte:
+            case RegexInst::Match:
+                result.push_back(pc);
+                break;
+            case RegexInst::Split:
+                stack.push_back(in.y);
+                stack.push_back(in.x);
+                break;
+            case RegexInst::Jump:
+                stack.push_back(in.x);
+                break;
+            case RegexInst::Save:
+                stack.push_back(pc + 1);
+                break;
+            case RegexInst::AssertBegin:
+                if(atBegin)
+                    stack.push_back(pc + 1);
+                break;
+            case RegexInst::AssertEnd:
+                if(atEnd)
+                    stack.push_back(pc + 1);
+                else
+                    result.push_back(pc);
+                break;
+            case RegexInst::Backref:    // Not in the programs given to a DFA
+                break;
+            }
+        }
+        for(std::size_t i = 0; i < marked.size(); ++i)
+            _mark[marked[i]] = 0;
+
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    int intern(const std::vector<int>& insts)
+    {
+        std::map<std::vector<int>, int>::iterator found = _index.find(insts);
+        if(found != _index.end())
+            return found->second;
+
+        State st;
+        st.insts = insts;
+        st.ids = matchIds(insts);
+        st.match = !st.ids.empty();
+        st.atEnd = -1;
+        _states.push_back(st);
+        _trans.resize(_states.size() * 256, -1);
+
+        int id = static_cast<int>(_states.size()) - 1;
+        _index[insts] = id;
+        return id;
+    }
+
+    const RegexProgram* _prog;
+    bool _unanchored;
+    std::vector<State> _states;
+    std::vector<int> _trans;
+    std::map<std::vector<int>, int> _index;
+    std::vector<char> _mark;
+    int _start[2];
+};
+
+// Simulates the NFA keeping the sub-match offsets of every thread, in the priority order of ECMAScript.
+// The buffers are kept between calls, so matching does not allocate once they have grown.
+class PikeVM
+{
+public:
+    explicit PikeVM(const RegexProgram& prog):_prog(&prog), _clist(prog), _nlist(prog), _work(prog.slots, -1), _bol(true), _eol(true), _steps(0)
+    {
+        std::vector<char> state(prog.insts.size(), 0);
+        _first.resize(prog.insts.size());
+        for(std::size_t pc = 0; pc < prog.insts.size(); ++pc)
+            first(static_cast<int>(pc), state);
+    }
+
+    // The threads stepped by the last run()
+    unsigned long long steps() const { return _steps; }
+
+    // Searches [from, e), b being the beginning of the whole target(for ^).
+    // full:        the match has to end at e
+    // flags:       match_continuous, match_not_null, match_not_bol, match_not_eol, match_prev_avail
+    bool run(const char* b, const char* from, const char* e, bool full, std::regex_constants::match_flag_type flags, std::vector<int>& caps)
+    {
+        using namespace std::regex_constants;
+        const RegexProgram& prog = *_prog;
+        const std::ptrdiff_t n = e - b;
+        const bool anchored = (flags & match_continuous) != 0;
+        const bool notNull = (flags & match_not_null) != 0;
+        bool matched = false;
+
+        _bol = !(flags & (match_not_bol | match_prev_avail));
+        _eol = !(flags & match_not_eol);
+        _steps = 0;
+
+        _clist.clear();
+        for(std::ptrdiff_t pos = from - b; ; ++pos)
+        {
+            if(!matched && (!anchored || pos == from - b))
+            {
+                if(_clist.empty())
+                {
+                    _clist.clear();     // Forgets the instructions visited at the last position
+                    while(!anchored && pos < n && !prog.firstBytes[static_cast<unsigned char>(b[pos])])
+                        ++pos;
+                }
+                std::fill(_work.begin(), _work.end(), -1);
+                add(_clist, 0, pos, b, n);
+            }
+            if(_clist.empty())
+            {
+                if(matched || anchored || pos >= n)
+                    break;
+                continue;   // Nothing can start here(an assertion failed), try the next position.
+            }
+
+            _nlist.clear();
+            _steps += _clist.size();
+            for(std::size_t i = 0; i < _clist.size(); ++i)
+            {
+                int pc = _clist.dense[i];
+                const RegexInst& in = prog.insts[pc];
+                const int* tcaps = _clist.caps(pc);
+
+                if(in.op == RegexInst::Match)
+                {
+                    if((full && pos != n) || (notNull && tcaps[0] == pos))
+                        continue;
+                    caps.assign(tcaps, tcaps + prog.slots);
+                    matched = true;
+                    break;      // Lower priority threads are cut off
+                }
+                if(in.op == RegexInst::Byte && pos < n && prog.sets[in.x][static_cast<unsigned char>(b[pos])])
+                {
+                    std::copy(tcaps, tcaps + prog.slots, _work.begin());
+                    add(_nlist, pc + 1, pos + 1, b, n);
+                }
+            }
+            std::swap(_clist, _nlist);
+            if(pos >= n)
+                break;
+        }
+        return matched;
+    }
+
+private:
+    // The threads(Byte and Match instructions) in priority order. The instructions visited while adding them
+    // (Split, Jump, Save ...) are only marked, so stepping the list costs nothing for them.
+    struct ThreadList
+    {
+        explicit ThreadList(const RegexProgram& prog):mark(prog.insts.size(), 0), generation(1), slots(prog.slots)
+        {
+            dense.reserve(prog.insts.size());
+            capture.resize(prog.insts.size() * prog.slots);
+        }
+        bool contains(int pc) const { return mark[pc] == generation; }
+        void visit(int pc)          { mark[pc] = generation; }
+        void insert(int pc)         { dense.push_back(pc); }
+        void clear()
+        {
+            dense.clear();
+            if(++generation == 0)
+            {
+                std::fill(mark.begin(), mark.end(), 0);
+                generation = 1;
+            }
+        }
+        bool empty() const      { return dense.empty(); }
+        std::size_t size() const{ return dense.size(); }
+        int* caps(int pc)       { return &capture[pc * slots]; }
+
+        std::vector<unsigned> mark;
+        unsigned generation;
+        std::vector<int> dense;
+        std::vector<int> capture;
+        int slots;
+    };
+
+    // The characters the threads started at pc can read first(all of them when a Match or an assertion can be
+    // reached without reading one, or through a loop that reads nothing). 0 not computed, 1 being computed.
+    const ByteSet& first(int pc, std::vector<char>& state)
+    {
+        if(state[pc] == 2)
+            return _first[pc];
+        if(state[pc] == 1)
+        {
+            static const ByteSet all = ~ByteSet();
+            return all;
+        }
+        state[pc] = 1;
+
+        const RegexInst& in = _prog->insts[pc];
+        ByteSet f;
+        switch(in.op)
+        {
+        case RegexInst::Byte:   f = _prog->sets[in.x]; break;
+        case RegexInst::Split:  f = first(in.x, state); f |= first(in.y, state); break;
+        case RegexInst::Jump:   f = first(in.x, state); break;
+        case RegexInst::Save:   f = first(pc + 1, state); break;
+        default:                f.set(); break;
+        }
+        _first[pc] = f;
+        state[pc] = 2;
+        return _first[pc];
+    }
+
+    void add(ThreadList& l, int pc, std::ptrdiff_t pos, const char* b, std::ptrdiff_t n)
+    {
+        const RegexInst& in = _prog->insts[pc];
+        if(pos < n ? !_first[pc][static_cast<unsigned char>(b[pos])] : in.op == RegexInst::Byte)
+            return;     // These threads would all die at this character: the other alternatives of a UTF-8 class ...
+        if(l.contains(pc))
+            return;
+        l.visit(pc);
+
+        switch(in.op)
+        {
+        case RegexInst::Jump:
+            add(l, in.x, pos, b, n);
+            break;
+        case RegexInst::Split:
+            add(l, in.x, pos, b, n);
+            add(l, in.y, pos, b, n);
+            break;
+        case RegexInst::Save:
+        {
+            int old = _work[in.x];
+            _work[in.x] = static_cast<int>(pos);
+            add(l, pc + 1, pos, b, n);
+            _work[in.x] = old;
+            break;
+        }
+        case RegexInst::AssertBegin:
+            if(pos == 0 && _bol)
+                add(l, pc + 1, pos, b, n);
+            break;
+        case RegexInst::AssertEnd:
+            if(pos == n && _eol)
+                add(l, pc + 1, pos, b, n);
+            break;
+        case RegexInst::Byte:
+        case RegexInst::Match:
+            l.insert(pc);
+            std::copy(_work.begin(), _work.end(), l.caps(pc));
+            break;
+        case RegexInst::Backref:    // Not in the programs given to the Pike VM
+            break;
+        }
+    }
+
+    const RegexProgram* _prog;
+    std::vector<ByteSet> _first;
+    ThreadList _clist, _nlist;
+    std::vector<int> _work;
+    bool _bol, _eol;
+    unsigned long long _steps;
+};
+
+// The most work a match may take: steps(see RegexBacktracker) and time, 0 for no limit.
+struct RegexBudget
+{
+    RegexBudget(unsigned long long s = 0, std::chrono::nanoseconds t = std::chrono::nanoseconds(0)):steps(s), time(t) {}
+
+    unsigned long long steps;
+    std::chrono::nanoseconds time;
+};
+
+// The work done by the matches and searches of a FastRegex, in steps(see FastRegex::lastSteps()).
+struct RegexStats
+{
+    RegexStats():calls(0), steps(0), maxSteps(0), overBudget(0) {}
+
+    unsigned long long calls;
+    unsigned long long steps;
+    unsigned long long maxSteps;    // The most taken by one call
+    unsigned long long overBudget;  // The calls stopped by the budget
+};
+
+// Runs a RegexProgram by backtracking: the engine for patterns with back-references, which no automaton can match.
+// The threads are tried in priority order(the preferred branch of a Split first), on an explicit stack rather than
+// by recursion, so the first Match reached is the one std::regex finds, and a long input cannot overflow the stack.
+//
+// Memoization: what can still match from a thread depends only on its instruction, its position and the sub-matches
+// a back-reference reads later(the groups referred to). Once a (Split, position, those sub-matches) state has been
+// tried it is known to fail, and is skipped the next time. Patterns like ^(a|aa)*\1c$, exponential for a plain
+// backtracker, stay polynomial.
+//
+// A step is one instruction run. run() stops with OverBudget when the budget of steps or time is used up.
+//
+// With icase the program comes from a folded pattern, so only a back-reference compares differently: the characters
+// are compared through the translation of RegexByteFold, as std::regex compares them.
+class RegexBacktracker
+{
+public:
+    enum Status { Matched, NoMatch, OverBudget };
+
+    explicit RegexBacktracker(const RegexProgram& prog, bool icase = false):_prog(&prog), _work(prog.slots, -1), _steps(0)
+    {
+        if(icase)
+            _fold.reset(new RegexByteFold());
+        for(std::size_t pc = 0; pc < prog.insts.size(); ++pc)
+        {
+            if(prog.insts[pc].op == RegexInst::Backref)
+            {
+                int slot = 2 * prog.insts[pc].x;
+                if(std::find(_watched.begin(), _watched.end(), slot) == _watched.end())
+                {
+                    _watched.push_back(slot);
+                    _watched.push_back(slot + 1);
+                }
+            }
+        }
+        _key.resize(std::max<std::size_t>(_watched.size(), 1), 0);
+    }
+
+    // The instructions run by the last run()
+    unsigned long long steps() const { return _steps; }
+
+    // Searches [from, e) as PikeVM::run() does.
+    Status run(const char* b, const char* from, const char* e, bool full, std::regex_constants::match_flag_type flags,
+               std::vector<int>& caps, const RegexBudget& budget = RegexBudget())
+    {
+        using namespace std::regex_constants;
+        const RegexProgram& prog = *_prog;
+        const std::ptrdiff_t n = e - b;
+        const bool anchored = (flags & match_continuous) != 0;
+        const bool notNull = (flags & match_not_null) != 0;
+        const bool bol = !(flags & (match_not_bol | match_prev_avail));
+        const bool eol = !(flags & match_not_eol);
+
+        const bool timed = budget.time.count() > 0;
+        const std::chrono::steady_clock::time_point deadline = timed ? std::chrono::steady_clock::now() + budget.time
+                                                                     : std::chrono::steady_clock::time_point();
+        _steps = 0;
+        _seen.clear();
+
+        for(std::ptrdiff_t start = from - b; start <= n; ++start)
+        {
+            if(!anchored && start < n && !prog.firstBytes[static_cast<unsigned char>(b[start])])
+                continue;
+            if(notNull)
+                _seen.clear();  // A failure can depend on where the match began then
+
+            std::fill(_work.begin(), _work.end(), -1);
+            _stack.clear();
+            Job first = { 0, -1, start };
+            _stack.push_back(first);
+
+            while(!_stack.empty())
+            {
+                Job job = _stack.back();
+                _stack.pop_back();
+                if(job.slot >= 0)
+                {
+                    _work[job.slot] = static_cast<int>(job.pos);    // Undo a Save
+                    continue;
+                }
+
+                int pc = job.pc;
+                std::ptrdiff_t pos = job.pos;
+                for(;;)
+                {
+                    ++_steps;
+                    if(budget.steps && _steps > budget.steps)
+                        return OverBudget;
+                    if(timed && (_steps & 1023) == 0 && std::chrono::steady_clock::now() > deadline)
+                        return OverBudget;
+
+                    const RegexInst& in = prog.insts[pc];
+                    bool alive = true;
+                    switch(in.op)
+                    {
+                    case RegexInst::Byte:
+                        alive = pos < n && prog.sets[in.x][static_cast<unsigned char>(b[pos])];
+                        ++pc;
+                        ++pos;
+                        break;
+                    case RegexInst::Split:
+                    {
+                        alive = firstVisit(pc, pos, n);
+                        Job other = { in.y, -1, pos };
+                        if(alive)
+                            _stack.push_back(other);
+                        pc = in.x;
+                        break;
+                    }
+                    case RegexInst::Jump:
+                        pc = in.x;
+                        break;
+                    case RegexInst::Save:
+                    {
+                        Job undo = { 0, in.x, _work[in.x] };
+                        _stack.push_back(undo);
+                        _work[in.x] = static_cast<int>(pos);
+                        ++pc;
+                        break;
+                    }
+                    case RegexInst::AssertBegin:
+                        alive = pos == 0 && bol;
+                        ++pc;
+                        break;
+                    case RegexInst::AssertEnd:
+                        alive = pos == n && eol;
+                        ++pc;
+                        break;
+                    case RegexInst::Backref:
+                    {
+                        // A group that did not take part matches nothing(as in libstdc++, where ECMAScript matches an empty sequence).
+                        int first = _work[2 * in.x], last = _work[2 * in.x + 1];
+                        std::ptrdiff_t len = last - first;
+                        alive = first >= 0 && last >= first && pos + len <= n && same(b + first, b + pos, len);
+                        pos += len;
+                        ++pc;
+                        break;
+                    }
+                    case RegexInst::Match:
+                        alive = !(full && pos != n) && !(notNull && pos == _work[0]);
+                        if(alive)
+                        {
+                            caps.assign(_work.begin(), _work.end());
+                            return Matched;
+                        }
+                        break;
+                    }
+                    if(!alive)
+                        break;
+                }
+            }
+            if(anchored)
+                break;
+        }
+        return NoMatch;
+    }
+
+private:
+    struct Job
+    {
+        int pc;
+        int slot;               // >= 0: restore _work[slot] to pos instead of running pc
+        std::ptrdiff_t pos;
+    };
+
+    // Records the state, returns false if it was seen before.
+    bool firstVisit(int pc, std::ptrdiff_t pos, std::ptrdiff_t n)
+    {
+        for(std::size_t i = 0; i < _watched.size(); ++i)
+            _key[i] = _work[_watched[i]];
+
+        std::vector<int>& seen = _seen[static_cast<unsigned long long>(pc) * static_cast<unsigned long long>(n + 1) + pos];
+        for(std::size_t i = 0; i < seen.size(); i += _key.size())
+            if(std::equal(_key.begin(), _key.end(), seen.begin() + i))
+                return false;
+        seen.insert(seen.end(), _key.begin(), _key.end());
+        return true;
+    }
+
+    // The text of a group compared with the text at p, caseless with icase.
+    bool same(const char* group, const char* p, std::ptrdiff_t len) const
+    {
+        if(!_fold)
+            return std::memcmp(group, p, len) == 0;
+        for(std::ptrdiff_t i = 0; i < len; ++i)
+            if(_fold->lower[static_cast<unsigned char>(group[i])] != _fold->lower[static_cast<unsigned char>(p[i])])
+                return false;
+        return true;
+    }
+
+    const RegexProgram* _prog;
+    std::vector<int> _work;
+    std::vector<Job> _stack;
+    std::vector<int> _watched;          // The slots read by back-references
+    std::vector<int> _key;
+    std::unordered_map<unsigned long long, std::vector<int> > _seen;    // (pc, pos) -> the watched slots of each visit
+    unsigned long long _steps;
+    std::unique_ptr<RegexByteFold> _fold;  // icase: the translation of the characters a back-reference compares
+};
+
+// Finds a literal string in a buffer.
+// With SSE2(AVX2) 16(32) positions are compared at once: a position is a candidate if both the first and the
+// last character of the literal are found where expected, and only the candidates are compared with memcmp.
+class LiteralScanner
+{
+public:
+    // caseless: the characters of literal whose bit 0x20 is set also match the same character without it, e.g.
+    // "get" finds "GET" and "Get", and "\xc3\xa9"(é in UTF-8) finds "\xc3\x89"(É): each character is ORed with
+    // 0x20 before it is compared, 16(32) at once with SSE2(AVX2).
+    explicit LiteralScanner(const std::string& literal, const std::string& caseless = std::string()):_lit(literal), _fold(caseless)
+    {
+        _fold.resize(_lit.size(), '\0');
+        _caseless = _fold.find_first_not_of('\0') != std::string::npos;
+    }
+
+    const std::string& literal() const  { return _lit; }
+    const std::string& caseless() const { return _fold; }
+
+    // Returns the first occurrence of the literal in [p, e), nullptr if none.
+    const char* find(const char* p, const char* e) const
+    {
+        const std::size_t n = _lit.size();
+        if(n == 0)
+            return p;
+        if(static_cast<std::size_t>(e - p) < n)
+            return nullptr;
+
+#if defined(__AVX2__)
+        const __m256i first32 = _mm256_set1_epi8(_lit[0]);
+        const __m256i last32 = _mm256_set1_epi8(_lit[n - 1]);
+        const __m256i firstFold32 = _mm256_set1_epi8(_fold[0]);
+        const __m256i lastFold32 = _mm256_set1_epi8(_fold[n - 1]);
+        for(; e - p >= static_cast<std::ptrdiff_t>(n + 31); p += 32)
+        {
+            __m256i f = _mm256_or_si256(firstFold32, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+            __m256i l = _mm256_or_si256(lastFold32, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + n - 1)));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first32, f), _mm256_cmpeq_epi8(last32, l))));
+            for(; mask; mask &= mask - 1)
+            {
+                const char* c = p + __builtin_ctz(mask);
+                if(equal(c))
+                    return c;
+            }
+        }
+#endif
+#if defined(__SSE2__)
+        const __m128i first16 = _mm_set1_epi8(_lit[0]);
+        const __m128i last16 = _mm_set1_epi8(_lit[n - 1]);
+        const __m128i firstFold16 = _mm_set1_epi8(_fold[0]);
+        const __m128i lastFold16 = _mm_set1_epi8(_fold[n - 1]);
+        for(; e - p >= static_cast<std::ptrdiff_t>(n + 15); p += 16)
+        {
+            __m128i f = _mm_or_si128(firstFold16, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+            __m128i l = _mm_or_si128(lastFold16, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + n - 1)));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first16, f), _mm_cmpeq_epi8(last16, l))));
+            for(; mask; mask &= mask - 1)
+            {
+                const char* c = p + __builtin_ctz(mask);
+                if(equal(c))
+                    return c;
+            }
+        }
+#endif
+        // The remaining tail(or everything without SSE2)
+        for(const char* last = e - n; p <= last; ++p)
+        {
+            if(!_fold[0])
+            {
+                p = static_cast<const char*>(std::memchr(p, _lit[0], last - p + 1));
+                if(!p)
+                    return nullptr;
+            }
+            if(equal(p))
+                return p;
+        }
+        return nullptr;
+    }
+
+private:
+    bool equal(const char* p) const
+    {
+        if(!_caseless)
+            return std::memcmp(p, _lit.data(), _lit.size()) == 0;
+        for(std::size_t i = 0; i < _lit.size(); ++i)
+            if((p[i] | _fold[i]) != _lit[i])
+                return false;
+        return true;
+    }
+
+    std::string _lit;
+    std::string _fold;      // 0x20 for the characters compared without their bit 0x20, 0 for the others
+    bool _caseless;
+};
+
+// Finds the first character of a set in a buffer.
+// A set of up to 8 characters(or of all but up to 8) is compared 16(32) positions at once with SSE2(AVX2), one
+// comparison per character of the set; a single character uses memchr. Larger sets are looked up in a table.
+class ByteSetScanner
+{
+public:
+    explicit ByteSetScanner(const ByteSet& set):_count(0), _invert(set.count() > 128)
+    {
+        for(int c = 0; c < 256; ++c)
+        {
+            _in[c] = set[c];
+            if(set[c] != _invert)
+            {
+                if(_count < 8)
+                    _bytes[_count] = static_cast<char>(c);
+                ++_count;
+            }
+        }
+    }
+
+    // Returns the first character of the set in [p, e), nullptr if none.
+    const char* find(const char* p, const char* e) const
+    {
+        if(_count == 1 && !_invert)
+            return static_cast<const char*>(std::memchr(p, _bytes[0], e - p));
+
+        if(_count <= 8)
+        {
+#if defined(__AVX2__)
+            for(; e - p >= 32; p += 32)
+            {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                __m256i hit = _mm256_setzero_si256();
+                for(unsigned i = 0; i < _count; ++i)
+                    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(_bytes[i])));
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+                if(_invert)
+                    mask = ~mask;
+                if(mask)
+                    return p + __builtin_ctz(mask);
+            }
+#endif
+#if defined(__SSE2__)
+            for(; e - p >= 16; p += 16)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i hit = _mm_setzero_si128();
+                for(unsigned i = 0; i < _count; ++i)
+                    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(block, _mm_set1_epi8(_bytes[i])));
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+                if(_invert)
+                    mask ^= 0xFFFF;
+                if(mask)
+                    return p + __builtin_ctz(mask);
+            }
+#endif
+        }
+        // The remaining tail(or everything without SSE2)
+        for(; p != e; ++p)
+            if(_in[static_cast<unsigned char>(*p)])
+                return p;
+        return nullptr;
+    }
+
+private:
+    char _bytes[8];     // The characters of the set(or of its complement when _invert), if there are no more than 8
+    unsigned _count;    // How many there are
+    bool _invert;
+    bool _in[256];
+};
+
+// The literal every match of a pattern contains, and the characters the pattern can match before/after it.
+// A match containing the literal found at hit lies inside [window begin, window end), where the window
+// extends from the literal over the characters in 'before' on the left and in 'after' on the right.
+struct RegexPrefilter
+{
+    RegexPrefilter(const std::string& literal, const std::string& caseless, const ByteSet& b, const ByteSet& a)
+        :scanner(literal, caseless), before(b), after(a) {}
+
+    // Returns nullptr if the pattern has no usable literal(or has ^ $ assertions, which a window would change).
+    static std::unique_ptr<RegexPrefilter> fromTree(const RegexNode& root)
+    {
+        std::unique_ptr<RegexPrefilter> none;
+        if(hasAssertions(root))
+            return none;
+
+        std::vector<const RegexNode*> parts;
+        if(root.kind == RegexNode::Concat)
+            for(std::size_t i = 0; i < root.kids.size(); ++i)
+                parts.push_back(root.kids[i].get());
+        else
+            parts.push_back(&root);
+
+        // The longest run of parts matching a single character each, or a character and the same without its
+        // bit 0x20(the two cases of an icase letter, [aA]), which LiteralScanner compares caseless.
+        std::size_t best = 0, bestLen = 0;
+        for(std::size_t i = 0; i < parts.size(); )
+        {
+            std::size_t j = i;
+            while(j < parts.size() && literalChar(*parts[j]) >= 0)
+                ++j;
+            if(j - i > bestLen)
+            {
+                best = i;
+                bestLen = j - i;
+            }
+            i = (j == i) ? i + 1 : j;
+        }
+        if(bestLen == 0)
+            return none;
+
+        std::string literal, caseless;
+        for(std::size_t i = best; i < best + bestLen; ++i)
+        {
+            int c = literalChar(*parts[i]);
+            literal += static_cast<char>(c);
+            caseless += static_cast<char>(parts[i]->set.count() == 2 ? 0x20 : 0);
+        }
+
+        ByteSet b, a;
+        for(std::size_t i = 0; i < best; ++i)
+            b |= consumed(*parts[i]);
+        for(std::size_t i = best + bestLen; i < parts.size(); ++i)
+            a |= consumed(*parts[i]);
+
+        return std::unique_ptr<RegexPrefilter>(new RegexPrefilter(literal, caseless, b, a));
+    }
+
+    void write(RegexSnapshot::Writer& w) const
+    {
+        w.bytes(scanner.literal());
+        w.bytes(scanner.caseless());
+        w.set(before);
+        w.set(after);
+    }
+
+    static std::unique_ptr<RegexPrefilter> read(RegexSnapshot::Reader& r)
+    {
+        std::string literal = r.bytes();
+        std::string caseless = r.bytes();
+        ByteSet b = r.set();
+        ByteSet a = r.set();
+        if(r.failed() || literal.empty() || caseless.size() != literal.size())
+            return std::unique_ptr<RegexPrefilter>();
+        return std::unique_ptr<RegexPrefilter>(new RegexPrefilter(literal, caseless, b, a));
+    }
+
+    const char* windowBegin(const char* hit, const char* limit) const
+    {
+        while(hit > limit && before[static_cast<unsigned char>(hit[-1])])
+            --hit;
+        return hit;
+    }
+
+    const char* windowEnd(const char* hit, const char* limit) const
+    {
+        const char* p = hit + scanner.literal().size();
+        while(p < limit && after[static_cast<unsigned char>(*p)])
+            ++p;
+        return p;
+    }
+
+    LiteralScanner scanner;
+    ByteSet before;
+    ByteSet after;
+
+private:
+    // The character of the literal a part matches(the one with bit 0x20 for a caseless pair), -1 if none.
+    static int literalChar(const RegexNode& n)
+    {
+        if(n.kind != RegexNode::Bytes || n.set.count() > 2 || n.set.none())
+            return -1;
+        int c = 0;
+        while(!n.set[c])
+            ++c;
+        if(n.set.count() == 1)
+            return c;
+        return (c & 0x20) == 0 && n.set[c | 0x20] ? c | 0x20 : -1;
+    }
+
+    static bool hasAssertions(const RegexNode& n)
+    {
+        if(n.kind == RegexNode::LineBegin || n.kind == RegexNode::LineEnd)
+            return true;
+        for(std::size_t i = 0; i < n.kids.size(); ++i)
+            if(hasAssertions(*n.kids[i]))
+                return true;
+        return false;
+    }
+
+    // The characters a part of the pattern can consume.
+    static ByteSet consumed(const RegexNode& n)
+    {
+        ByteSet s;
+        switch(n.kind)
+        {
+        case RegexNode::Bytes:      return n.set;
+        case RegexNode::Backref:    return s.set();
+        case RegexNode::Repeat:     if(n.max == 0) return s; break;
+        default:                    break;
+        }
+        for(std::size_t i = 0; i < n.kids.size(); ++i)
+            s |= consumed(*n.kids[i]);
+        return s;
+    }
+};
+
+// Thrown by FastRegex for a valid pattern that FastRegex::utf8 does not support(\b, look-ahead, back-references
+// with icase ...). Its code is error_escape, not error_complexity: that one means a RegexBudget was exceeded.
+struct RegexUtf8Unsupported : std::regex_error
+{
+    RegexUtf8Unsupported():std::regex_error(std::regex_constants::error_escape) {}
+
+    const char* what() const noexcept override { return "The pattern is valid, but not supported in UTF-8 mode"; }
+};
+
+class FastRegex
+{
+public:
+    typedef std::regex_constants::syntax_option_type flag_type;
+    typedef std::regex_constants::match_flag_type match_flag_type;
+
+    // Matches the pattern on UTF-8 text, e.g. FastRegex(p, FastRegex::utf8 | std::regex_constants::icase).
+    static constexpr flag_type utf8 = static_cast<flag_type>(1 << 20);
+
+    // The RegexParser mode of the flags f: code parsing a pattern of its own must use it to get the tree FastRegex uses.
+    static unsigned parserMode(flag_type f)
+    {
+        return ((f & utf8) ? RegexParser::Utf8 : 0) | ((f & std::regex_constants::icase) ? RegexParser::Icase : 0);
+    }
+
+    // Can the part n of a parsed pattern match an empty sequence?
+    static bool nullable(const RegexNode& n)
+    {
+        switch(n.kind)
+        {
+        case RegexNode::Bytes:      return false;
+        case RegexNode::Repeat:     return n.min == 0 || nullable(*n.kids[0]);
+        case RegexNode::Concat:
+            for(std::size_t i = 0; i < n.kids.size(); ++i)
+                if(!nullable(*n.kids[i]))
+                    return false;
+            return true;
+        case RegexNode::Alternate:
+            for(std::size_t i = 0; i < n.kids.size(); ++i)
+                if(nullable(*n.kids[i]))
+                    return true;
+            return false;
+        case RegexNode::Group:      return nullable(*n.kids[0]);
+        default:                    return true;    // Empty, ^, $ and a back-reference(to a group that can be empty)
+        }
+    }
+
+    explicit FastRegex(const std::string& pattern, flag_type f = std::regex_constants::ECMAScript):_pattern(pattern), _flags(f), _groups(0), _usePrefilter(true), _lastSteps(0)
+    {
+        using namespace std::regex_constants;
+        const flag_type grammar = ECMAScript | basic | extended | awk | grep | egrep;
+        bool ecma = (f & grammar) == ECMAScript || (f & grammar) == 0;
+        bool exact = true;
+
+        bool unicode = (f & utf8) != 0;
+
+        if(ecma && !(f & collate))
+        {
+            try
+            {
+                RegexParser parser(pattern, parserMode(f));
+                RegexNodePtr root = parser.parse();
+                _groups = (f & nosubs) ? 0 : parser.groups();
+                _prefilter = RegexPrefilter::fromTree(*root);
+                if(!parser.hasBackrefs())
+                {
+                    _prog = RegexProgram::compile(*root, _groups);
+                    exact = unicode || !hasNullableRepeat(*root);
+                }
+                else if(!hasNullableRepeat(*root) && !(unicode && (f & icase)))
+                    _backtrack = RegexProgram::compile(*root, _groups);
+            }
+            catch(RegexParser::Unsupported&)
+            {
+            }
+        }
+
+        if(unicode && !_prog && !_backtrack)
+        {
+            std::regex check(pattern, f & ~utf8);                          // Throws std::regex_error for an invalid pattern
+            throw RegexUtf8Unsupported();                                   // Valid, but outside what UTF-8 mode supports
+        }
+        if((!_prog && !_backtrack) || !exact)
+        {
+            _std.reset(new std::regex(pattern, f));     // Throws std::regex_error for an invalid pattern
+            _groups = static_cast<int>(_std->mark_count());
+        }
+    }
+
+    FastRegex(const FastRegex& other):_pattern(other._pattern), _flags(other._flags), _groups(other._groups), _usePrefilter(other._usePrefilter),
+                                      _prog(other._prog), _backtrack(other._backtrack), _std(other._std), _prefilter(other._prefilter),
+                                      _budget(other._budget), _lastSteps(0) {}
+
+    FastRegex& operator=(const FastRegex& other)
+    {
+        if(this != &other)
+        {
+            _pattern = other._pattern;
+            _flags = other._flags;
+            _groups = other._groups;
+            _usePrefilter = other._usePrefilter;
+            _prog = other._prog;
+            _backtrack = other._backtrack;
+            _std = other._std;
+            _prefilter = other._prefilter;
+            _budget = other._budget;
+            _searcher.reset();
+            _matcher.reset();
+            _vm.reset();
+            _backtracker.reset();
+            _lastSteps = 0;
+            _stats = RegexStats();
+        }
+        return *this;
+    }
+
+    const std::string& pattern() const  { return _pattern; }
+    flag_type flags() const             { return _flags; }
+    unsigned mark_count() const         { return static_cast<unsigned>(_groups); }
+    bool usesDFA() const                { return static_cast<bool>(_prog); }
+    const RegexProgram* program() const { return _prog.get(); }
+
+    // The program run by backtracking for a pattern with back-references, nullptr otherwise.
+    const RegexProgram* backtrackProgram() const { return _backtrack.get(); }
+
+    // The std::regex used when neither the DFA nor the backtracker can be used, nullptr otherwise.
+    const std::regex* fallback() const  { return _std.get(); }
+
+    // Limits the work of each match or search run by the backtracker: going over the budget throws
+    // std::regex_error(error_complexity). The automata take a time linear in the input and are not limited,
+    // and the work of std::regex(the fallback) cannot be.
+    void setBudget(const RegexBudget& budget)   { _budget = budget; }
+    const RegexBudget& budget() const           { return _budget; }
+
+    // The steps taken by the last match or search: characters read by the DFA, threads stepped by the Pike VM
+    // and instructions run by the backtracker(the work of std::regex is not counted).
+    unsigned long long lastSteps() const        { return _lastSteps; }
+    const RegexStats& stats() const             { return _stats; }
+    void resetStats()                           { _stats = RegexStats(); }
+
+    // The compiled pattern as a versioned blob(RegexSnapshot), that fromSnapshot() turns back into a FastRegex
+    // without parsing or compiling anything, e.g. in another process from a file mapped in memory.
+    // A pattern run by std::regex is only recorded, loading it compiles the std::regex again.
+    std::string snapshot() const
+    {
+        std::string payload;
+        RegexSnapshot::Writer w(payload);
+        w.bytes(_pattern);
+        w.u32(static_cast<std::uint32_t>(_groups));
+        w.u8((_prog ? HasProgram : 0) | (_backtrack ? HasBacktrack : 0) | (_std ? HasStd : 0) | (_prefilter ? HasPrefilter : 0));
+        if(_prog)
+            _prog->write(w);
+        if(_backtrack)
+            _backtrack->write(w);
+        if(_prefilter)
+            _prefilter->write(w);
+        return RegexSnapshot::seal(payload, _pattern, static_cast<std::uint32_t>(_flags));
+    }
+
+    // The FastRegex of a blob written by snapshot() for this pattern and these flags. Returns nullptr if the blob
+    // is of another version, damaged(checksum) or written for another pattern or flags(fingerprint): the
+    // caller compiles the pattern then.
+    static std::unique_ptr<FastRegex> fromSnapshot(const char* data, std::size_t size, const std::string& pattern,
+                                                   flag_type f = std::regex_constants::ECMAScript)
+    {
+        std::unique_ptr<FastRegex> none;
+        RegexSnapshot::Reader r(data, data + size);
+        if(!RegexSnapshot::open(r, pattern, static_cast<std::uint32_t>(f)) || r.bytes() != pattern)
+            return none;
+
+        std::unique_ptr<FastRegex> re(new FastRegex(pattern, f, Restore()));
+        re->_groups = static_cast<int>(r.u32());
+        unsigned parts = r.u8();
+        if((parts & HasProgram) && !(re->_prog = RegexProgram::read(r)))
+            return none;
+        if((parts & HasBacktrack) && !(re->_backtrack = RegexProgram::read(r)))
+            return none;
+        if((parts & HasPrefilter) && !(re->_prefilter = RegexPrefilter::read(r)))
+            return none;
+        if(r.failed() || r.left() != 0 || re->_groups < 0 || !(parts & (HasProgram | HasBacktrack | HasStd)))
+            return none;
+
+        if(parts & HasStd)
+            re->_std.reset(new std::regex(pattern, f));
+        return re;
+    }
+
+    // The literal searched before running the automaton, nullptr if the pattern has none.
+    const RegexPrefilter* prefilter() const { return _usePrefilter ? _prefilter.get() : nullptr; }
+    void enablePrefilter(bool on)           { _usePrefilter = on; }
+
+    // Matches the whole of [b, e). caps(if not null) receives the begin/end offset of every sub-match, -1 when unmatched.
+    bool matchRange(const char* b, const char* e, std::vector<int>* caps) const
+    {
+        _lastSteps = 0;
+        bool found = matchWhole(b, e, caps);
+        record();
+        return found;
+    }
+
+    // Searches [from, e) for the leftmost match, b is the beginning of the target.
+    // flags:   match_continuous, match_not_null, match_not_bol, match_not_eol and match_prev_avail are honoured,
+    //          as with std::regex_search(). Searching from a position past b implies match_prev_avail.
+    bool searchRange(const char* b, const char* from, const char* e, std::vector<int>* caps,
+                     match_flag_type flags = std::regex_constants::match_default) const
+    {
+        _lastSteps = 0;
+        bool found;
+        if(!(flags & std::regex_constants::match_continuous) && prefilter())
+            found = prefilteredSearch(b, from, e, caps, flags);
+        else
+            found = searchWindow(b, from, e, caps, flags);
+        record();
+        return found;
+    }
+
+private:
+    enum SnapshotParts { HasProgram = 1, HasBacktrack = 2, HasStd = 4, HasPrefilter = 8 };
+    struct Restore {};
+
+    // An empty FastRegex, filled by fromSnapshot()
+    FastRegex(const std::string& pattern, flag_type f, Restore):_pattern(pattern), _flags(f), _groups(0), _usePrefilter(true), _lastSteps(0) {}
+
+    bool matchWhole(const char* b, const char* e, std::vector<int>* caps) const
+    {
+        if(_prog && b != e)
+        {
+            bool found = matcher().fullMatch(b, e);
+            _lastSteps += e - b;
+            if(!found)
+                return false;
+            if(!caps)
+                return true;
+        }
+        if(_std)
+            return stdMatch(b, e, caps);
+        if(_backtrack)
+            return backtrack(b, b, e, true, std::regex_constants::match_continuous, caps);
+
+        bool found = vm().run(b, b, e, true, std::regex_constants::match_continuous, caps ? *caps : _scratch);
+        _lastSteps += vm().steps();
+        return found;
+    }
+
+    bool backtrack(const char* b, const char* from, const char* e, bool full, match_flag_type flags, std::vector<int>* caps) const
+    {
+        if(!_backtracker)
+            _backtracker.reset(new RegexBacktracker(*_backtrack, (_flags & std::regex_constants::icase) != 0));
+
+        RegexBacktracker::Status status = _backtracker->run(b, from, e, full, flags, caps ? *caps : _scratch, _budget);
+        _lastSteps += _backtracker->steps();
+        if(status == RegexBacktracker::OverBudget)
+        {
+            ++_stats.overBudget;
+            record();
+            throw std::regex_error(std::regex_constants::error_complexity);
+        }
+        return status == RegexBacktracker::Matched;
+    }
+
+    void record() const
+    {
+        ++_stats.calls;
+        _stats.steps += _lastSteps;
+        _stats.maxSteps = std::max(_stats.maxSteps, _lastSteps);
+    }
+
+    // A match has to contain the literal, so only the windows around the places it occurs are searched.
+    // Windows that overlap are merged: a match starting in a window can end in any window it overlaps.
+    // (A pattern with a prefilter has no ^ $ and never matches an empty sequence, so the flags change nothing.)
+    bool prefilteredSearch(const char* b, const char* from, const char* e, std::vector<int>* caps, match_flag_type flags) const
+    {
+        const RegexPrefilter& pf = *_prefilter;
+
+        const char* hit = pf.scanner.find(from, e);
+        while(hit)
+        {
+            const char* begin = pf.windowBegin(hit, from);
+            const char* end = pf.windowEnd(hit, e);
+
+            hit = pf.scanner.find(hit + 1, e);
+            while(hit && pf.windowBegin(hit, end - 1) < end)
+            {
+                end = std::max(end, pf.windowEnd(hit, e));
+                hit = pf.scanner.find(hit + 1, e);
+            }
+
+            if(searchWindow(b, begin, end, caps, flags))
+                return true;
+        }
+        return false;
+    }
+
+    bool searchWindow(const char* b, const char* from, const char* e, std::vector<int>* caps, match_flag_type flags) const
+    {
+        using namespace std::regex_constants;
+        if(_prog && b != e && !(flags & (match_continuous | match_not_null)))
+        {
+            bool bol = !(flags & (match_not_bol | match_prev_avail));
+            bool eol = !(flags & match_not_eol);
+            std::ptrdiff_t end = searcher().earliestEnd(b, from, e, bol, eol);
+            _lastSteps += end < 0 ? e - from : b + end - from;
+            if(end < 0)
+                return false;
+            if(!caps)
+                return true;
+        }
+        if(_std)
+            return stdSearch(b, from, e, caps, flags);
+        if(_backtrack)
+            return backtrack(b, from, e, false, flags, caps);
+
+        bool found = vm().run(b, from, e, false, flags, caps ? *caps : _scratch);
+        _lastSteps += vm().steps();
+        return found;
+    }
+
+    // libstdc++ lets a repeated part match an empty sequence once more, where ECMAScript(and the Pike VM) stops.
+    // Either way the same inputs match, but the sub-matches can differ, so std::regex locates the match then.
+    static bool hasNullableRepeat(const RegexNode& n)
+    {
+        if(n.kind == RegexNode::Repeat && n.max != 1 && nullable(*n.kids[0]))
+            return true;
+        for(std::size_t i = 0; i < n.kids.size(); ++i)
+            if(hasNullableRepeat(*n.kids[i]))
+                return true;
+        return false;
+    }
+
+    bool stdMatch(const char* b, const char* e, std::vector<int>* caps) const
+    {
+        std::cmatch m;
+        if(!std::regex_match(b, e, m, *_std))
+            return false;
+        if(caps)
+            copyCaps(b, m, *caps);
+        return true;
+    }
+
+    bool stdSearch(const char* b, const char* from, const char* e, std::vector<int>* caps, match_flag_type flags) const
+    {
+        match_flag_type mf = flags;
+        if(from != b)
+            mf |= std::regex_constants::match_prev_avail;
+
+        std::cmatch m;
+        if(!std::regex_search(from, e, m, *_std, mf))
+            return false;
+        if(caps)
+            copyCaps(b, m, *caps);
+        return true;
+    }
+
+    static void copyCaps(const char* b, const std::cmatch& m, std::vector<int>& caps)
+    {
+        caps.assign(2 * m.size(), -1);
+        for(std::size_t i = 0; i < m.size(); ++i)
+        {
+            if(m[i].matched)
+            {
+                caps[2 * i] = static_cast<int>(m[i].first - b);
+                caps[2 * i + 1] = static_cast<int>(m[i].second - b);
+            }
+        }
+    }
+
+    LazyDFA& searcher() const
+    {
+        if(!_searcher)
+            _searcher.reset(new LazyDFA(*_prog, true));
+        return *_searcher;
+    }
+
+    LazyDFA& matcher() const
+    {
+        if(!_matcher)
+            _matcher.reset(new LazyDFA(*_prog, false));
+        return *_matcher;
+    }
+
+    PikeVM& vm() const
+    {
+        if(!_vm)
+            _vm.reset(new PikeVM(*_prog));
+        return *_vm;
+    }
+
+    std::string _pattern;
+    flag_type _flags;
+    int _groups;
+    bool _usePrefilter;
+    std::shared_ptr<const RegexProgram> _prog;  // null: the pattern is matched by the backtracker or std::regex
+    std::shared_ptr<const RegexProgram> _backtrack;
+    std::shared_ptr<const std::regex> _std;     // The fallback, or the locator of the matches found by the DFA
+    std::shared_ptr<const RegexPrefilter> _prefilter;
+    RegexBudget _budget;
+
+    mutable unsigned long long _lastSteps;
+    mutable RegexStats _stats;
+
+    // Built on first use, and not shared between copies.
+    mutable std::unique_ptr<LazyDFA> _searcher;
+    mutable std::unique_ptr<LazyDFA> _matcher;
+    mutable std::unique_ptr<PikeVM> _vm;
+    mutable std::unique_ptr<RegexBacktracker> _backtracker;
+    mutable std::vector<int> _scratch;          // The sub-matches nobody asked for, kept to avoid an allocation per call
+};
+
+// A part of the target, by pointer and length, like std::string_view of C++17. Nothing is copied, so the
+// target has to outlive the view. str() makes a std::string copy when one is really needed.
+class fast_string_view
+{
+public:
+    fast_string_view():_data(""), _size(0) {}
+    fast_string_view(const char* data, std::size_t size):_data(data), _size(size) {}
+    fast_string_view(const char* s):_data(s), _size(std::char_traits<char>::length(s)) {}
+    fast_string_view(const std::string& s):_data(s.data()), _size(s.size()) {}
+
+    const char* data() const            { return _data; }
+    std::size_t size() const            { return _size; }
+    std::size_t length() const          { return _size; }
+    bool empty() const                  { return _size == 0; }
+    const char* begin() const           { return _data; }
+    const char* end() const             { return _data + _size; }
+    char operator[](std::size_t i) const { return _data[i]; }
+
+    std::string str() const             { return std::string(_data, _size); }
+
+    bool operator==(const fast_string_view& other) const
+    {
+        return _size == other._size && std::memcmp(_data, other._data, _size) == 0;
+    }
+    bool operator!=(const fast_string_view& other) const { return !(*this == other); }
+
+private:
+    const char* _data;
+    std::size_t _size;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const fast_string_view& v)
+{
+    return os.write(v.data(), static_cast<std::streamsize>(v.size()));
+}
+
+// The results of fast_regex_match() / fast_regex_search(), the same interface as std::match_results.
+// Each sub-match is a std::sub_match, so str(), length(), matched and operator<< work as they do for a std::smatch.
+template<class BiIter>
+class fast_match_results
+{
+public:
+    typedef std::sub_match<BiIter> value_type;
+    typedef const value_type& const_reference;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+    typedef typename std::iterator_traits<BiIter>::difference_type difference_type;
+    typedef typename std::iterator_traits<BiIter>::value_type char_type;
+    typedef std::basic_string<char_type> string_type;
+
+    fast_match_results():_ready(false) {}
+
+    bool ready() const                  { return _ready; }
+    std::size_t size() const            { return _subs.size(); }
+    bool empty() const                  { return _subs.empty(); }
+
+    const_reference operator[](std::size_t n) const { return n < _subs.size() ? _subs[n] : _unmatched; }
+    const_reference prefix() const      { return _prefix; }
+    const_reference suffix() const      { return _suffix; }
+
+    string_type str(std::size_t n = 0) const        { return (*this)[n].str(); }
+    difference_type length(std::size_t n = 0) const { return (*this)[n].length(); }
+    difference_type position(std::size_t n = 0) const  { return std::distance(_base, (*this)[n].first); }
+
+    const_iterator begin() const        { return _subs.begin(); }
+    const_iterator end() const          { return _subs.end(); }
+
+    // The sub-matches as views into the target(an unmatched one is empty), str() without the std::string.
+    // A results object reused from one search to the next keeps its buffers, so a search allocates nothing.
+    fast_string_view view(std::size_t n = 0) const  { return toView((*this)[n]); }
+    fast_string_view prefix_view() const            { return toView(_prefix); }
+    fast_string_view suffix_view() const            { return toView(_suffix); }
+
+    // The begin/end offsets of every sub-match, where FastRegex writes them before assign().
+    std::vector<int>& offsets()         { return _caps; }
+
+    // Fills the results from the offsets found by FastRegex. base: the beginning of the target,
+    // from: where the prefix begins, last: the end of the target.
+    void assign(BiIter base, BiIter from, BiIter last, const std::vector<int>& caps)
+    {
+        _base = base;
+        _subs.resize(caps.size() / 2);
+        for(std::size_t i = 0; i < _subs.size(); ++i)
+        {
+            _subs[i].matched = caps[2 * i] >= 0 && caps[2 * i + 1] >= 0;
+            _subs[i].first = _subs[i].second = last;
+            if(_subs[i].matched)
+            {
+                _subs[i].first = std::next(base, caps[2 * i]);
+                _subs[i].second = std::next(base, caps[2 * i + 1]);
+            }
+        }
+        _prefix.first = from;
+        _prefix.second = _subs[0].first;
+        _prefix.matched = _prefix.first != _prefix.second;
+        _suffix.first = _subs[0].second;
+        _suffix.second = last;
+        _suffix.matched = _suffix.first != _suffix.second;
+        _unmatched.first = _unmatched.second = last;
+        _unmatched.matched = false;
+        _ready = true;
+    }
+
+    void clear(BiIter last)
+    {
+        _subs.clear();
+        _prefix.first = _prefix.second = _suffix.first = _suffix.second = last;
+        _prefix.matched = _suffix.matched = false;
+        _unmatched.first = _unmatched.second = last;
+        _ready = true;
+    }
+
+private:
+    static fast_string_view toView(const value_type& s)
+    {
+        if(s.first == s.second)
+            return fast_string_view();
+        return fast_string_view(&*s.first, static_cast<std::size_t>(std::distance(s.first, s.second)));
+    }
+
+    std::vector<value_type> _subs;
+    std::vector<int> _caps;
+    value_type _prefix, _suffix, _unmatched;
+    BiIter _base;
+    bool _ready;
+};
+
+typedef fast_match_results<const char*> fast_cmatch;
+typedef fast_match_results<std::string::const_iterator> fast_smatch;
+
+// The character sequence [first, last) has to be contiguous, as in a std::string or a character array.
+template<class BiIter>
+inline const char* fast_regex_data(BiIter first, BiIter last)
+{
+    return first == last ? "" : &*first;
+}
+
+template<class BiIter>
+bool fast_regex_match(BiIter first, BiIter last, fast_match_results<BiIter>& m, const FastRegex& re)
+{
+    const char* b = fast_regex_data(first, last);
+    if(!re.matchRange(b, b + std::distance(first, last), &m.offsets()))
+    {
+        m.clear(last);
+        return false;
+    }
+    m.assign(first, first, last, m.offsets());
+    return true;
+}
+
+template<class BiIter>
+bool fast_regex_match(BiIter first, BiIter last, const FastRegex& re)
+{
+    const char* b = fast_regex_data(first, last);
+    return re.matchRange(b, b + std::distance(first, last), nullptr);
+}
+
+inline bool fast_regex_match(const std::string& s, fast_smatch& m, const FastRegex& re) { return fast_regex_match(s.begin(), s.end(), m, re); }
+inline bool fast_regex_match(const std::string& s, const FastRegex& re)                 { return fast_regex_match(s.begin(), s.end(), re); }
+inline bool fast_regex_match(const char* s, fast_cmatch& m, const FastRegex& re)        { return fast_regex_match(s, s + std::char_traits<char>::length(s), m, re); }
+inline bool fast_regex_match(const char* s, const FastRegex& re)                        { return fast_regex_match(s, s + std::char_traits<char>::length(s), re); }
+
+template<class BiIter>
+bool fast_regex_search(BiIter first, BiIter last, fast_match_results<BiIter>& m, const FastRegex& re,
+                       std::regex_constants::match_flag_type flags = std::regex_constants::match_default)
+{
+    const char* b = fast_regex_data(first, last);
+    if(!re.searchRange(b, b, b + std::distance(first, last), &m.offsets(), flags))
+    {
+        m.clear(last);
+        return false;
+    }
+    m.assign(first, first, last, m.offsets());
+    return true;
+}
+
+template<class BiIter>
+bool fast_regex_search(BiIter first, BiIter last, const FastRegex& re)
+{
+    const char* b = fast_regex_data(first, last);
+    return re.searchRange(b, b, b + std::distance(first, last), nullptr);
+}
+
+inline bool fast_regex_search(const std::string& s, fast_smatch& m, const FastRegex& re) { return fast_regex_search(s.begin(), s.end(), m, re); }
+inline bool fast_regex_search(const std::string& s, const FastRegex& re)                 { return fast_regex_search(s.begin(), s.end(), re); }
+inline bool fast_regex_search(const char* s, fast_cmatch& m, const FastRegex& re)        { return fast_regex_search(s, s + std::char_traits<char>::length(s), m, re); }
+inline bool fast_regex_search(const char* s, const FastRegex& re)                        { return fast_regex_search(s, s + std::char_traits<char>::length(s), re); }
+
+// Iterates over the matches of a FastRegex, the same way std::regex_iterator does(including empty matches).
+template<class BiIter>
+class fast_regex_iterator
+{
+public:
+    typedef fast_match_results<BiIter> value_type;
+    typedef const value_type* pointer;
+    typedef const value_type& reference;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+
+    fast_regex_iterator():_re(nullptr), _data(nullptr) {}
+
+    fast_regex_iterator(BiIter first, BiIter last, const FastRegex& re):_first(first), _last(last), _re(&re)
+    {
+        _data = fast_regex_data(first, last);
+        if(!find(first, first, std::regex_constants::match_default))
+            _re = nullptr;
+    }
+
+    reference operator*() const     { return _m; }
+    pointer operator->() const      { return &_m; }
+
+    fast_regex_iterator& operator++()
+    {
+        BiIter start = _m[0].second;
+        BiIter prefixFirst = start;
+
+        if(_m[0].first == _m[0].second)
+        {
+            // An empty match: look for a non-empty one at the same position, else move on by one character.
+            if(start == _last)
+            {
+                _re = nullptr;
+                return *this;
+            }
+            if(find(start, prefixFirst, std::regex_constants::match_continuous | std::regex_constants::match_not_null))
+                return *this;
+            ++start;
+            if(_re->flags() & FastRegex::utf8)
+                while(start != _last && (static_cast<unsigned char>(*start) & 0xC0) == 0x80)
+                    ++start;    // The next character, not the next byte of this one
+        }
+
+        if(!find(start, prefixFirst, std::regex_constants::match_default))
+            _re = nullptr;
+        return *this;
+    }
+
+    fast_regex_iterator operator++(int)
+    {
+        fast_regex_iterator old(*this);
+        ++(*this);
+        return old;
+    }
+
+    bool operator==(const fast_regex_iterator& other) const
+    {
+        if(!_re || !other._re)
+            return _re == other._re;
+        return _re == other._re && _first == other._first && _last == other._last && _m[0] == other._m[0];
+    }
+    bool operator!=(const fast_regex_iterator& other) const { return !(*this == other); }
+
+private:
+    bool find(BiIter from, BiIter prefixFirst, std::regex_constants::match_flag_type flags)
+    {
+        const char* b = _data;
+        const char* e = b + std::distance(_first, _last);
+        if(!_re->searchRange(b, b + std::distance(_first, from), e, &_m.offsets(), flags))
+            return false;
+        _m.assign(_first, prefixFirst, _last, _m.offsets());
+        return true;
+    }
+
+    BiIter _first, _last;
+    const FastRegex* _re;
+    const char* _data;
+    value_type _m;
+};
+
+typedef fast_regex_iterator<const char*> fast_cregex_iterator;
+typedef fast_regex_iterator<std::string::const_iterator> fast_sregex_iterator;
+
+#endif // REGEX_DFA_H
@@ -0,0 +1,117 @@
+#ifndef SAMPLE_UTIL_H
+#define SAMPLE_UTIL_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+
+/*********
+sampleUtil.h: Helpers shared by the samples that time or fuzz their code.
+
+measure(name, loop, ops, base)      times loop(), prints the ns per op and the speedup over base(the seconds of
+                                    a first measure(), 0 for none), returns the seconds taken. loop() returns a
+                                    sum of the results, printed so the work cannot be optimized away.
+measureBytes(name, loop, bytes, base)
+                                    the same for a loop over a text of so many bytes, in ms and MB/s.
+RandomPieces                        random strings made of pieces that matter to a pattern, to compare two
+                                    matchers on them.
+printable(s)                        s with the bytes outside printable ASCII as \xHH.
+
+A sample defining SAMPLE_COUNT_HEAP before including this header replaces the global operator new and delete,
+which then count heapAllocations and heapBytes. Include it so in one translation unit only.
+*********/
+
+template<class Loop>
+double measure(const std::string& name, Loop loop, std::size_t ops, double base,
+               unsigned long (*allocations)() = nullptr, const char* unit = "op")
+{
+    unsigned long allocs = allocations ? allocations() : 0;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    auto sum = loop();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << name << ": " << secs * 1e9 / ops << " ns/" << unit << (base > 0 ? ", speedup " + std::to_string(base / secs) : "");
+    if(allocations)
+        std::cout << ", " << double(allocations() - allocs) / ops << " allocations/" << unit;
+    std::cout << " (sum " << sum << ")" << std::endl;
+    return secs;
+}
+
+template<class Loop>
+double measureBytes(const std::string& name, Loop loop, std::size_t bytes, double base)
+{
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    auto sum = loop();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << name << ": " << secs * 1000 << " ms, " << bytes / secs / (1024 * 1024) << " MB/s"
+              << (base > 0 ? ", speedup " + std::to_string(base / secs) : "") << " (sum " << sum << ")" << std::endl;
+    return secs;
+}
+
+class RandomPieces
+{
+public:
+    // Strings of 0 to maxPieces pieces, the same ones for the same seed.
+    RandomPieces(const std::vector<std::string>& pieces, std::size_t maxPieces, unsigned seed)
+        :_pieces(pieces), _gen(seed), _length(0, maxPieces), _piece(0, pieces.size() - 1) {}
+
+    std::string operator()()
+    {
+        std::string s;
+        for(std::size_t i = _length(_gen); i > 0; --i)
+            s += _pieces[_piece(_gen)];
+        return s;
+    }
+
+private:
+    std::vector<std::string> _pieces;
+    std::mt19937 _gen;
+    std::uniform_int_distribution<std::size_t> _length;
+    std::uniform_int_distribution<std::size_t> _piece;
+};
+
+inline std::string printable(const std::string& s)
+{
+    std::string out;
+    for(unsigned char c : s)
+        out += (c >= 0x20 && c < 0x7f) ? std::string(1, static_cast<char>(c)) : std::string("\\x") + "0123456789abcdef"[c >> 4] + "0123456789abcdef"[c & 15];
+    return out;
+}
+
+#ifdef SAMPLE_COUNT_HEAP
+
+namespace
+{
+    std::atomic<unsigned long> heapAllocations(0);      // Made by the global operator new
+    std::atomic<std::size_t> heapBytes(0);              // Requested from the global operator new, and not deleted yet
+}
+
+// noinline: once inlined, g++ sees malloc() paired with operator delete(or new with free) and warns of a mismatch.
+__attribute__((noinline)) void* operator new(std::size_t size)
+{
+    void* p = std::malloc(size + sizeof(std::max_align_t));
+    if(!p)
+        throw std::bad_alloc();
+    *static_cast<std::size_t*>(p) = size;       // The size is kept in front of the block, for operator delete
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    heapBytes.fetch_add(size, std::memory_order_relaxed);
+    return static_cast<char*>(p) + sizeof(std::max_align_t);
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    if(!p)
+        return;
+    void* block = static_cast<char*>(p) - sizeof(std::max_align_t);
+    heapBytes.fetch_sub(*static_cast<std::size_t*>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+#endif // SAMPLE_COUNT_HEAP
+
+#endif // SAMPLE_UTIL_H